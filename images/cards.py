@@ -0,0 +1,138 @@
+# Card table for the asset pipeline.
+# Order here is the card index used by the firmware: 22 Major Arcana, then
+# the Minor Arcana suits in SUITS order, Ace (1) to King (14).
+# Codes match the image names on sacred-texts.com (pkt/img/<code>.jpg).
+
+SUIT_MAJOR = 0
+SUITS = [
+    # (suit id, code prefix, name)
+    (1, "wa", "Wands"),
+    (2, "cu", "Cups"),
+    (3, "sw", "Swords"),
+    (4, "pe", "Pentacles"),
+]
+
+MAJOR_ARCANA = [
+    ("The Fool", "beginnings, innocence, spontaneity"),
+    ("The Magician", "willpower, skill, manifestation"),
+    ("The High Priestess", "intuition, mystery, inner voice"),
+    ("The Empress", "abundance, nurture, fertility"),
+    ("The Emperor", "authority, structure, control"),
+    ("The Hierophant", "tradition, conformity, teaching"),
+    ("The Lovers", "love, harmony, choices"),
+    ("The Chariot", "determination, victory, drive"),
+    ("Strength", "courage, patience, compassion"),
+    ("The Hermit", "introspection, solitude, guidance"),
+    ("Wheel of Fortune", "cycles, fate, turning point"),
+    ("Justice", "fairness, truth, law"),
+    ("The Hanged Man", "surrender, pause, new view"),
+    ("Death", "endings, change, transition"),
+    ("Temperance", "balance, moderation, patience"),
+    ("The Devil", "attachment, temptation, bondage"),
+    ("The Tower", "upheaval, revelation, sudden change"),
+    ("The Star", "hope, renewal, serenity"),
+    ("The Moon", "illusion, fear, subconscious"),
+    ("The Sun", "joy, success, vitality"),
+    ("Judgement", "rebirth, reckoning, calling"),
+    ("The World", "completion, wholeness, travel"),
+]
+
+RANKS = [
+    ("01", "Ace"), ("02", "Two"), ("03", "Three"), ("04", "Four"),
+    ("05", "Five"), ("06", "Six"), ("07", "Seven"), ("08", "Eight"),
+    ("09", "Nine"), ("10", "Ten"), ("pa", "Page"), ("kn", "Knight"),
+    ("qu", "Queen"), ("ki", "King"),
+]
+
+MINOR_KEYWORDS = {
+    "Wands": [
+        "inspiration, new venture, spark",
+        "planning, decisions, discovery",
+        "expansion, foresight, progress",
+        "celebration, home, harmony",
+        "conflict, competition, tension",
+        "victory, recognition, pride",
+        "defence, perseverance, challenge",
+        "speed, movement, news",
+        "resilience, persistence, guard",
+        "burden, responsibility, strain",
+        "enthusiasm, exploration, news",
+        "energy, passion, impulsiveness",
+        "confidence, warmth, determination",
+        "vision, leadership, boldness",
+    ],
+    "Cups": [
+        "new feelings, love, intuition",
+        "partnership, unity, attraction",
+        "friendship, celebration, community",
+        "apathy, contemplation, reevaluation",
+        "loss, regret, grief",
+        "nostalgia, memories, innocence",
+        "choices, fantasy, illusion",
+        "walking away, withdrawal, search",
+        "contentment, wishes, satisfaction",
+        "fulfilment, family, harmony",
+        "creativity, intuition, message",
+        "romance, charm, imagination",
+        "compassion, calm, intuition",
+        "balance, diplomacy, kindness",
+    ],
+    "Swords": [
+        "clarity, breakthrough, truth",
+        "stalemate, indecision, avoidance",
+        "heartbreak, sorrow, grief",
+        "rest, recovery, contemplation",
+        "conflict, defeat, winning at a cost",
+        "transition, moving on, release",
+        "deception, strategy, stealth",
+        "restriction, isolation, self-doubt",
+        "anxiety, worry, nightmares",
+        "endings, collapse, rock bottom",
+        "curiosity, vigilance, ideas",
+        "ambition, haste, action",
+        "clear thinking, honesty, boundaries",
+        "authority, intellect, truth",
+    ],
+    "Pentacles": [
+        "opportunity, prosperity, new start",
+        "balance, adaptability, priorities",
+        "teamwork, craft, learning",
+        "security, control, saving",
+        "hardship, loss, isolation",
+        "generosity, charity, sharing",
+        "patience, investment, reward",
+        "diligence, skill, mastery",
+        "independence, luxury, self-worth",
+        "legacy, wealth, family",
+        "ambition, study, manifestation",
+        "routine, efficiency, reliability",
+        "nurture, practicality, comfort",
+        "abundance, security, discipline",
+    ],
+}
+
+
+def build_cards():
+    # Returns a list of dicts with code, name, suit, number, keywords
+    cards = []
+    for number, (name, keywords) in enumerate(MAJOR_ARCANA):
+        cards.append({
+            "code": f"ar{number:02d}",
+            "name": name,
+            "suit": SUIT_MAJOR,
+            "number": number,
+            "keywords": keywords,
+        })
+    for suit, prefix, suit_name in SUITS:
+        for number, (rank_code, rank_name) in enumerate(RANKS, start=1):
+            cards.append({
+                "code": f"{prefix}{rank_code}",
+                "name": f"{rank_name} of {suit_name}",
+                "suit": suit,
+                "number": number,
+                "keywords": MINOR_KEYWORDS[suit_name][number - 1],
+            })
+    return cards
+
+
+CARDS = build_cards()
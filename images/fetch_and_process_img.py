@@ -1,9 +1,11 @@
 import os
+import struct
 import requests
 import numpy as np
 from PIL import Image, ImageEnhance, ImageFilter, ImageOps
+from cards import CARDS
 
-BASE_URL = "https://www.sacred-texts.com/tarot/pkt/img/ar{:02d}.jpg"
+BASE_URL = "https://www.sacred-texts.com/tarot/pkt/img/{}.jpg"
 OUTPUT_DIR = "output"
 
 # --------------------------------------------------
@@ -15,6 +17,7 @@ DOWNLOAD_ORIGINALS = False
 SIZES = {
     "1": (128, 218),   # 1-card
     "3": (88, 153),    # 3-card
+    "5": (40, 68),     # 5-, 7- and 10-card spreads
 }
 
 FOLDERS = {
@@ -23,8 +26,28 @@ FOLDERS = {
     "resized": "03_resized",
     "bit1": "04_1bit",
     "bin": "05_binary",
+    "grey": "06_2bit",
 }
 
+# Packed atlas, installed as /assets/tarot/cards.atlas
+ATLAS_DIR = "tarot"
+ATLAS_NAME = "cards.atlas"
+ATLAS_MAGIC = b"TATL"
+ATLAS_VERSION = 4
+NAME_LEN = 24
+KEYWORDS_LEN = 48
+CODE_LEN = 6
+
+# Flash copy of the card table, used by the firmware when no atlas is installed
+CARD_TABLE_HEADER = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "include", "tarot_card_table.h"
+)
+ATLAS_COMPRESS = True    # PackBits-encode cards when it saves space
+ATLAS_PLANES = 1         # 1 = dithered B/W, 2 = 2-bit bit-planes the device dithers
+
+ENCODING_RAW = 0
+ENCODING_PACKBITS = 1
+
 # --------------------------------------------------
 # E-INK IMAGE PROCESSING TWEAKS
 # --------------------------------------------------
@@ -44,9 +67,13 @@ LOCAL_RADIUS = 8         # px
 SHARPEN_AMOUNT = 0.4     # 0–0.6 typical
 SHARPEN_RADIUS = 1.0
 
-# Grayscale quantization (fake gray)
+# Grayscale quantization (fake gray, dithered B/W output only)
 GRAY_LEVELS = 3          # 2 = pure B/W, 3–4 recommended
 
+# 2-bit greyscale: grey value thresholds between the 4 panel levels,
+# black (3), dark grey (2), light grey (1) and white (0)
+GREY_THRESHOLDS = (64, 128, 192)
+
 # Noise (anti-ghosting)
 NOISE_AMOUNT = 0.02      # 0.0–0.05
 
@@ -64,7 +91,7 @@ BAYER_SIZE = 4           # 2 or 4
 # --------------------------------------------------
 def ensure_dirs():
     os.makedirs(os.path.join(OUTPUT_DIR, FOLDERS["orig"]), exist_ok=True)
-    for stage in ["gray", "resized", "bit1", "bin"]:
+    for stage in ["gray", "resized", "bit1", "bin", "grey"]:
         for key in SIZES:
             os.makedirs(
                 os.path.join(OUTPUT_DIR, FOLDERS[stage], key),
@@ -74,22 +101,22 @@ def ensure_dirs():
 # --------------------------------------------------
 # Download
 # --------------------------------------------------
-def download_image(index):
-    path = os.path.join(OUTPUT_DIR, FOLDERS["orig"], f"ar{index:02d}.jpg")
+def download_image(code):
+    path = os.path.join(OUTPUT_DIR, FOLDERS["orig"], f"{code}.jpg")
 
     if not DOWNLOAD_ORIGINALS:
         if not os.path.exists(path):
             raise FileNotFoundError(path)
         return path
 
-    resp = requests.get(BASE_URL.format(index))
+    resp = requests.get(BASE_URL.format(code))
     if resp.status_code != 200:
         return None
 
     with open(path, "wb") as f:
         f.write(resp.content)
 
-    print(f"Downloaded ar{index:02d}")
+    print(f"Downloaded {code}")
     return path
 
 # --------------------------------------------------
@@ -198,10 +225,167 @@ def write_bin_bitmap(img, output_path):
     with open(output_path, "wb") as f:
         f.write(data)
 
+# 2-bit greyscale for the atlas. Each row is written as the high bit-plane
+# row followed by the low bit-plane row, so the firmware can stream rows. The
+# panel is black and white only, the device ordered-dithers the levels as it
+# draws them (see PocketmageEink::blitDitheredBitmap).
+def write_grey_bitmap(img, output_path):
+    arr = np.array(img, dtype=np.uint8)
+    h, w = arr.shape
+    if w % 8 != 0:
+        raise ValueError("Width must be divisible by 8")
+
+    # darkest first: level 3 below the first threshold, 0 above the last
+    level = 3 - np.digitize(arr, GREY_THRESHOLDS)
+    hi = np.packbits((level >> 1) & 1, axis=1)
+    lo = np.packbits(level & 1, axis=1)
+
+    data = bytearray()
+    for y in range(h):
+        data += hi[y].tobytes()
+        data += lo[y].tobytes()
+
+    with open(output_path, "wb") as f:
+        f.write(data)
+
+# --------------------------------------------------
+# PackBits compression
+# --------------------------------------------------
+# Each row is encoded on its own so the firmware can decode row by row.
+# Header byte n:   0..127 -> copy the next n + 1 bytes
+#                129..255 -> repeat the next byte 257 - n times
+def packbits_row(row):
+    out = bytearray()
+    i = 0
+    n = len(row)
+    while i < n:
+        run = 1
+        while i + run < n and run < 128 and row[i + run] == row[i]:
+            run += 1
+        if run >= 2:
+            out.append(257 - run)
+            out.append(row[i])
+            i += run
+            continue
+
+        start = i
+        while i < n and i - start < 128 and not (i + 1 < n and row[i + 1] == row[i]):
+            i += 1
+        out.append(i - start - 1)
+        out += row[start:i]
+    return bytes(out)
+
+def packbits_bitmap(data, row_bytes):
+    out = bytearray()
+    for y in range(0, len(data), row_bytes):
+        out += packbits_row(data[y:y + row_bytes])
+    return bytes(out)
+
+# --------------------------------------------------
+# Atlas packing
+# --------------------------------------------------
+# Layout (little-endian):
+#   header:
+#     magic[4] "TATL", u16 version, u8 size_count, u8 card_count
+#     size_count * (u16 width, u16 height)
+#     u16 record_size, u16 planes (1 = B/W, 2 = greyscale)
+#   card_count records of record_size bytes:
+#     char code[6], u8 suit, u8 number
+#     size_count * (u32 offset, u32 length, u8 encoding, u8 reserved[3])
+#     char name[24], char keywords[48]     (NUL padded)
+#   card data, raw or PackBits rows; a greyscale row is the high
+#   bit-plane row followed by the low one
+# Records are in card index order, sizes in SIZES order.
+def fixed_str(text, length):
+    data = text.encode("ascii")
+    if len(data) >= length:
+        raise ValueError(f"'{text}' does not fit in {length} bytes")
+    return data.ljust(length, b"\0")
+
+def write_atlas():
+    sizes = list(SIZES.items())
+    header_size = 8 + 4 * len(sizes) + 4
+    record_size = CODE_LEN + 2 + 12 * len(sizes) + NAME_LEN + KEYWORDS_LEN
+    offset = header_size + record_size * len(CARDS)
+
+    header = bytearray(ATLAS_MAGIC)
+    header += struct.pack("<HBB", ATLAS_VERSION, len(sizes), len(CARDS))
+    for key, (W, H) in sizes:
+        header += struct.pack("<HH", W, H)
+    header += struct.pack("<HH", record_size, ATLAS_PLANES)
+    stage = "grey" if ATLAS_PLANES == 2 else "bin"
+
+    records = bytearray()
+    blobs = []
+    raw_total = 0
+    for card in CARDS:
+        record = bytearray(fixed_str(card["code"], CODE_LEN))
+        record += struct.pack("<BB", card["suit"], card["number"])
+        for key, (W, H) in sizes:
+            bin_path = os.path.join(
+                OUTPUT_DIR, FOLDERS[stage], key, f"{card['code']}.bin"
+            )
+            with open(bin_path, "rb") as f:
+                data = f.read()
+            if len(data) != W * H // 8 * ATLAS_PLANES:
+                raise ValueError(f"Unexpected size for {bin_path}")
+            raw_total += len(data)
+
+            encoding = ENCODING_RAW
+            if ATLAS_COMPRESS:
+                packed = packbits_bitmap(data, W // 8 * ATLAS_PLANES)
+                if len(packed) < len(data):
+                    data = packed
+                    encoding = ENCODING_PACKBITS
+
+            record += struct.pack("<IIB3x", offset, len(data), encoding)
+            offset += len(data)
+            blobs.append(data)
+        record += fixed_str(card["name"], NAME_LEN)
+        record += fixed_str(card["keywords"], KEYWORDS_LEN)
+        records += record
+
+    atlas_dir = os.path.join(OUTPUT_DIR, FOLDERS["bin"], ATLAS_DIR)
+    os.makedirs(atlas_dir, exist_ok=True)
+    atlas_path = os.path.join(atlas_dir, ATLAS_NAME)
+    with open(atlas_path, "wb") as f:
+        f.write(header)
+        f.write(records)
+        for data in blobs:
+            f.write(data)
+
+    print(f"Atlas written: {atlas_path} ({offset} bytes, {raw_total} raw)")
+
+# --------------------------------------------------
+# Flash card table
+# --------------------------------------------------
+def write_card_table_header(path=CARD_TABLE_HEADER):
+    lines = [
+        "// Generated by images/fetch_and_process_img.py from images/cards.py, do not edit",
+        "#pragma once",
+        "#include <tarot.h>",
+        "",
+        "static constexpr TarotCardDef TAROT_CARD_TABLE[] = {",
+    ]
+    for card in CARDS:
+        # Same limits as the atlas records
+        fixed_str(card["name"], NAME_LEN)
+        fixed_str(card["keywords"], KEYWORDS_LEN)
+        lines.append(
+            f'  {{ "{card["code"]}", "{card["name"]}", {card["suit"]}, '
+            f'{card["number"]}, "{card["keywords"]}" }},'
+        )
+    lines.append("};")
+    lines.append("")
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+    print(f"Card table written: {path}")
+
 # --------------------------------------------------
 # Main processing
 # --------------------------------------------------
-def process_image(path, index):
+def process_image(path, code):
     img = Image.open(path).convert("L")
 
     img = apply_gamma(img, GAMMA)
@@ -211,13 +395,13 @@ def process_image(path, index):
 
     for key, (W, H) in SIZES.items():
         gray_path = os.path.join(
-            OUTPUT_DIR, FOLDERS["gray"], key, f"ar{index:02d}.png"
+            OUTPUT_DIR, FOLDERS["gray"], key, f"{code}.png"
         )
         img.save(gray_path)
 
         resized = img.resize((W, H), Image.NEAREST)
         resized_path = os.path.join(
-            OUTPUT_DIR, FOLDERS["resized"], key, f"ar{index:02d}.png"
+            OUTPUT_DIR, FOLDERS["resized"], key, f"{code}.png"
         )
         resized.save(resized_path)
 
@@ -235,22 +419,31 @@ def process_image(path, index):
             bit = proc.convert("1", dither=Image.NONE)
 
         bit_path = os.path.join(
-            OUTPUT_DIR, FOLDERS["bit1"], key, f"ar{index:02d}.png"
+            OUTPUT_DIR, FOLDERS["bit1"], key, f"{code}.png"
         )
         bit.save(bit_path)
 
         bin_path = os.path.join(
-            OUTPUT_DIR, FOLDERS["bin"], key, f"ar{index:02d}.bin"
+            OUTPUT_DIR, FOLDERS["bin"], key, f"{code}.bin"
         )
         write_bin_bitmap(bit, bin_path)
 
+        # Greyscale goes to the atlas only, per-card files stay B/W
+        grey_path = os.path.join(
+            OUTPUT_DIR, FOLDERS["grey"], key, f"{code}.bin"
+        )
+        write_grey_bitmap(resized, grey_path)
+
 # --------------------------------------------------
 # Entry point
 # --------------------------------------------------
 if __name__ == "__main__":
     ensure_dirs()
 
-    for i in range(22):  # ar00–ar21
-        p = download_image(i)
+    for card in CARDS:  # ar00–ar21, then the Minor Arcana
+        p = download_image(card["code"])
         if p:
-            process_image(p, i)
+            process_image(p, card["code"])
+
+    write_atlas()
+    write_card_table_header()
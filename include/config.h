@@ -5,14 +5,19 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////|
 #define KB_COOLDOWN 50                          // Keypress cooldown
 #define FULL_REFRESH_AFTER 5                    // Full refresh after N partial refreshes (CHANGE WITH CAUTION)
+#define PARTIAL_WINDOW_MAX_PCT 60               // Async refreshes use a partial window while the dirty area is at most this % of the screen
+#define EINK_PAGE_HEIGHT 320                    // E-ink frame buffer rows: 320 keeps the whole frame in RAM, less renders in bands (PocketmageEink::renderPaged)
 #define MAX_FILES 10                            // Number of files to store
 #define FORMAT_SPIFFS_IF_FAILED true            // Format the SPIFFS filesystem if mount fails
 #define SLEEPMODE "TEXT"                        // TEXT, SPLASH, CLOCK
 #define TXT_APP_STYLE 1                         // 0: Old Style (NOT SUPPORTED), 1: New Style
 #define SET_CLOCK_ON_UPLOAD false               // Should system clock be set automatically on code upload?
 #define TOUCH_TIMEOUT_MS 1200                   // Delay after scrolling to return to typing mode (ms)
-#define SYS_METADATA_FILE "/sys/SDMMC_META.txt" // File path to the file system metadata file
+#define SYS_METADATA_FILE "/sys/SDMMC_META.txt" // Text metadata file shared with PocketMage OS, synced with the index
+#define SYS_METADATA_INDEX "/sys/SDMMC_META.idx" // File path to the file system metadata index (MetadataIndex)
 #define POWER_SAVE_FREQ 40                      // CPU freq for power save mode
+#define SD_CACHE_BLOCKS 16                      // SD read cache blocks (BlockCache), fewer if they don't fit in RAM
+#define SD_CACHE_BLOCK_SIZE 2048                // SD read cache block size in bytes
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////|
 
 // PIN DEFINITION
@@ -20,6 +20,7 @@
 #include <freertos/task.h>
 #include <assets.h>
 #include <config.h>
+#include <pocketmage_text.h>
 
 /* // migrated to pocketmage_eink.h
 // FONTS
@@ -51,7 +52,7 @@
 
 // ===================== DISPLAY =====================
 // E-ink display
-extern GxEPD2_BW<GxEPD2_310_GDEQ031T10, GxEPD2_310_GDEQ031T10::HEIGHT> display;
+extern GxEPD2_BW<GxEPD2_310_GDEQ031T10, EINK_PAGE_HEIGHT> display;
 // OLED 
 extern U8G2_SSD1326_ER_256X32_F_4W_HW_SPI u8g2;
 
@@ -154,7 +155,7 @@ extern AppState CurrentAppState;         // Current app state
 
 // ===================== TXT APP =====================
 extern volatile bool newLineAdded;           // New line added in TXT
-extern std::vector<String> allLines;         // All lines in TXT
+extern TextDocument allLines;                // TXT document and its display lines
 
 // ===================== TASKS APP =====================
 extern std::vector<std::vector<String>> tasks; // Task list
@@ -0,0 +1,61 @@
+// @knzet 2025
+#pragma once
+#include <Arduino.h>
+
+// ===================== TAROT CONSTANTS =====================
+#define TAROT_MAX_CARDS    78 // full deck, Major then Minor Arcana
+#define MAJOR_ARCANA_COUNT 22 // cards 0-21, the only ones without an atlas
+
+enum TarotSuit : uint8_t {
+  TAROT_SUIT_MAJOR = 0,
+  TAROT_SUIT_WANDS,
+  TAROT_SUIT_CUPS,
+  TAROT_SUIT_SWORDS,
+  TAROT_SUIT_PENTACLES,
+};
+
+// Field sizes of the card table, NUL included
+#define TAROT_CODE_LEN     6
+#define TAROT_NAME_LEN     24
+#define TAROT_KEYWORDS_LEN 48
+
+// Entry of the flash card table (tarot_card_table.h)
+struct TarotCardDef {
+  const char* code;     // asset name, e.g. "ar00" or "wa01"
+  const char* name;
+  uint8_t     suit;     // TarotSuit
+  uint8_t     number;   // 0-21 for Major Arcana, 1 (Ace) - 14 (King) otherwise
+  const char* keywords;
+};
+
+// One card's metadata, filled from the atlas or the flash table
+struct TarotCardInfo {
+  char    code[TAROT_CODE_LEN];
+  char    name[TAROT_NAME_LEN];
+  char    keywords[TAROT_KEYWORDS_LEN];
+  uint8_t suit;
+  uint8_t number;
+};
+
+// Card artwork size classes, one per spread layout
+enum TarotSize : uint8_t {
+  TAROT_SIZE_1 = 0, // 1-card spread
+  TAROT_SIZE_3,     // 3-card spread
+  TAROT_SIZE_S,     // small cards for 5-card and larger spreads
+  TAROT_SIZE_COUNT
+};
+
+struct TarotSizeInfo {
+  uint8_t  folder; // asset folder under /assets/tarot/
+  uint16_t w;      // width in pixels (multiple of 8)
+  uint16_t h;      // height in pixels
+};
+
+static constexpr TarotSizeInfo TAROT_SIZES[TAROT_SIZE_COUNT] = {
+  { 1, 128, 218 },
+  { 3,  88, 153 },
+  { 5,  40,  68 },
+};
+
+// Bytes of one packed card bitmap, 1 bit-plane (B/W) or 2 (greyscale)
+constexpr size_t tarotBytes(uint8_t size, uint8_t planes = 1) { return (size_t)TAROT_SIZES[size].w * TAROT_SIZES[size].h / 8 * planes; }
@@ -0,0 +1,76 @@
+// @knzet 2025
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+#include <tarot.h>
+
+#define TAROT_ATLAS_PATH "/assets/tarot/cards.atlas"
+
+// ===================== CARD ATLAS =====================
+// Reads card bitmaps and metadata out of the packed atlas written by
+// images/fetch_and_process_img.py. The file is opened once and kept open so a
+// card read is a seek plus a read instead of a FAT path walk per card.
+//
+// Layout (little-endian):
+//   magic[4] "TATL", u16 version, u8 sizeCount, u8 cardCount
+//   sizeCount * { u16 w, u16 h }, u16 recordSize, u16 planes (v4, 0 in v3)
+//   cardCount fixed size records of
+//     { char code[6], u8 suit, u8 number,
+//       sizeCount * { u32 offset, u32 length, u8 encoding, u8 reserved[3] },
+//       char name[24], char keywords[48] }
+//   card data, raw or PackBits coded row by row. A greyscale (2 plane) row
+//   is the high bit-plane row followed by the low bit-plane row.
+// Records are read on demand, so RAM use does not grow with the deck.
+class TarotAtlas {
+public:
+  explicit TarotAtlas() {}
+
+  // Called once per chunk of decoded rows, rows holds count * w / 8 * planes() packed bytes
+  using RowFn = std::function<void(uint16_t y, const uint8_t* rows, uint16_t count)>;
+
+  bool    begin(fs::FS* fileSys, const char* path = TAROT_ATLAS_PATH);
+  void    end();
+  bool    isOpen() const { return open_; }
+  uint8_t count()  const { return cardCount_; }
+  // 1 for B/W cards, 2 for 2-bit greyscale
+  uint8_t planes() const { return planes_; }
+
+  // Name, suit, number and keywords of one card
+  bool info(uint8_t card, TarotCardInfo& out);
+  // Read one card bitmap, len must match the unpacked size
+  bool read(uint8_t card, uint8_t size, uint8_t* buf, size_t len);
+  // Stream one card in row chunks without buffering the whole bitmap
+  bool readRows(uint8_t card, uint8_t size, const RowFn& fn);
+
+private:
+  enum Encoding : uint8_t { ENCODING_RAW = 0, ENCODING_PACKBITS = 1 };
+
+  struct Entry {
+    uint32_t offset;
+    uint32_t length;
+    uint8_t  encoding;
+  };
+
+  static constexpr const char* tag     = "TAROT_ATLAS";
+  static constexpr uint16_t    version = 4; // 3 is read as 1 plane
+
+  // Record layout for TAROT_SIZE_COUNT size classes
+  static constexpr size_t headerSize  = 12 + 4 * TAROT_SIZE_COUNT;
+  static constexpr size_t entryOffset = TAROT_CODE_LEN + 2;
+  static constexpr size_t entrySize   = 12;
+  static constexpr size_t nameOffset  = entryOffset + entrySize * TAROT_SIZE_COUNT;
+  static constexpr size_t recordSize  = nameOffset + TAROT_NAME_LEN + TAROT_KEYWORDS_LEN;
+
+  bool entry(uint8_t card, uint8_t size, Entry& out);
+
+  File    file_;
+  bool    open_      = false;
+  uint8_t cardCount_ = 0;
+  uint8_t planes_    = 1;
+
+  // Decode scratch, kept off the caller's stack
+  static constexpr uint16_t chunkRows = 16;
+  uint8_t in_[256];
+  uint8_t rows_[chunkRows * 32];   // widest card is 128 px, 2 planes
+};
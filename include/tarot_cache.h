@@ -0,0 +1,110 @@
+// @knzet 2025
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <tarot.h>
+#include <tarot_atlas.h>
+#include <config.h>
+
+// Slots used when no PSRAM is available, more when a paged eink buffer
+// (EINK_PAGE_HEIGHT below the 320 panel rows) leaves the RAM for them
+#define TAROT_CACHE_LRU_SLOTS (EINK_PAGE_HEIGHT < 320 ? 6 : 4)
+#define TAROT_PREFETCH_MAX    4 // next 1-card spread plus next 3-card spread
+
+// ===================== CARD IMAGE CACHE =====================
+// Keeps card bitmaps in RAM so a spread can be drawn without touching SD.
+// With PSRAM every card of every size class gets a fixed slot and is warmed
+// in the background. Without PSRAM a small LRU in internal RAM is used and
+// cards are loaded on demand; the cards the next spread will need can be
+// prefetched on a background task while the panel refreshes.
+// Cards and their metadata are read from the packed atlas when present,
+// otherwise the Major Arcana are read from the per-card files under
+// /assets/tarot/<n>/ and named from the flash card table.
+class TarotCache {
+public:
+  explicit TarotCache() {}
+
+  // Allocate storage, returns false if no memory could be reserved
+  bool begin(fs::FS* fileSys);
+  // Load every card into the cache (resident mode only)
+  void warm();
+  // Run warm() on a background task
+  void startWarmTask();
+
+  struct PrefetchItem {
+    uint8_t card;
+    uint8_t size;
+  };
+  // Queue cards to be decoded in the background, replaces any pending list.
+  // Returns immediately; later draws of these cards are cache hits. In LRU
+  // mode the cards acquired since the previous prefetch() (the spread just
+  // drawn) are never evicted for it, so only the other slots are filled and
+  // the items that don't fit are dropped.
+  void prefetch(const PrefetchItem* items, uint8_t n);
+
+  // Returns the bitmap for card/size and holds the cache lock until release()
+  // Returns nullptr (lock not held) if the card could not be loaded
+  const uint8_t* acquire(uint8_t card, uint8_t size);
+  void release();
+  // Decode a card row by row without a RAM copy, used when acquire() fails
+  bool readRows(uint8_t card, uint8_t size, const TarotAtlas::RowFn& fn);
+
+  // Cards available on this install, 78 with a full atlas
+  uint8_t cardCount() const { return count_; }
+  // Bit-planes per card row, 2 for a greyscale atlas (see blitDitheredBitmap())
+  uint8_t planes()    const { return planes_; }
+  // Metadata for one card, O(1) from the atlas or the flash table
+  bool    cardInfo(uint8_t card, TarotCardInfo& out);
+
+  bool     isResident() const { return resident_; }
+  uint32_t hits()       const { return hits_; }
+  uint32_t misses()     const { return misses_; }
+
+private:
+  struct Slot {
+    uint8_t  card    = 0;
+    uint8_t  size    = 0;
+    bool     valid   = false;
+    uint32_t lastUse = 0;
+    uint32_t spread  = 0;   // spread_ when last acquired, see prefetch()
+    uint8_t* data    = nullptr;
+  };
+
+  static constexpr const char* tag = "TAROT_CACHE";
+
+  bool     load(uint8_t card, uint8_t size, uint8_t* dst);
+  // pinned: a prefetch lookup, which neither evicts nor counts slots of
+  // that spread and claims the slot it uses for it; 0 for a draw
+  uint8_t* lookup(uint8_t card, uint8_t size, bool count, uint32_t pinned = 0);
+  uint8_t* residentSlot(uint8_t card, uint8_t size);
+  static void warmTask(void* parameter);
+  static void prefetchTask(void* parameter);
+
+  fs::FS*           fileSys_  = nullptr;
+  SemaphoreHandle_t lock_     = nullptr;
+  TarotAtlas        atlas_;   // only accessed with lock_ held
+  uint8_t           count_    = MAJOR_ARCANA_COUNT;
+  uint8_t           planes_   = 1;  // per-card files are always B/W
+
+  // Resident (PSRAM) mode
+  bool              resident_ = false;
+  uint8_t*          store_    = nullptr;
+  bool              loaded_[TAROT_SIZE_COUNT][TAROT_MAX_CARDS] = {};
+
+  // LRU (internal RAM) mode
+  Slot              slots_[TAROT_CACHE_LRU_SLOTS];
+  uint32_t          useTick_  = 0;
+  volatile uint32_t spread_   = 1;  // bumped by each prefetch()
+
+  // Prefetch, pending_ is guarded by pendingMux_
+  TaskHandle_t      prefetchTask_ = nullptr;
+  portMUX_TYPE      pendingMux_   = portMUX_INITIALIZER_UNLOCKED;
+  PrefetchItem      pending_[TAROT_PREFETCH_MAX];
+  uint8_t           pendingCount_ = 0;
+  uint32_t          pendingPin_   = 0;
+
+  volatile uint32_t hits_     = 0;
+  volatile uint32_t misses_   = 0;
+};
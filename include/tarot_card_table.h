@@ -0,0 +1,84 @@
+// Generated by images/fetch_and_process_img.py from images/cards.py, do not edit
+#pragma once
+#include <tarot.h>
+
+static constexpr TarotCardDef TAROT_CARD_TABLE[] = {
+  { "ar00", "The Fool", 0, 0, "beginnings, innocence, spontaneity" },
+  { "ar01", "The Magician", 0, 1, "willpower, skill, manifestation" },
+  { "ar02", "The High Priestess", 0, 2, "intuition, mystery, inner voice" },
+  { "ar03", "The Empress", 0, 3, "abundance, nurture, fertility" },
+  { "ar04", "The Emperor", 0, 4, "authority, structure, control" },
+  { "ar05", "The Hierophant", 0, 5, "tradition, conformity, teaching" },
+  { "ar06", "The Lovers", 0, 6, "love, harmony, choices" },
+  { "ar07", "The Chariot", 0, 7, "determination, victory, drive" },
+  { "ar08", "Strength", 0, 8, "courage, patience, compassion" },
+  { "ar09", "The Hermit", 0, 9, "introspection, solitude, guidance" },
+  { "ar10", "Wheel of Fortune", 0, 10, "cycles, fate, turning point" },
+  { "ar11", "Justice", 0, 11, "fairness, truth, law" },
+  { "ar12", "The Hanged Man", 0, 12, "surrender, pause, new view" },
+  { "ar13", "Death", 0, 13, "endings, change, transition" },
+  { "ar14", "Temperance", 0, 14, "balance, moderation, patience" },
+  { "ar15", "The Devil", 0, 15, "attachment, temptation, bondage" },
+  { "ar16", "The Tower", 0, 16, "upheaval, revelation, sudden change" },
+  { "ar17", "The Star", 0, 17, "hope, renewal, serenity" },
+  { "ar18", "The Moon", 0, 18, "illusion, fear, subconscious" },
+  { "ar19", "The Sun", 0, 19, "joy, success, vitality" },
+  { "ar20", "Judgement", 0, 20, "rebirth, reckoning, calling" },
+  { "ar21", "The World", 0, 21, "completion, wholeness, travel" },
+  { "wa01", "Ace of Wands", 1, 1, "inspiration, new venture, spark" },
+  { "wa02", "Two of Wands", 1, 2, "planning, decisions, discovery" },
+  { "wa03", "Three of Wands", 1, 3, "expansion, foresight, progress" },
+  { "wa04", "Four of Wands", 1, 4, "celebration, home, harmony" },
+  { "wa05", "Five of Wands", 1, 5, "conflict, competition, tension" },
+  { "wa06", "Six of Wands", 1, 6, "victory, recognition, pride" },
+  { "wa07", "Seven of Wands", 1, 7, "defence, perseverance, challenge" },
+  { "wa08", "Eight of Wands", 1, 8, "speed, movement, news" },
+  { "wa09", "Nine of Wands", 1, 9, "resilience, persistence, guard" },
+  { "wa10", "Ten of Wands", 1, 10, "burden, responsibility, strain" },
+  { "wapa", "Page of Wands", 1, 11, "enthusiasm, exploration, news" },
+  { "wakn", "Knight of Wands", 1, 12, "energy, passion, impulsiveness" },
+  { "waqu", "Queen of Wands", 1, 13, "confidence, warmth, determination" },
+  { "waki", "King of Wands", 1, 14, "vision, leadership, boldness" },
+  { "cu01", "Ace of Cups", 2, 1, "new feelings, love, intuition" },
+  { "cu02", "Two of Cups", 2, 2, "partnership, unity, attraction" },
+  { "cu03", "Three of Cups", 2, 3, "friendship, celebration, community" },
+  { "cu04", "Four of Cups", 2, 4, "apathy, contemplation, reevaluation" },
+  { "cu05", "Five of Cups", 2, 5, "loss, regret, grief" },
+  { "cu06", "Six of Cups", 2, 6, "nostalgia, memories, innocence" },
+  { "cu07", "Seven of Cups", 2, 7, "choices, fantasy, illusion" },
+  { "cu08", "Eight of Cups", 2, 8, "walking away, withdrawal, search" },
+  { "cu09", "Nine of Cups", 2, 9, "contentment, wishes, satisfaction" },
+  { "cu10", "Ten of Cups", 2, 10, "fulfilment, family, harmony" },
+  { "cupa", "Page of Cups", 2, 11, "creativity, intuition, message" },
+  { "cukn", "Knight of Cups", 2, 12, "romance, charm, imagination" },
+  { "cuqu", "Queen of Cups", 2, 13, "compassion, calm, intuition" },
+  { "cuki", "King of Cups", 2, 14, "balance, diplomacy, kindness" },
+  { "sw01", "Ace of Swords", 3, 1, "clarity, breakthrough, truth" },
+  { "sw02", "Two of Swords", 3, 2, "stalemate, indecision, avoidance" },
+  { "sw03", "Three of Swords", 3, 3, "heartbreak, sorrow, grief" },
+  { "sw04", "Four of Swords", 3, 4, "rest, recovery, contemplation" },
+  { "sw05", "Five of Swords", 3, 5, "conflict, defeat, winning at a cost" },
+  { "sw06", "Six of Swords", 3, 6, "transition, moving on, release" },
+  { "sw07", "Seven of Swords", 3, 7, "deception, strategy, stealth" },
+  { "sw08", "Eight of Swords", 3, 8, "restriction, isolation, self-doubt" },
+  { "sw09", "Nine of Swords", 3, 9, "anxiety, worry, nightmares" },
+  { "sw10", "Ten of Swords", 3, 10, "endings, collapse, rock bottom" },
+  { "swpa", "Page of Swords", 3, 11, "curiosity, vigilance, ideas" },
+  { "swkn", "Knight of Swords", 3, 12, "ambition, haste, action" },
+  { "swqu", "Queen of Swords", 3, 13, "clear thinking, honesty, boundaries" },
+  { "swki", "King of Swords", 3, 14, "authority, intellect, truth" },
+  { "pe01", "Ace of Pentacles", 4, 1, "opportunity, prosperity, new start" },
+  { "pe02", "Two of Pentacles", 4, 2, "balance, adaptability, priorities" },
+  { "pe03", "Three of Pentacles", 4, 3, "teamwork, craft, learning" },
+  { "pe04", "Four of Pentacles", 4, 4, "security, control, saving" },
+  { "pe05", "Five of Pentacles", 4, 5, "hardship, loss, isolation" },
+  { "pe06", "Six of Pentacles", 4, 6, "generosity, charity, sharing" },
+  { "pe07", "Seven of Pentacles", 4, 7, "patience, investment, reward" },
+  { "pe08", "Eight of Pentacles", 4, 8, "diligence, skill, mastery" },
+  { "pe09", "Nine of Pentacles", 4, 9, "independence, luxury, self-worth" },
+  { "pe10", "Ten of Pentacles", 4, 10, "legacy, wealth, family" },
+  { "pepa", "Page of Pentacles", 4, 11, "ambition, study, manifestation" },
+  { "pekn", "Knight of Pentacles", 4, 12, "routine, efficiency, reliability" },
+  { "pequ", "Queen of Pentacles", 4, 13, "nurture, practicality, comfort" },
+  { "peki", "King of Pentacles", 4, 14, "abundance, security, discipline" },
+};
@@ -0,0 +1,47 @@
+// @knzet 2025
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <tarot.h>
+
+// ===================== DECK =====================
+// Shuffled once with Fisher-Yates, then drawn from the top in O(1).
+// Orientation is decided at shuffle time so the order of the remaining deck,
+// including reversals, is fixed until the next shuffle. The deck is saved to
+// NVS so a reading survives returning to PocketMage OS. The deck size is
+// set at shuffle time, up to the full 78 cards.
+class TarotDeck {
+public:
+  struct Card {
+    uint8_t index    = 0;
+    bool    reversed = false;
+  };
+
+  explicit TarotDeck() {}
+
+  void    setAllowReversed(bool allow) { allowReversed_ = allow; }
+  void    shuffle(uint8_t count);
+  bool    draw(Card& out);
+  // Card that the n-th next draw() will return, without drawing it
+  bool    peek(uint8_t n, Card& out) const;
+  uint8_t size()      const            { return count_; }
+  uint8_t remaining() const            { return count_ - top_; }
+
+  // NVS persistence, load() returns false if nothing valid was stored for a
+  // deck of count cards
+  bool load(uint8_t count);
+  void save() const;
+
+  // Unbiased random number in [0, n)
+  static uint32_t uniform(uint32_t n);
+
+private:
+  static constexpr const char* tag          = "TAROT_DECK";
+  static constexpr const char* nvsNamespace = "tarot";
+  static constexpr uint8_t     reversedFlag = 0x80; // stored in the top bit of each slot
+
+  std::array<uint8_t, TAROT_MAX_CARDS> order_ = {};
+  uint8_t                              count_ = 0;
+  uint8_t                              top_   = 0; // next slot to draw
+  bool                             allowReversed_ = true;
+};
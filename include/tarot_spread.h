@@ -0,0 +1,69 @@
+// @knzet 2025
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <tarot.h>
+
+#define TAROT_SPREAD_MAX_SLOTS 10 // Celtic Cross
+#define TAROT_MAX_SPREADS      8  // built-in plus SD spreads
+#define TAROT_SPREAD_DIR       "/assets/tarot/spreads"
+#define TAROT_LABEL_LEN        16
+
+// ===================== SPREAD LAYOUTS =====================
+// A spread is a declarative list of card slots. Each slot gives the card
+// centre in screen pixels (rotation 3, 320x240), a size class and a number
+// of clockwise quarter turns. Placements (top-left corner, rotated size and
+// overlap) are computed once when a spread is added and reused for every
+// draw, so rendering a spread is a straight walk over its slots.
+//
+// Extra spreads are read from TAROT_SPREAD_DIR/*.txt, one item per line:
+//   # comment
+//   name Celtic Cross
+//   card <cx> <cy> <size folder 1|3|5> <turns 0-3> <label>
+struct TarotSlot {
+  int16_t cx;
+  int16_t cy;
+  uint8_t size;   // TarotSize
+  uint8_t turns;  // clockwise quarter turns
+  char    label[TAROT_LABEL_LEN];
+};
+
+struct TarotPlacement {
+  int16_t x;
+  int16_t y;
+  int16_t w;       // after rotation
+  int16_t h;
+  bool    overlaps; // covers an earlier slot, clear before drawing
+};
+
+struct TarotSpread {
+  char           name[TAROT_NAME_LEN];
+  uint8_t        count = 0;
+  TarotSlot      slots[TAROT_SPREAD_MAX_SLOTS];
+  TarotPlacement placements[TAROT_SPREAD_MAX_SLOTS];
+};
+
+class TarotSpreads {
+public:
+  explicit TarotSpreads() {}
+
+  // Adds the built-in spreads, then any valid spreads found on SD
+  void begin(fs::FS* fileSys, int16_t screenW, int16_t screenH);
+
+  uint8_t            count() const        { return count_; }
+  const TarotSpread& get(uint8_t i) const { return spreads_[i < count_ ? i : 0]; }
+  // Index of the first spread with n cards, or 0
+  uint8_t            findByCount(uint8_t n) const;
+
+private:
+  static constexpr const char* tag = "TAROT_SPREAD";
+
+  bool add(const TarotSpread& spread);
+  bool loadFile(File& file, TarotSpread& out);
+  bool place(TarotSpread& spread) const;
+
+  int16_t     screenW_ = 320;
+  int16_t     screenH_ = 240;
+  uint8_t     count_   = 0;
+  TarotSpread spreads_[TAROT_MAX_SPREADS];
+};
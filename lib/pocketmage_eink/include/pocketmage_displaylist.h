@@ -0,0 +1,81 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <gfxfont.h>
+
+// ===================== DISPLAY LIST =====================
+// A retained list of draw commands, each with its screen bounding box.
+// Building a list doesn't touch the display, so it can be done on any task
+// (text is measured from the font tables, not with getTextBounds). Bad
+// commands are rejected when they are added. PocketmageEink::drawList()
+// replays the list into the frame buffer in one pass and registers each
+// command with the frame diff. It can also redraw just the commands that
+// touch a window.
+// Bitmap rows are referenced, not copied, and must stay valid until the list
+// has been drawn.
+class EinkDisplayList {
+public:
+  static constexpr uint8_t  maxCommands = 48;
+  static constexpr uint16_t textBytes   = 512;
+
+  enum Op : uint8_t {
+    OP_FILL_RECT = 0,
+    OP_DRAW_RECT,
+    OP_LINE,
+    OP_TEXT,
+    OP_BITMAP,          // 1-bpp rows, see PocketmageEink::blitBitmap()
+    OP_DITHERED_BITMAP, // 2 bit-plane rows, see PocketmageEink::blitDitheredBitmap()
+    OP_CALL,            // caller supplied drawing, see call()
+  };
+
+  // Draws the content of one call() box, with EINK() or the display
+  using DrawFn = void (*)(void* context);
+
+  struct Command {
+    Op             op;
+    uint8_t        size;      // text size, or quarter turns for bitmaps
+    uint16_t       color;
+    int16_t        a, b, c, d; // rect x, y, w, h / line x0, y0, x1, y1 / text cursor / bitmap x, y, w, h
+    int16_t        x, y, w, h; // bounding box in screen pixels
+    const void*    data;       // GFXfont for text, rows for bitmaps, context for calls
+    DrawFn         draw;       // call() only
+    uint16_t       text;       // offset into the text arena
+    uint16_t       length;     // text length
+  };
+
+  explicit EinkDisplayList() {}
+
+  void clear();
+  // Each returns false (and leaves ok() false) if the command was rejected
+  bool fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  bool drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  bool line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  bool text(int16_t x, int16_t y, const char* str, const GFXfont* font, uint8_t size, uint16_t color);
+  bool bitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns = 0);
+  bool ditheredBitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns = 0);
+  // Content the list can't hold, e.g. a card streamed from SD. fn must stay
+  // inside the box; in paged rendering it runs once per band the box
+  // touches. It is not diffed itself: blits it makes register as usual.
+  bool call(int16_t x, int16_t y, int16_t w, int16_t h, DrawFn fn, void* context);
+
+  // Same result as Adafruit_GFX::getTextBounds() without wrapping, for
+  // laying out text while building a list. nullptr is the built-in 6x8 font.
+  static void textBounds(const GFXfont* font, uint8_t size, const char* str, int16_t x, int16_t y,
+                         int16_t& x1, int16_t& y1, int16_t& w, int16_t& h);
+
+  bool           ok()    const { return ok_; }
+  uint8_t        count() const { return count_; }
+  const Command& get(uint8_t i) const { return commands_[i]; }
+  const char*    textOf(const Command& cmd) const { return text_ + cmd.text; }
+  // Bitmap payload size in bytes, 0 for other commands
+  static size_t  payloadBytes(const Command& cmd);
+
+private:
+  bool add_(const Command& cmd);
+
+  Command  commands_[maxCommands];
+  uint8_t  count_    = 0;
+  char     text_[textBytes];
+  uint16_t textUsed_ = 0;
+  bool     ok_       = true;
+};
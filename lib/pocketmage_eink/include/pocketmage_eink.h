@@ -9,8 +9,15 @@
 #pragma once
 #include <Arduino.h>
 #include <GxEPD2_BW.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <vector>
-#include <config.h> // for FULL_REFRESH_AFTER
+#include <pocketmage_ghost.h>
+#include <pocketmage_displaylist.h>
+#include <pocketmage_fontmetrics.h>
+#include <pocketmage_textwrap.h>
+#include <pocketmage_text.h>
+#include <config.h> // for FULL_REFRESH_AFTER, PARTIAL_WINDOW_MAX_PCT, EINK_PAGE_HEIGHT
 #pragma region fonts
 // FONTS
 // 3x7
@@ -31,7 +38,15 @@
 
 // Type alias for readability
 using PanelT   = GxEPD2_310_GDEQ031T10;
-using DisplayT = GxEPD2_BW<PanelT, PanelT::HEIGHT>;
+using DisplayT = GxEPD2_BW<PanelT, EINK_PAGE_HEIGHT>;
+
+// Async refresh progress, see refreshAsync()
+enum RefreshState : uint8_t {
+  REFRESH_IDLE = 0,      // frame buffer free, panel asleep
+  REFRESH_TRANSFERRING,  // frame buffer being sent to the controller
+  REFRESH_WAITING_BUSY,  // panel running a waveform, BUSY high
+  REFRESH_SETTLING,      // pause between passes / before hibernate
+};
 
 // ===================== EINK CLASS =====================
 class PocketmageEink {
@@ -39,11 +54,11 @@ public:
   explicit PocketmageEink(DisplayT& display) : display_(display) {}
 
   // Wire up external buffers/state used to read from globals
-  void setTextBuffer(std::vector<String>* lines)                            { lines_ = lines; };               // reference to allLines
+  void setTextBuffer(TextDocument* lines)                                   { lines_ = lines; };               // reference to allLines
   void setEditingFilePtr(String* editingFile)                   { editingFile_ = editingFile; };               // reference to editingFile string
   void setDynamicScroll(volatile long* dynamicScroll)       { dynamicScroll_ = dynamicScroll; };     // reference to dynamicScroll
   void setLineSpacing(uint8_t lineSpacing)                      { lineSpacing_ = lineSpacing; };                                 // reference to lineSpacing (default 6)
-  void setFullRefreshAfter(uint8_t fullRefreshAfter)  { fullRefreshAfter_ = fullRefreshAfter; };                              // reference to FULL_REFRESH_AFTER (default 5)
+  void setFullRefreshAfter(uint8_t fullRefreshAfter)  { fullRefreshAfter_ = fullRefreshAfter; ghost_.setUpdatesBeforeFull(fullRefreshAfter); };                              // reference to FULL_REFRESH_AFTER (default 5)
   void setCurrentFont(const GFXfont* font){
   if (currentFont_ == font) return; 
     currentFont_ = font;
@@ -52,6 +67,20 @@ public:
   // Main display functions
   void refresh();
   void multiPassRefresh(int passes);
+  // Non-blocking multiPassRefresh(), runs on a worker task. The frame buffer
+  // belongs to the worker until the refresh finishes: call beginFrame()
+  // before drawing the next frame. Unlike multiPassRefresh() the frame is
+  // kept, and a small dirty area is sent as a byte-aligned partial window.
+  bool refreshAsync(int passes);
+  // Drop the remaining passes of a running refresh (the pass in flight
+  // always completes, the panel can't be stopped mid-waveform)
+  void cancelRefresh();
+  // Coalesce: cancel what is left of a stale refresh, then wait until the
+  // frame buffer can be drawn into. Returns false on timeout.
+  bool beginFrame(uint32_t timeoutMs = UINT32_MAX);
+  RefreshState refreshState()       const { return refreshState_; }
+  uint8_t      refreshPass()        const { return refreshPass_; }
+  uint32_t     coalescedRefreshes() const { return coalesced_; }
   void setFastFullRefresh(bool setting);
   void statusBar(const String& input, bool fullWindow=false);
   void drawStatusBar(const String& input);
@@ -59,6 +88,50 @@ public:
   void setTXTFont(const GFXfont* font);
   void einkTextDynamic(bool doFull, bool noRefresh=false);
   int  countLines(const String& input, size_t maxLineLength = 29);
+  // Pen width of text in the current font, from FontMetrics
+  uint16_t textWidth(const String& text) const { return FontMetrics::of(currentFont_).textWidth(text); }
+  void blitBitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns = 0);
+  // blitBitmap() for 2-bit rows: each row holds the high bit-plane then the
+  // low bit-plane (level 3 = black, 0 = white). The panel only has black
+  // and white, and extra partial passes don't make grey (a pixel already
+  // black isn't driven again), so the levels are ordered-dithered to 1 bit
+  // and drawn in one pass: light grey inks 1 pixel in 4, dark grey 3.
+  void blitDitheredBitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns = 0);
+  void clearRect(int16_t x, int16_t y, int16_t w, int16_t h);
+  // Replays a display list into the frame buffer. Each command becomes a
+  // frame item, so commands that didn't change cost no panel time. The
+  // window form redraws only what touches x, y, w, h (grown to cover every
+  // command drawn) on a cleared background, and skips the rest of the list.
+  // Text leaves the display at text size 1 and the current font.
+  void drawList(const EinkDisplayList& list);
+  void drawList(const EinkDisplayList& list, int16_t x, int16_t y, int16_t w, int16_t h);
+
+  // Paged rendering, for a frame buffer smaller than the screen
+  // (EINK_PAGE_HEIGHT). There is no retained frame to draw into, so the
+  // whole list is replayed once per band with the commands outside the band
+  // culled, and again for each of `passes` partial passes. GxEPD2 loops
+  // over the bands twice on this panel, the second time to fill the RAM the
+  // next partial refresh is diffed against. Blocking.
+  bool paged() const { return display_.pages() > 1; }
+  void renderPaged(const EinkDisplayList& list, int passes = 0);
+
+  // Dirty tracking. blitBitmap() and clearRect() are recorded as frame
+  // items and diffed against the last frame refreshAsync() pushed, so
+  // content redrawn unchanged costs no panel time. Direct display drawing
+  // has to be marked by the caller, or registered with trackItem() and a
+  // key that identifies its content so it can be diffed as well.
+  void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+  void markAllDirty() { markDirty(0, 0, display_.width(), display_.height()); }
+  void trackItem(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t key);
+  // The buffer no longer matches the last pushed frame (e.g. after refresh())
+  void invalidateFrame();
+  // Union of everything drawn since the last refresh, before diffing
+  bool dirtyRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+  uint32_t skippedRefreshes() const { return skipped_; }
+  const GhostScheduler& ghosting() const { return ghost_; }
+  uint32_t bytesSaved()       const { return bytesSaved_; }
+  // FNV-1a, for trackItem() keys
+  static uint32_t hashBytes(const void* data, size_t len, uint32_t seed = 2166136261u);
 
   // getters 
   uint8_t maxCharsPerLine() const;
@@ -70,13 +143,49 @@ public:
 
 
 private:
+  static constexpr const char* tag = "EINK";
+
+  struct FrameRect {
+    int16_t x = 0, y = 0, w = 0, h = 0;
+    bool empty() const { return w <= 0 || h <= 0; }
+  };
+  struct FrameItem {
+    FrameRect rect;
+    uint32_t  key;
+    int32_t   ink;   // black pixels, GhostScheduler::unknownFlips if unknown
+  };
+  static constexpr uint8_t maxFrameItems  = 48;
+  static constexpr uint8_t maxFrameClears = 16;
+
+  FrameRect clip_(int16_t x, int16_t y, int16_t w, int16_t h) const;
+  static FrameRect unite_(const FrameRect& a, const FrameRect& b);
+  static bool intersects_(const FrameRect& a, const FrameRect& b);
+  static bool contains_(const FrameRect& outer, const FrameRect& inner);
+  static bool sameItem_(const FrameItem* list, uint8_t count, const FrameItem& item);
+  void addItem_(const FrameRect& rect, uint32_t key, int32_t ink);
+  void charge_(const FrameRect& rect, int32_t ink, bool erased = false);
+  void syncGhost_();
+  bool touched_(const FrameRect& rect) const;
+  void drawCommand_(const EinkDisplayList& list, const EinkDisplayList::Command& cmd);
+  FrameRect diffFrame_();
+
+  static void rotate_(int16_t px, int16_t py, int16_t w, int16_t h, uint8_t quarterTurns, int16_t& sx, int16_t& sy);
+
+  FrameRect pageBand_(uint16_t page) const;
+
+  bool startRefreshTask_();
+  bool takeWindow_();
+  void runPasses_(int passes, bool keepFrame);
+  static void refreshWorker_(void* parameter);
+  static void busyCallback_(const void* parameter);
+
   DisplayT&             display_; // class reference to hardware display object
   bool                  forceSlowFullUpdate_  = false;
-  uint8_t               partialCounter_       = 0;
+  GhostScheduler        ghost_;
   const GFXfont*        currentFont_          = nullptr;
   uint8_t               fullRefreshAfter_     = FULL_REFRESH_AFTER;
 
-  std::vector<String>*  lines_                = nullptr;
+  TextDocument*         lines_                = nullptr;
   String*               editingFile_          = nullptr;
 
   volatile long*        dynamicScroll_        = nullptr;
@@ -86,6 +195,30 @@ private:
   uint8_t               maxCharsPerLine_      = 0;
   uint8_t               maxLines_             = 0;
   uint8_t               fontHeight_           = 0;
+
+  // async refresh, frameFree_ is held by whoever owns the frame buffer
+  TaskHandle_t          refreshTask_          = nullptr;
+  SemaphoreHandle_t     frameFree_            = nullptr;
+  volatile RefreshState refreshState_         = REFRESH_IDLE;
+  volatile uint8_t      refreshPass_          = 0;
+  volatile int          refreshPasses_        = 0;
+  volatile bool         cancelRefresh_        = false;
+  volatile uint32_t     coalesced_            = 0;
+
+  // frame tracking in screen coordinates
+  FrameRect             marked_;                   // untracked drawing
+  FrameItem             items_[maxFrameItems];     // drawn since the last refresh
+  uint8_t               itemCount_            = 0;
+  FrameRect             clears_[maxFrameClears];
+  uint8_t               clearCount_           = 0;
+  FrameItem             lastItems_[maxFrameItems]; // on the panel
+  uint8_t               lastCount_            = 0;
+  bool                  frameInvalid_         = true;
+  uint32_t              skipped_              = 0;
+  uint32_t              bytesSaved_           = 0;
+
+  // partial window of the refresh in flight, w == 0 for a full refresh
+  int16_t               windowX_ = 0, windowY_ = 0, windowW_ = 0, windowH_ = 0;
 };
 
 void wireEink();
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include <gfxfont.h>
+
+// ===================== FONT METRICS =====================
+// Per-font layout metrics read straight from the GFXfont glyph table, so text
+// can be measured without rasterising bounding boxes with getTextBounds().
+// A font's entry is built the first time it is asked for and kept for the
+// rest of the run; after that every width lookup is a table read.
+// Widths are pen advances (what a line of text takes up), not ink bounds.
+struct FontMetrics {
+  static constexpr uint8_t first = 0x20; // ' '
+  static constexpr uint8_t last  = 0x7E; // '~'
+
+  const GFXfont* font       = nullptr;   // nullptr is the built-in 6x8 font
+  uint8_t        advance[last - first + 1] = {};
+  int8_t         ascent     = 0;         // tallest glyph above the baseline
+  int8_t         descent    = 0;         // deepest glyph below it
+  uint8_t        lineHeight = 0;         // baseline to baseline
+  uint8_t        capHeight  = 0;         // height of 'H'
+  uint8_t        avgAdvance = 0;         // mean advance of 'a'-'z'
+
+  // Metrics for a font, built on first use
+  static const FontMetrics& of(const GFXfont* font);
+
+  uint8_t  charWidth(char c) const {
+    return ((uint8_t)c >= first && (uint8_t)c <= last) ? advance[(uint8_t)c - first] : 0;
+  }
+  uint16_t textWidth(const char* text, size_t len) const;
+  uint16_t textWidth(const char* text) const   { return textWidth(text, text ? strlen(text) : 0); }
+  uint16_t textWidth(const String& text) const { return textWidth(text.c_str(), text.length()); }
+
+private:
+  static constexpr uint8_t maxFonts = 16;
+  void build(const GFXfont* f);
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+
+// ===================== GHOST SCHEDULER =====================
+// Decides when the panel needs a slow full refresh. The screen is split into
+// tiles, and every fast update charges the tiles it covers a fixed cost plus
+// the share of their pixels it flipped. A slow full refresh is due once any
+// tile crosses the limit, so regions that never change never force one.
+// Plain C++ with no Arduino dependencies, so it can be driven on the host.
+class GhostScheduler {
+public:
+  static constexpr uint8_t  tileSize     = 40;
+  static constexpr uint8_t  maxTiles     = 64; // 320x240 -> 8x6
+  static constexpr uint16_t updateCost   = 16; // per fast update of a tile
+  static constexpr uint16_t flipCost     = 64; // for flipping a whole tile
+  static constexpr int32_t  unknownFlips = -1; // assume half the pixels flipped
+
+  void begin(int16_t width, int16_t height);
+  // Slow full refresh after `updates` fast full-screen updates of unknown
+  // content, the same cadence as the old fixed FULL_REFRESH_AFTER counter
+  void setUpdatesBeforeFull(uint8_t updates);
+
+  // One fast update: ink drawn and ink erased (black pixels, or
+  // unknownFlips) per rect, then endUpdate() charges the tiles it touched
+  void beginUpdate();
+  void addInk(int16_t x, int16_t y, int16_t w, int16_t h, int32_t ink, bool erased = false);
+  void endUpdate();
+  // Shorthand for a single-rect update
+  void addUpdate(int16_t x, int16_t y, int16_t w, int16_t h, int32_t flips);
+
+  bool needsFull() const { return maxScore_ >= limit_; }
+  // A slow full refresh cleared all ghosting
+  void fullDone();
+
+  uint16_t maxScore() const { return maxScore_; }
+  uint16_t limit()    const { return limit_; }
+  uint16_t tileScore(uint8_t col, uint8_t row) const;
+  uint8_t  cols()     const { return cols_; }
+  uint8_t  rows()     const { return rows_; }
+  int16_t  width()    const { return width_; }
+  int16_t  height()   const { return height_; }
+
+private:
+  static int16_t min16(int16_t a, int16_t b) { return a < b ? a : b; }
+  static int16_t max16(int16_t a, int16_t b) { return a > b ? a : b; }
+
+  int16_t  width_    = 0;
+  int16_t  height_   = 0;
+  uint8_t  cols_     = 0;
+  uint8_t  rows_     = 0;
+  int16_t  tileW_    = 0;
+  int16_t  tileH_    = 0;
+  uint16_t limit_    = 5 * (updateCost + flipCost / 2);
+  uint16_t maxScore_ = 0;
+  uint16_t scores_[maxTiles] = {};
+
+  // Current update, per tile
+  bool     touched_[maxTiles] = {};
+  int32_t  inkOn_[maxTiles]   = {};
+  int32_t  inkOff_[maxTiles]  = {};
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <pocketmage_fontmetrics.h>
+
+// ===================== TEXT WRAP =====================
+// Splits text into display lines in one pass. The pen width of the current
+// line is kept as characters go by, using the FontMetrics advances, and
+// lines are handed out as (offset, length) spans of the input instead of
+// being copied char by char.
+//
+// A line is full once its width reaches maxWidth; the next character then
+// starts a new line at the last space (the space is dropped), or right
+// after a trailing space, or mid-word when the line has no space at all.
+// '\n' ends the current line; blank lines are skipped.
+class TextWrap {
+public:
+  using SpanFn = std::function<void(size_t offset, size_t length)>;
+
+  static void wrap(const char* text, size_t len, const FontMetrics& metrics, uint16_t maxWidth, const SpanFn& emit);
+};
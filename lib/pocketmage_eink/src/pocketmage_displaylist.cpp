@@ -0,0 +1,138 @@
+#include <pocketmage_displaylist.h>
+#include <string.h>
+
+// ===================== main functions =====================
+void EinkDisplayList::clear() {
+  count_    = 0;
+  textUsed_ = 0;
+  ok_       = true;
+}
+
+bool EinkDisplayList::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  return add_({OP_FILL_RECT, 0, color, x, y, w, h, x, y, w, h, nullptr, nullptr, 0, 0});
+}
+
+bool EinkDisplayList::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  return add_({OP_DRAW_RECT, 0, color, x, y, w, h, x, y, w, h, nullptr, nullptr, 0, 0});
+}
+
+bool EinkDisplayList::line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  const int16_t x = x0 < x1 ? x0 : x1;
+  const int16_t y = y0 < y1 ? y0 : y1;
+  const int16_t w = (x0 < x1 ? x1 - x0 : x0 - x1) + 1;
+  const int16_t h = (y0 < y1 ? y1 - y0 : y0 - y1) + 1;
+  return add_({OP_LINE, 0, color, x0, y0, x1, y1, x, y, w, h, nullptr, nullptr, 0, 0});
+}
+
+bool EinkDisplayList::text(int16_t x, int16_t y, const char* str, const GFXfont* font, uint8_t size, uint16_t color) {
+  if (!str || size == 0) {
+    ok_ = false;
+    return false;
+  }
+  const size_t len = strlen(str);
+  if (textUsed_ + len + 1 > textBytes) {
+    ok_ = false;
+    return false;
+  }
+  int16_t bx, by, bw, bh;
+  textBounds(font, size, str, x, y, bx, by, bw, bh);
+  if (!add_({OP_TEXT, size, color, x, y, 0, 0, bx, by, bw, bh, font, nullptr, textUsed_, (uint16_t)len})) return false;
+  memcpy(text_ + textUsed_, str, len + 1);
+  textUsed_ += len + 1;
+  return true;
+}
+
+bool EinkDisplayList::bitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns) {
+  quarterTurns &= 3;
+  const bool side = quarterTurns & 1;
+  return add_({OP_BITMAP, quarterTurns, 0, x, y, w, h, x, y, side ? h : w, side ? w : h, rows, nullptr, 0, 0});
+}
+
+bool EinkDisplayList::ditheredBitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns) {
+  quarterTurns &= 3;
+  const bool side = quarterTurns & 1;
+  return add_({OP_DITHERED_BITMAP, quarterTurns, 0, x, y, w, h, x, y, side ? h : w, side ? w : h, rows, nullptr, 0, 0});
+}
+
+bool EinkDisplayList::call(int16_t x, int16_t y, int16_t w, int16_t h, DrawFn fn, void* context) {
+  if (!fn) {
+    ok_ = false;
+    return false;
+  }
+  return add_({OP_CALL, 0, 0, x, y, w, h, x, y, w, h, context, fn, 0, 0});
+}
+
+void EinkDisplayList::textBounds(const GFXfont* font, uint8_t size, const char* str, int16_t x, int16_t y,
+                                 int16_t& x1, int16_t& y1, int16_t& w, int16_t& h) {
+  int16_t minx = 0x7FFF, miny = 0x7FFF, maxx = -1, maxy = -1;
+  int16_t cx = x, cy = y;
+  for (const char* p = str; p && *p; p++) {
+    const uint8_t c = *p;
+    if (!font) {
+      // Built-in font: 6x8 cells, cursor at the top left
+      if (c == '\n') {
+        cx = x;
+        cy += 8 * size;
+        continue;
+      }
+      if (c == '\r') continue;
+      minx = cx < minx ? cx : minx;
+      miny = cy < miny ? cy : miny;
+      maxx = cx + 6 * size - 1 > maxx ? cx + 6 * size - 1 : maxx;
+      maxy = cy + 8 * size - 1 > maxy ? cy + 8 * size - 1 : maxy;
+      cx += 6 * size;
+      continue;
+    }
+
+    // GFX fonts: cursor on the baseline, glyph boxes are offsets from it
+    if (c == '\n') {
+      cx = x;
+      cy += font->yAdvance * size;
+      continue;
+    }
+    if (c == '\r' || c < font->first || c > font->last) continue;
+    const GFXglyph& g = font->glyph[c - font->first];
+    if (g.width && g.height) {
+      const int16_t gx0 = cx + g.xOffset * size;
+      const int16_t gy0 = cy + g.yOffset * size;
+      const int16_t gx1 = gx0 + g.width * size - 1;
+      const int16_t gy1 = gy0 + g.height * size - 1;
+      minx = gx0 < minx ? gx0 : minx;
+      miny = gy0 < miny ? gy0 : miny;
+      maxx = gx1 > maxx ? gx1 : maxx;
+      maxy = gy1 > maxy ? gy1 : maxy;
+    }
+    cx += g.xAdvance * size;
+  }
+
+  if (maxx < minx) {
+    x1 = x;
+    y1 = y;
+    w = h = 0;
+    return;
+  }
+  x1 = minx;
+  y1 = miny;
+  w  = maxx - minx + 1;
+  h  = maxy - miny + 1;
+}
+
+size_t EinkDisplayList::payloadBytes(const Command& cmd) {
+  const size_t rowBytes = (size_t)(cmd.c + 7) / 8;
+  if (cmd.op == OP_BITMAP)      return rowBytes * cmd.d;
+  if (cmd.op == OP_DITHERED_BITMAP) return rowBytes * 2 * cmd.d;
+  return 0;
+}
+
+// ===================== private functions =====================
+bool EinkDisplayList::add_(const Command& cmd) {
+  const bool bitmap = cmd.op == OP_BITMAP || cmd.op == OP_DITHERED_BITMAP;
+  // Blank text is fine, it just draws nothing
+  const bool empty  = cmd.op != OP_TEXT && (cmd.w <= 0 || cmd.h <= 0);
+  if (count_ >= maxCommands || empty || (bitmap && !cmd.data)) {
+    ok_ = false;
+    return false;
+  }
+  commands_[count_++] = cmd;
+  return true;
+}
@@ -10,16 +10,23 @@
 
 // ===================== main functions =====================
 void PocketmageEink::refresh() {
-  // USE A SLOW FULL UPDATE EVERY N FAST UPDATES OR WHEN SPECIFIED
-  if ((partialCounter_ >= fullRefreshAfter_) || forceSlowFullUpdate_) {
+  // USE A SLOW FULL UPDATE ONCE GHOSTING BUILDS UP OR WHEN SPECIFIED
+  syncGhost_();
+  if (ghost_.needsFull() || forceSlowFullUpdate_) {
     forceSlowFullUpdate_ = false;
-    partialCounter_ = 0;
+    ghost_.fullDone();
     setFastFullRefresh(false);
   } 
-  // OTHERWISE USE A FAST FULL UPDATE
+  // OTHERWISE USE A FAST FULL UPDATE, charged to what was marked as drawn
   else {
     setFastFullRefresh(true);
-    partialCounter_++;
+    int16_t x, y, w, h;
+    if (!dirtyRect(x, y, w, h)) {
+      x = y = 0;
+      w = display_.width();
+      h = display_.height();
+    }
+    ghost_.addUpdate(x, y, w, h, GhostScheduler::unknownFlips);
   }
 
   display_.display(false);
@@ -27,20 +34,44 @@ void PocketmageEink::refresh() {
   display_.setFullWindow();
   display_.fillScreen(GxEPD_WHITE);
   display_.hibernate();
+  invalidateFrame();
 }
 void PocketmageEink::multiPassRefresh(int passes) {
-  display_.display(false);
-  if (passes > 0) {
-    for (int i = 0; i < passes; i++) {
-      delay(250);
-      display_.display(true);
-    }
+  // Wait out any async refresh still using the buffer
+  if (frameFree_) xSemaphoreTake(frameFree_, portMAX_DELAY);
+  windowW_ = 0;
+  invalidateFrame();
+  runPasses_(passes, false);
+  if (frameFree_) xSemaphoreGive(frameFree_);
+}
+bool PocketmageEink::refreshAsync(int passes) {
+  if (!startRefreshTask_()) {
+    multiPassRefresh(passes);
+    return false;
   }
-
-  delay(100);
-  display_.setFullWindow();
-  display_.fillScreen(GxEPD_WHITE);
-  display_.hibernate();
+  // Normally free already, beginFrame() waited for the previous refresh
+  xSemaphoreTake(frameFree_, portMAX_DELAY);
+  if (!takeWindow_()) {
+    // Nothing changed since the last refresh
+    xSemaphoreGive(frameFree_);
+    return true;
+  }
+  refreshPasses_ = passes;
+  cancelRefresh_ = false;
+  refreshState_  = REFRESH_TRANSFERRING;
+  xTaskNotifyGive(refreshTask_);
+  return true;
+}
+void PocketmageEink::cancelRefresh() {
+  if (refreshState_ != REFRESH_IDLE) cancelRefresh_ = true;
+}
+bool PocketmageEink::beginFrame(uint32_t timeoutMs) {
+  if (!frameFree_) return true;
+  cancelRefresh();
+  const TickType_t ticks = (timeoutMs == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+  if (xSemaphoreTake(frameFree_, ticks) != pdTRUE) return false;
+  xSemaphoreGive(frameFree_);
+  return true;
 }
 void PocketmageEink::setFastFullRefresh(bool setting) {
   PanelT::useFastFullUpdate = setting;
@@ -68,16 +99,11 @@ void PocketmageEink::drawStatusBar(const String& input) {
   display_.print(input);
 }
 void PocketmageEink::computeFontMetrics_() {
-  int16_t x1, y1; 
-  uint16_t charWidth, charHeight;
-  // GET AVERAGE CHAR WIDTH
-  display_.getTextBounds("abcdefghijklmnopqrstuvwxyz", 0, 0, &x1, &y1, &charWidth, &charHeight);
-  charWidth = charWidth / 52; // check if intended 
-  maxCharsPerLine_  = display_.width() / charWidth;
-
-  display_.getTextBounds("H", 0, 0, &x1, &y1, &charWidth, &charHeight);
-  fontHeight_ = charHeight;
-  maxLines_   = (display_.height() - 26) / (fontHeight_ + lineSpacing_);
+  const FontMetrics& metrics = FontMetrics::of(currentFont_);
+  // Average advance of a-z, 29 chars of FreeMonoBold9pt7b per line
+  maxCharsPerLine_ = display_.width() / metrics.avgAdvance;
+  fontHeight_      = metrics.capHeight;
+  maxLines_        = (display_.height() - 26) / (fontHeight_ + lineSpacing_);
 }
 void PocketmageEink::setTXTFont(const GFXfont* font) {
   // SET THE FONT
@@ -107,21 +133,25 @@ void PocketmageEink::einkTextDynamic(bool doFull, bool noRefresh) {
   if (doFull) {
     display_.fillScreen(GxEPD_WHITE);
     for (uint8_t i = size - displayLines - scrollOffset; i < size - scrollOffset; i++) {
-      if ((*lines_)[i].length() == 0) continue;
+      const TextLine line = lines_->line(i);
+      if (line.size() == 0) continue;
       display_.setFullWindow();
       //display_.fillRect(0, (fontHeight_ + lineSpacing_) * (i - (size - displayLines - scrollOffset)), display.width(), (fontHeight_ + lineSpacing_), GxEPD_WHITE)
       display_.setCursor(0, fontHeight_ + ((fontHeight_ + lineSpacing_) * (i - (size - displayLines - scrollOffset))));
-      display_.print((*lines_)[i]);
+      display_.write((const uint8_t*)line.data, line.length);
+      display_.write((const uint8_t*)line.tail, line.tailLength);
     }
   } 
   // PARTIAL REFRESH, ONLY SEND LAST LINE
   else {
-    if ((*lines_)[size - displayLines - scrollOffset].length() > 0) {
+    const TextLine line = lines_->line(size - displayLines - scrollOffset);
+    if (line.size() > 0) {
       int y = (fontHeight_ + lineSpacing_) * (size - displayLines - scrollOffset);
       display_.setPartialWindow(0, y, display_.width(), (fontHeight_ + lineSpacing_));
       display_.fillRect(0, y, display_.width(), (fontHeight_ + lineSpacing_), GxEPD_WHITE);
       display_.setCursor(0, fontHeight_ + y);
-      display_.print((*lines_)[size - displayLines - scrollOffset]);
+      display_.write((const uint8_t*)line.data, line.length);
+      display_.write((const uint8_t*)line.tail, line.tailLength);
     }
   }
   
@@ -147,8 +177,484 @@ int PocketmageEink::countLines(const String& input, size_t maxLineLength) {
 
   return lineCounter;
 }
+// Draws pre-packed 1-bpp rows (MSB first, set bit = black) into the frame buffer.
+// Only ink is written, so the target area must already be white (e.g. after fillScreen).
+// GxEPD2_BW keeps its buffer private and the panel is rotated, so rows can't be
+// memcpy'd in; instead white bytes are skipped whole and set bits are walked directly
+// rather than going through drawBitmap's per-pixel loop with a background color.
+// quarterTurns rotates the bitmap clockwise about its own origin (x, y stays the top-left).
+void PocketmageEink::blitBitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns) {
+  if (!rows) return;
+  quarterTurns &= 3;
+  const int16_t rowBytes = (w + 7) / 8;
+  const uint32_t key = hashBytes(&quarterTurns, 1, hashBytes(rows, (size_t)rowBytes * h));
+  int32_t ink = 0;
+  for (int16_t j = 0; j < h; j++) {
+    const uint8_t* row = rows + j * rowBytes;
+    for (int16_t i = 0; i < rowBytes; i++) {
+      uint8_t b = row[i];
+      // mask padding bits past the bitmap width
+      if (i == rowBytes - 1 && (w & 7)) b &= (uint8_t)(0xFF << (8 - (w & 7)));
+      ink += __builtin_popcount(b);
+      while (b) {
+        const uint8_t bit = __builtin_clz(b) - 24;
+        int16_t sx, sy;
+        rotate_(i * 8 + bit, j, w, h, quarterTurns, sx, sy);
+        display_.drawPixel(x + sx, y + sy, GxEPD_BLACK);
+        b &= ~(0x80 >> bit);
+      }
+    }
+  }
+  if (quarterTurns & 1) addItem_(clip_(x, y, h, w), key, ink);
+  else                  addItem_(clip_(x, y, w, h), key, ink);
+}
+void PocketmageEink::blitDitheredBitmap(int16_t x, int16_t y, const uint8_t* rows, int16_t w, int16_t h, uint8_t quarterTurns) {
+  if (!rows) return;
+  quarterTurns &= 3;
+  const int16_t rowBytes = (w + 7) / 8;
+  const uint32_t key = hashBytes(&quarterTurns, 1, hashBytes(rows, (size_t)rowBytes * 2 * h));
+  // 2x2 ordered dither in screen coordinates, so neighbouring cards line up:
+  // light grey inks 1 pixel of 4, dark grey 3, black all of them
+  static const uint8_t bayer[2][2] = { { 0, 2 }, { 3, 1 } };
+  static const uint8_t inked[4]    = { 0, 1, 3, 4 };
+  int32_t ink = 0;
+  for (int16_t j = 0; j < h; j++) {
+    const uint8_t* hi = rows + (size_t)j * 2 * rowBytes;
+    const uint8_t* lo = hi + rowBytes;
+    for (int16_t i = 0; i < rowBytes; i++) {
+      uint8_t b = hi[i] | lo[i];
+      if (i == rowBytes - 1 && (w & 7)) b &= (uint8_t)(0xFF << (8 - (w & 7)));
+      while (b) {
+        const uint8_t bit   = __builtin_clz(b) - 24;
+        const uint8_t mask  = 0x80 >> bit;
+        const uint8_t level = ((hi[i] & mask) ? 2 : 0) | ((lo[i] & mask) ? 1 : 0);
+        int16_t sx, sy;
+        rotate_(i * 8 + bit, j, w, h, quarterTurns, sx, sy);
+        const int16_t px = x + sx, py = y + sy;
+        if (bayer[py & 1][px & 1] < inked[level]) {
+          display_.drawPixel(px, py, GxEPD_BLACK);
+          ink++;
+        }
+        b &= ~mask;
+      }
+    }
+  }
+  if (quarterTurns & 1) addItem_(clip_(x, y, h, w), key, ink);
+  else                  addItem_(clip_(x, y, w, h), key, ink);
+}
+void PocketmageEink::clearRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  display_.fillRect(x, y, w, h, GxEPD_WHITE);
+  const FrameRect rect = clip_(x, y, w, h);
+  if (rect.empty()) return;
+  if (clearCount_ < maxFrameClears) clears_[clearCount_++] = rect;
+  else                              marked_ = unite_(marked_, rect);
+}
+void PocketmageEink::drawList(const EinkDisplayList& list) {
+  for (uint8_t i = 0; i < list.count(); i++) drawCommand_(list, list.get(i));
+  display_.setTextSize(1);
+  display_.setFont(currentFont_);
+}
+void PocketmageEink::drawList(const EinkDisplayList& list, int16_t x, int16_t y, int16_t w, int16_t h) {
+  // Grow the window until it holds every command that touches it, then
+  // everything inside it can be redrawn in list order on a clean background
+  // without disturbing the pixels outside
+  FrameRect window = clip_(x, y, w, h);
+  for (bool grown = true; grown && !window.empty();) {
+    grown = false;
+    for (uint8_t i = 0; i < list.count(); i++) {
+      const EinkDisplayList::Command& cmd = list.get(i);
+      const FrameRect box = clip_(cmd.x, cmd.y, cmd.w, cmd.h);
+      if (intersects_(window, box) && !contains_(window, box)) {
+        window = unite_(window, box);
+        grown  = true;
+      }
+    }
+  }
+  if (window.empty()) return;
+
+  clearRect(window.x, window.y, window.w, window.h);
+  for (uint8_t i = 0; i < list.count(); i++) {
+    const EinkDisplayList::Command& cmd = list.get(i);
+    if (intersects_(window, clip_(cmd.x, cmd.y, cmd.w, cmd.h))) drawCommand_(list, cmd);
+  }
+  display_.setTextSize(1);
+  display_.setFont(currentFont_);
+}
+void PocketmageEink::renderPaged(const EinkDisplayList& list, int passes) {
+  if (frameFree_) xSemaphoreTake(frameFree_, portMAX_DELAY);
+  syncGhost_();
+  if (ghost_.needsFull() || forceSlowFullUpdate_) {
+    forceSlowFullUpdate_ = false;
+    ghost_.fullDone();
+    setFastFullRefresh(false);
+  }
+  else {
+    setFastFullRefresh(true);
+    ghost_.addUpdate(0, 0, display_.width(), display_.height(), GhostScheduler::unknownFlips);
+  }
+
+  for (int pass = 0; pass <= max(passes, 0); pass++) {
+    if (pass > 0) {
+      vTaskDelay(pdMS_TO_TICKS(250));
+      display_.setPartialWindow(0, 0, display_.width(), display_.height());
+    }
+    else {
+      display_.setFullWindow();
+    }
+    // A fast-partial panel runs the loop twice, the second time to write
+    // the previous-frame RAM, so the band wraps around after the last page
+    uint16_t page = 0;
+    display_.firstPage();
+    do {
+      const FrameRect band = pageBand_(page++ % display_.pages());
+      display_.fillScreen(GxEPD_WHITE);
+      for (uint8_t i = 0; i < list.count(); i++) {
+        const EinkDisplayList::Command& cmd = list.get(i);
+        if (intersects_(band, clip_(cmd.x, cmd.y, cmd.w, cmd.h))) drawCommand_(list, cmd);
+      }
+    } while (display_.nextPage());
+  }
+  display_.setTextSize(1);
+  display_.setFont(currentFont_);
+
+  vTaskDelay(pdMS_TO_TICKS(100));
+  display_.hibernate();
+  // Nothing of the frame is retained, the items drawn mean nothing now
+  invalidateFrame();
+  if (frameFree_) xSemaphoreGive(frameFree_);
+}
+void PocketmageEink::markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+  marked_ = unite_(marked_, clip_(x, y, w, h));
+}
+void PocketmageEink::trackItem(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t key) {
+  addItem_(clip_(x, y, w, h), key, GhostScheduler::unknownFlips);
+}
+void PocketmageEink::invalidateFrame() {
+  marked_       = FrameRect();
+  itemCount_    = 0;
+  clearCount_   = 0;
+  lastCount_    = 0;
+  frameInvalid_ = true;
+}
+bool PocketmageEink::dirtyRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const {
+  FrameRect all = marked_;
+  for (uint8_t i = 0; i < itemCount_; i++)  all = unite_(all, items_[i].rect);
+  for (uint8_t i = 0; i < clearCount_; i++) all = unite_(all, clears_[i]);
+  if (all.empty()) return false;
+  x = all.x;
+  y = all.y;
+  w = all.w;
+  h = all.h;
+  return true;
+}
+uint32_t PocketmageEink::hashBytes(const void* data, size_t len, uint32_t seed) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  uint32_t hash = seed;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
 void PocketmageEink::forceSlowFullUpdate(bool force)            { forceSlowFullUpdate_ = force; }
 
+// ===================== private functions =====================
+// Bitmap pixel (px, py) of a w x h bitmap turned clockwise about its origin
+void PocketmageEink::rotate_(int16_t px, int16_t py, int16_t w, int16_t h, uint8_t quarterTurns, int16_t& sx, int16_t& sy) {
+  switch (quarterTurns & 3) {
+    case 0: sx = px;         sy = py;         break;
+    case 1: sx = h - 1 - py; sy = px;         break;
+    case 2: sx = w - 1 - px; sy = h - 1 - py; break;
+    case 3: sx = py;         sy = w - 1 - px; break;
+  }
+}
+// Screen area of one page of a paged frame buffer. Pages are bands of
+// panel rows, which run across the screen when it is rotated.
+PocketmageEink::FrameRect PocketmageEink::pageBand_(uint16_t page) const {
+  const int16_t y0 = page * display_.pageHeight();
+  const int16_t y1 = min<int16_t>(y0 + display_.pageHeight(), PanelT::HEIGHT);
+  FrameRect band;
+  if (display_.getRotation() & 1) {
+    // panel rows are screen columns, counted from the right for rotation 3
+    band.x = (display_.getRotation() == 1) ? y0 : PanelT::HEIGHT - y1;
+    band.w = y1 - y0;
+    band.h = PanelT::WIDTH;
+  }
+  else {
+    band.y = (display_.getRotation() == 0) ? y0 : PanelT::HEIGHT - y1;
+    band.w = PanelT::WIDTH;
+    band.h = y1 - y0;
+  }
+  return band;
+}
+bool PocketmageEink::startRefreshTask_() {
+  if (refreshTask_) return true;
+  if (!frameFree_) frameFree_ = xSemaphoreCreateBinary();
+  if (!frameFree_) return false;
+  xSemaphoreGive(frameFree_);
+
+  // Yield while BUSY is high instead of GxEPD2's delay(1) spin
+  display_.epd2.setBusyCallback(busyCallback_, this);
+  xTaskCreatePinnedToCore(
+    refreshWorker_,          // Function name
+    "einkRefreshTask",       // Task name
+    4096,                    // Stack size
+    this,                    // Parameters
+    1,                       // Priority
+    &refreshTask_,           // Task handle
+    0                        // Core ID, same as the eink handler
+  );
+  if (!refreshTask_) ESP_LOGE(tag, "Failed to start refresh task");
+  return refreshTask_ != nullptr;
+}
+PocketmageEink::FrameRect PocketmageEink::clip_(int16_t x, int16_t y, int16_t w, int16_t h) const {
+  FrameRect r;
+  r.x = max<int16_t>(x, 0);
+  r.y = max<int16_t>(y, 0);
+  r.w = min<int16_t>(x + w, display_.width())  - r.x;
+  r.h = min<int16_t>(y + h, display_.height()) - r.y;
+  return r;
+}
+PocketmageEink::FrameRect PocketmageEink::unite_(const FrameRect& a, const FrameRect& b) {
+  if (a.empty()) return b;
+  if (b.empty()) return a;
+  FrameRect r;
+  r.x = min(a.x, b.x);
+  r.y = min(a.y, b.y);
+  r.w = max(a.x + a.w, b.x + b.w) - r.x;
+  r.h = max(a.y + a.h, b.y + b.h) - r.y;
+  return r;
+}
+bool PocketmageEink::intersects_(const FrameRect& a, const FrameRect& b) {
+  if (a.empty() || b.empty()) return false;
+  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+bool PocketmageEink::contains_(const FrameRect& outer, const FrameRect& inner) {
+  return inner.x >= outer.x && inner.y >= outer.y &&
+         inner.x + inner.w <= outer.x + outer.w && inner.y + inner.h <= outer.y + outer.h;
+}
+bool PocketmageEink::sameItem_(const FrameItem* list, uint8_t count, const FrameItem& item) {
+  for (uint8_t i = 0; i < count; i++) {
+    const FrameItem& other = list[i];
+    if (other.key == item.key && other.rect.x == item.rect.x && other.rect.y == item.rect.y &&
+        other.rect.w == item.rect.w && other.rect.h == item.rect.h) return true;
+  }
+  return false;
+}
+void PocketmageEink::addItem_(const FrameRect& rect, uint32_t key, int32_t ink) {
+  if (rect.empty()) return;
+  if (itemCount_ < maxFrameItems) items_[itemCount_++] = { rect, key, ink };
+  else                            marked_ = unite_(marked_, rect);
+}
+// Adds drawn or erased ink to the ghosting scheduler's current update
+void PocketmageEink::charge_(const FrameRect& rect, int32_t ink, bool erased) {
+  if (!rect.empty()) ghost_.addInk(rect.x, rect.y, rect.w, rect.h, ink, erased);
+}
+void PocketmageEink::drawCommand_(const EinkDisplayList& list, const EinkDisplayList::Command& cmd) {
+  using DL = EinkDisplayList;
+  // Bitmaps register themselves with their ink count
+  if (cmd.op == DL::OP_BITMAP) {
+    blitBitmap(cmd.a, cmd.b, static_cast<const uint8_t*>(cmd.data), cmd.c, cmd.d, cmd.size);
+    return;
+  }
+  if (cmd.op == DL::OP_DITHERED_BITMAP) {
+    blitDitheredBitmap(cmd.a, cmd.b, static_cast<const uint8_t*>(cmd.data), cmd.c, cmd.d, cmd.size);
+    return;
+  }
+  if (cmd.op == DL::OP_CALL) {
+    cmd.draw(const_cast<void*>(cmd.data));
+    return;
+  }
+
+  switch (cmd.op) {
+    case DL::OP_FILL_RECT: display_.fillRect(cmd.a, cmd.b, cmd.c, cmd.d, cmd.color); break;
+    case DL::OP_DRAW_RECT: display_.drawRect(cmd.a, cmd.b, cmd.c, cmd.d, cmd.color); break;
+    case DL::OP_LINE:      display_.drawLine(cmd.a, cmd.b, cmd.c, cmd.d, cmd.color); break;
+    case DL::OP_TEXT:
+      display_.setFont(static_cast<const GFXfont*>(cmd.data));
+      display_.setTextSize(cmd.size);
+      display_.setTextColor(cmd.color);
+      display_.setCursor(cmd.a, cmd.b);
+      display_.print(list.textOf(cmd));
+      break;
+    default: return;
+  }
+
+  const int16_t fields[] = { cmd.op, cmd.size, (int16_t)cmd.color, cmd.a, cmd.b, cmd.c, cmd.d };
+  uint32_t key = hashBytes(fields, sizeof(fields));
+  if (cmd.op == DL::OP_TEXT) {
+    key = hashBytes(&cmd.data, sizeof(cmd.data), key);
+    key = hashBytes(list.textOf(cmd), cmd.length, key);
+  }
+  addItem_(clip_(cmd.x, cmd.y, cmd.w, cmd.h), key, GhostScheduler::unknownFlips);
+}
+void PocketmageEink::syncGhost_() {
+  if (ghost_.width() == display_.width() && ghost_.height() == display_.height()) return;
+  ghost_.begin(display_.width(), display_.height());
+  ghost_.setUpdatesBeforeFull(fullRefreshAfter_);
+}
+// Anything drawn this frame overlaps rect
+bool PocketmageEink::touched_(const FrameRect& rect) const {
+  if (intersects_(marked_, rect)) return true;
+  for (uint8_t i = 0; i < itemCount_; i++)  if (intersects_(items_[i].rect, rect)) return true;
+  for (uint8_t i = 0; i < clearCount_; i++) if (intersects_(clears_[i], rect))     return true;
+  return false;
+}
+// Compares this frame's items with the frame on the panel and returns the
+// area that actually changed. Items are drawn onto white, so an item with
+// the same rect and key as before leaves its pixels unchanged, even if it
+// was cleared and redrawn. The current items become the panel's frame.
+// Each changed area is charged to the ghosting scheduler as ink drawn
+// (new items) or erased (old items).
+PocketmageEink::FrameRect PocketmageEink::diffFrame_() {
+  ghost_.beginUpdate();
+  FrameRect changed = marked_;
+  charge_(marked_, GhostScheduler::unknownFlips);
+  if (frameInvalid_) {
+    changed = clip_(0, 0, display_.width(), display_.height());
+    charge_(changed, GhostScheduler::unknownFlips);
+  }
+
+  for (uint8_t i = 0; i < itemCount_; i++) {
+    if (!sameItem_(lastItems_, lastCount_, items_[i])) {
+      changed = unite_(changed, items_[i].rect);
+      charge_(items_[i].rect, items_[i].ink);
+    }
+  }
+  // Old items that were cleared or drawn over and not redrawn the same
+  for (uint8_t i = 0; i < lastCount_; i++) {
+    if (!sameItem_(items_, itemCount_, lastItems_[i]) && touched_(lastItems_[i].rect)) {
+      changed = unite_(changed, lastItems_[i].rect);
+      charge_(lastItems_[i].rect, lastItems_[i].ink, true);
+    }
+  }
+  // Clears only cost nothing when an unchanged item covers them again
+  for (uint8_t i = 0; i < clearCount_; i++) {
+    bool covered = false;
+    for (uint8_t j = 0; j < itemCount_ && !covered; j++) {
+      covered = contains_(items_[j].rect, clears_[i]) && sameItem_(lastItems_, lastCount_, items_[j]);
+    }
+    if (!covered) {
+      changed = unite_(changed, clears_[i]);
+      // The cleared ink is already charged when it was a tracked item
+      bool known = false;
+      for (uint8_t j = 0; j < lastCount_ && !known; j++) known = contains_(lastItems_[j].rect, clears_[i]);
+      if (!known) charge_(clears_[i], GhostScheduler::unknownFlips);
+    }
+  }
+
+  // Old items nothing touched are still on the panel
+  for (uint8_t i = 0; i < lastCount_ && itemCount_ < maxFrameItems; i++) {
+    if (!touched_(lastItems_[i].rect)) items_[itemCount_++] = lastItems_[i];
+  }
+  ghost_.endUpdate();
+  memcpy(lastItems_, items_, itemCount_ * sizeof(FrameItem));
+  lastCount_    = itemCount_;
+  itemCount_    = 0;
+  clearCount_   = 0;
+  marked_       = FrameRect();
+  frameInvalid_ = false;
+  return changed;
+}
+// Picks the window for the next async refresh from what changed since the
+// last one. Returns false if the frame is unchanged.
+bool PocketmageEink::takeWindow_() {
+  syncGhost_();
+  // Decided on the updates so far, like refresh(), before this one is charged
+  const bool slowFull = ghost_.needsFull() || forceSlowFullUpdate_;
+
+  const int32_t frameBytes = (int32_t)display_.width() * display_.height() / 8;
+  const FrameRect changed  = diffFrame_();
+  windowW_ = 0;
+  if (changed.empty()) {
+    skipped_++;
+    bytesSaved_ += frameBytes;
+    return false;
+  }
+  int16_t x = changed.x, y = changed.y, w = changed.w, h = changed.h;
+
+  // Slow full update once a region has built up enough ghosting
+  if (slowFull) {
+    forceSlowFullUpdate_ = false;
+    ghost_.fullDone();
+    setFastFullRefresh(false);
+    return true;
+  }
+  // Large changes still go out as a fast full update
+  if ((int32_t)w * h * 100 > frameBytes * 8 * PARTIAL_WINDOW_MAX_PCT) {
+    setFastFullRefresh(true);
+    return true;
+  }
+
+  // Controller RAM is addressed in whole bytes along the panel's x axis,
+  // which is the screen's y axis when rotated by 90 or 270 degrees
+  if (display_.getRotation() & 1) {
+    h += y & 7;
+    y &= ~7;
+    h = min<int16_t>((h + 7) & ~7, display_.height() - y);
+  }
+  else {
+    w += x & 7;
+    x &= ~7;
+    w = min<int16_t>((w + 7) & ~7, display_.width() - x);
+  }
+  windowX_ = x;
+  windowY_ = y;
+  windowW_ = w;
+  windowH_ = h;
+  bytesSaved_ += frameBytes - (int32_t)w * h / 8;
+  return true;
+}
+// One full pass then `passes` partial passes, or all passes on the partial
+// window. keepFrame leaves the buffer and controller RAM intact for the
+// next partial window, otherwise the buffer is cleared and the panel
+// hibernates.
+void PocketmageEink::runPasses_(int passes, bool keepFrame) {
+  for (int i = 0; i <= max(passes, 0); i++) {
+    if (i > 0) {
+      refreshState_ = REFRESH_SETTLING;
+      vTaskDelay(pdMS_TO_TICKS(250));
+      // A newer frame is waiting, don't spend panel time on this one
+      if (cancelRefresh_) {
+        coalesced_++;
+        break;
+      }
+    }
+    refreshPass_  = i;
+    refreshState_ = REFRESH_TRANSFERRING;
+    if (windowW_ > 0) display_.displayWindow(windowX_, windowY_, windowW_, windowH_);
+    else              display_.display(i > 0);
+  }
+
+  refreshState_ = REFRESH_SETTLING;
+  vTaskDelay(pdMS_TO_TICKS(100));
+  if (keepFrame) {
+    display_.powerOff();
+  }
+  else {
+    display_.setFullWindow();
+    display_.fillScreen(GxEPD_WHITE);
+    display_.hibernate();
+  }
+  refreshPass_   = 0;
+  cancelRefresh_ = false;
+  refreshState_  = REFRESH_IDLE;
+}
+void PocketmageEink::refreshWorker_(void* parameter) {
+  PocketmageEink* self = static_cast<PocketmageEink*>(parameter);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->runPasses_(self->refreshPasses_, true);
+    xSemaphoreGive(self->frameFree_);
+  }
+}
+void PocketmageEink::busyCallback_(const void* parameter) {
+  PocketmageEink* self = static_cast<PocketmageEink*>(const_cast<void*>(parameter));
+  // Also called for plain display() calls, only track our own refreshes
+  if (self->refreshState_ != REFRESH_IDLE) self->refreshState_ = REFRESH_WAITING_BUSY;
+  vTaskDelay(1);
+}
+
 // ===================== getter functions =====================
 const GFXfont* PocketmageEink::getCurrentFont() { return currentFont_; }
 uint8_t PocketmageEink::maxCharsPerLine() const { return maxCharsPerLine_; }
@@ -0,0 +1,79 @@
+#include <pocketmage_fontmetrics.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static constexpr const char* tag = "FONT_METRICS";
+
+// ===================== main functions =====================
+const FontMetrics& FontMetrics::of(const GFXfont* font) {
+  static FontMetrics      table[maxFonts];
+  static volatile uint8_t count = 0;
+  static portMUX_TYPE     mux   = portMUX_INITIALIZER_UNLOCKED;
+
+  // Entries are never changed once counted, so lookups need no lock
+  const uint8_t n = count;
+  for (uint8_t i = 0; i < n; i++) {
+    if (table[i].font == font) return table[i];
+  }
+
+  FontMetrics built;
+  built.build(font);
+
+  taskENTER_CRITICAL(&mux);
+  // Another task may have added it meanwhile
+  for (uint8_t i = n; i < count; i++) {
+    if (table[i].font == font) {
+      taskEXIT_CRITICAL(&mux);
+      return table[i];
+    }
+  }
+  if (count == maxFonts) {
+    taskEXIT_CRITICAL(&mux);
+    ESP_LOGW(tag, "Font table full, falling back to the first font");
+    return table[0];
+  }
+  table[count] = built;
+  const FontMetrics& entry = table[count++];
+  taskEXIT_CRITICAL(&mux);
+  return entry;
+}
+
+uint16_t FontMetrics::textWidth(const char* text, size_t len) const {
+  uint16_t width = 0;
+  for (size_t i = 0; i < len; i++) width += charWidth(text[i]);
+  return width;
+}
+
+// ===================== private functions =====================
+void FontMetrics::build(const GFXfont* f) {
+  font = f;
+  if (!f) {
+    // Built-in font: 6 px cells, 7 px glyphs on an 8 px line, cursor on top
+    for (uint8_t& a : advance) a = 6;
+    ascent     = 0;
+    descent    = 7;
+    lineHeight = 8;
+    capHeight  = 7;
+    avgAdvance = 6;
+    return;
+  }
+
+  lineHeight = f->yAdvance;
+  int16_t top = 0, bottom = 0;
+  for (uint16_t c = first; c <= last; c++) {
+    if (c < f->first || c > f->last) continue;
+    const GFXglyph& g = f->glyph[c - f->first];
+    advance[c - first] = g.xAdvance;
+    if (!g.height) continue;
+    top    = min<int16_t>(top, g.yOffset);
+    bottom = max<int16_t>(bottom, g.yOffset + g.height);
+  }
+  ascent  = -top;
+  descent = bottom;
+
+  if ('H' >= f->first && 'H' <= f->last) capHeight = f->glyph['H' - f->first].height;
+  uint16_t sum = 0;
+  for (char c = 'a'; c <= 'z'; c++) sum += charWidth(c);
+  avgAdvance = (sum + 13) / 26;
+  if (!avgAdvance) avgAdvance = 1;
+}
@@ -0,0 +1,92 @@
+#include <pocketmage_ghost.h>
+
+// ===================== main functions =====================
+void GhostScheduler::begin(int16_t width, int16_t height) {
+  width_  = width;
+  height_ = height;
+  cols_   = (width + tileSize - 1) / tileSize;
+  rows_   = (height + tileSize - 1) / tileSize;
+  // Coarser than needed beats writing past the table
+  while (cols_ * rows_ > maxTiles) {
+    cols_ = (cols_ + 1) / 2;
+    rows_ = (rows_ + 1) / 2;
+  }
+  tileW_ = (width + cols_ - 1) / cols_;
+  tileH_ = (height + rows_ - 1) / rows_;
+  fullDone();
+  beginUpdate();
+}
+
+void GhostScheduler::setUpdatesBeforeFull(uint8_t updates) {
+  const uint32_t limit = (uint32_t)(updates ? updates : 1) * (updateCost + flipCost / 2);
+  limit_ = limit > 0xFFFF ? 0xFFFF : limit;
+}
+
+void GhostScheduler::beginUpdate() {
+  for (uint8_t i = 0; i < maxTiles; i++) {
+    touched_[i] = false;
+    inkOn_[i]   = 0;
+    inkOff_[i]  = 0;
+  }
+}
+
+void GhostScheduler::addInk(int16_t x, int16_t y, int16_t w, int16_t h, int32_t ink, bool erased) {
+  if (cols_ == 0 || w <= 0 || h <= 0) return;
+  const int32_t area = (int32_t)w * h;
+  const int16_t x1   = x + w;
+  const int16_t y1   = y + h;
+
+  for (uint8_t row = 0; row < rows_; row++) {
+    const int16_t ty0 = row * tileH_;
+    const int16_t ty1 = ty0 + tileH_;
+    if (ty1 <= y || ty0 >= y1) continue;
+    for (uint8_t col = 0; col < cols_; col++) {
+      const int16_t tx0 = col * tileW_;
+      const int16_t tx1 = tx0 + tileW_;
+      if (tx1 <= x || tx0 >= x1) continue;
+
+      // Ink is assumed spread evenly over the rect
+      const int32_t overlap = (int32_t)(min16(tx1, x1) - max16(tx0, x)) * (min16(ty1, y1) - max16(ty0, y));
+      const int32_t share   = (ink < 0) ? overlap / 2 : (int32_t)((int64_t)ink * overlap / area);
+      const uint8_t tile    = row * cols_ + col;
+      touched_[tile] = true;
+      if (erased) inkOff_[tile] += share;
+      else        inkOn_[tile]  += share;
+    }
+  }
+}
+
+void GhostScheduler::endUpdate() {
+  const int32_t tilePixels = (int32_t)tileW_ * tileH_;
+  for (uint8_t tile = 0; tile < cols_ * rows_; tile++) {
+    if (!touched_[tile]) continue;
+
+    // Expected pixels flipped when the erased and drawn ink are unrelated:
+    // |on XOR off| = on + off - 2 * on * off / pixels
+    const int32_t on    = inkOn_[tile]  < tilePixels ? inkOn_[tile]  : tilePixels;
+    const int32_t off   = inkOff_[tile] < tilePixels ? inkOff_[tile] : tilePixels;
+    const int32_t flips = on + off - (int32_t)((int64_t)2 * on * off / tilePixels);
+    const uint32_t cost = updateCost + (uint32_t)flips * flipCost / tilePixels;
+
+    uint16_t& score = scores_[tile];
+    score = (score + cost > 0xFFFF) ? 0xFFFF : score + cost;
+    if (score > maxScore_) maxScore_ = score;
+  }
+  beginUpdate();
+}
+
+void GhostScheduler::addUpdate(int16_t x, int16_t y, int16_t w, int16_t h, int32_t flips) {
+  beginUpdate();
+  addInk(x, y, w, h, flips);
+  endUpdate();
+}
+
+void GhostScheduler::fullDone() {
+  for (uint16_t& score : scores_) score = 0;
+  maxScore_ = 0;
+}
+
+uint16_t GhostScheduler::tileScore(uint8_t col, uint8_t row) const {
+  if (col >= cols_ || row >= rows_) return 0;
+  return scores_[row * cols_ + col];
+}
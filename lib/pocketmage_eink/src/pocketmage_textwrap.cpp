@@ -0,0 +1,64 @@
+#include <pocketmage_textwrap.h>
+
+// ===================== main functions =====================
+void TextWrap::wrap(const char* text, size_t len, const FontMetrics& metrics, uint16_t maxWidth, const SpanFn& emit) {
+  if (!text) return;
+
+  // The current line is always text[start, end)
+  size_t   start      = 0;
+  size_t   end        = 0;
+  bool     hasSpace   = false;
+  size_t   lastSpace  = 0;
+  uint32_t width      = 0;
+  uint32_t afterSpace = 0;  // width of the line after lastSpace
+
+  for (size_t i = 0; i < len; i++) {
+    const char c = text[i];
+
+    if (end > start) {
+      if (c == '\n') {
+        emit(start, end - start);
+        width    = 0;
+        hasSpace = false;
+      }
+      else if (width >= maxWidth) {
+        if (text[end - 1] == ' ') {
+          emit(start, end - start);
+          start = end;
+          width = 0;
+        }
+        else if (hasSpace) {
+          // The word in progress moves down to the new line
+          emit(start, lastSpace - start);
+          start = lastSpace + 1;
+          width = afterSpace;
+        }
+        else {
+          emit(start, end - start);
+          start = end;
+          width = 0;
+        }
+        hasSpace = false;
+      }
+    }
+
+    if (c == '\n') {
+      start = end = i + 1;
+      continue;
+    }
+
+    const uint8_t advance = metrics.charWidth(c);
+    end    = i + 1;
+    width += advance;
+    if (c == ' ') {
+      hasSpace   = true;
+      lastSpace  = i;
+      afterSpace = 0;
+    }
+    else {
+      afterSpace += advance;
+    }
+  }
+
+  if (end > start) emit(start, end - start);
+}
@@ -13,6 +13,7 @@
 #include <vector>
 #include <functional>
 #include <utility>
+#include <pocketmage_text.h>
 #pragma region fonts
 // U8G2 FONTS
 //U8G2_FOR_ADAFRUIT_GFX u8g2Fonts;
@@ -35,7 +36,7 @@ public:
   using KbStateFn = std::function<int()>;
   using MaxCharsFn = std::function<uint16_t()>;
 
-  void setAllLines(std::vector<String>* lines)                        { lines_ = lines;}
+  void setAllLines(TextDocument* lines)                               { lines_ = lines;}
   void setDynamicScroll(volatile long* scroll)               { dynamicScroll_ = scroll;}
   void setReferenceWidth(uint16_t w)                                   { refWidth_ = w;}  // E-ink measurement
   void setMeasureTextWidth(MeasureTextFn fn)                { measure_ = std::move(fn);}  // function for measuring text width in e-ink pixels
@@ -62,7 +63,7 @@ public:
 private:
   U8G2                  &u8g2_;        // class reference to hardware oled object
 
-  std::vector<String>*  lines_         = nullptr;
+  TextDocument*         lines_         = nullptr;
   volatile long*        dynamicScroll_ = nullptr;
 
   volatile int*         battState_     = nullptr;
@@ -87,6 +88,7 @@ private:
   MaxCharsFn            maxCharsFn_;   // measure   
   // helpers
   uint16_t strWidth(const String& s) const;
+  uint16_t strWidth(const char* s, size_t len) const;
   int currentKbState() const;
 };
 
@@ -211,9 +211,12 @@ void PocketmageOled::oledScroll() {
     if (i >= count) continue;  // Ensure i is within bounds
 
     // CHECK IF LINE STARTS WITH A TAB
-    const bool tabbed = (*lines_)[i].startsWith("    ");
-    const String& s   = tabbed ? (*lines_)[i].substring(4) : (*lines_)[i];
-    const uint16_t w  = strWidth(s);
+    const TextLine line = lines_->line(i);
+    const bool tabbed   = line.startsWith("    ");
+    // wider than the eink line never matters, the bar saturates at refMax
+    char text[96];
+    const size_t   n    = line.copy(text, sizeof(text), tabbed ? 4 : 0);
+    const uint16_t w    = strWidth(text, n);
 
     // ADJUST DRAW COORDINATES BASED ON TAB
     const int refMax  = tabbed ? 49 : 56;
@@ -231,11 +234,14 @@ void PocketmageOled::oledScroll() {
   u8g2_.drawStr(0, 24, lineNumStr.c_str());
 
   // PRINT LINE PREVIEW
-  if (startIndex >= 0 && startIndex < lines_->size()) {
-    const String& line = (*lines_)[startIndex];
-    if (line.length() > 0) {
+  if (startIndex >= 0 && startIndex < (long)lines_->size()) {
+    const TextLine line = lines_->line(startIndex);
+    if (line.size() > 0) {
+      // only the start of the line fits at this size anyway
+      char preview[64];
+      line.copy(preview, sizeof(preview));
       u8g2_.setFont(u8g2_font_ncenB18_tr);
-      u8g2_.drawStr(140, 24, line.c_str());
+      u8g2_.drawStr(140, 24, preview);
     }
   }
 
@@ -244,6 +250,10 @@ void PocketmageOled::oledScroll() {
 }
 
 // ===================== private functions =====================
+// COMPUTE WIDTH OF A LINE SPAN IN EINK PIXELS
+uint16_t PocketmageOled::strWidth(const char* s, size_t len) const {
+  return strWidth(String(s, len));
+}
 // COMPUTE STRING WIDTH IN EINK PIXELS
 uint16_t PocketmageOled::strWidth(const String& s) const {
   // Fallback: map u8g2 width to the reference width
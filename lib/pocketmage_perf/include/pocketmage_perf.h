@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+
+// ===================== PERF GUARD =====================
+// Holds the CPU at full speed for as long as any guard is alive. Guards
+// nest across tasks: only the outermost one switches the clock, up on entry
+// and back to POWER_SAVE_FREQ on exit when SAVE_POWER is set, so a save that
+// goes through several pocketmage::file and PocketmageSD calls switches once
+// instead of once per call.
+//
+//   void PocketmageSD::readFile(...) {
+//     PerfGuard perf("SD read");
+//     ...
+//   }
+//
+// The outermost run is timed from the first guard in to the last guard out,
+// whichever tasks they belong to, and logged at debug level under the first
+// guard's label. stats() keeps totals. Building with
+// -D PERF_GUARD_PER_CALL=1 brings back the old behaviour (every guard
+// switches up, settles for 50 ms and drops back on exit) so the same stats
+// give the before numbers.
+class PerfGuard {
+public:
+  struct Stats {
+    uint32_t operations;   // outermost guards finished
+    uint32_t nested;       // guards that found the clock already up
+    uint32_t switches;     // clock changes made
+    uint64_t busyMicros;   // time spent inside outermost guards
+  };
+
+  explicit PerfGuard(const char* label = nullptr);
+  ~PerfGuard();
+  PerfGuard(const PerfGuard&)            = delete;
+  PerfGuard& operator=(const PerfGuard&) = delete;
+
+  static const Stats& stats()                                  { return stats_; }
+  static uint32_t     depth()                                  { return depth_; }
+
+private:
+  static constexpr const char* tag      = "PERF";
+  static constexpr uint32_t    fullFreq = 240;
+
+  static void lock_();
+  static void unlock_();
+
+  // All guarded by lock_(): the outermost run can start in one task and end
+  // in another
+  static uint32_t    depth_;
+  static uint32_t    outerStart_;
+  static const char* outerLabel_;
+  static Stats       stats_;
+};
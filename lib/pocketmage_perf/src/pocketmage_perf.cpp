@@ -0,0 +1,66 @@
+#include <pocketmage_perf.h>
+#include <config.h>  // for POWER_SAVE_FREQ
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+extern bool SAVE_POWER;
+
+// A/B switch: 1 switches the clock in every guard, as before PerfGuard
+#ifndef PERF_GUARD_PER_CALL
+#define PERF_GUARD_PER_CALL 0
+#endif
+
+uint32_t         PerfGuard::depth_      = 0;
+uint32_t         PerfGuard::outerStart_ = 0;
+const char*      PerfGuard::outerLabel_ = nullptr;
+PerfGuard::Stats PerfGuard::stats_      = {};
+
+// ===================== main functions =====================
+PerfGuard::PerfGuard(const char* label) {
+  lock_();
+  const bool outer = depth_++ == 0;
+  if (outer) {
+    outerStart_ = micros();
+    outerLabel_ = label;
+  }
+  else {
+    stats_.nested++;
+  }
+  bool settle = false;
+  if ((outer || PERF_GUARD_PER_CALL) && getCpuFrequencyMhz() != fullFreq) {
+    setCpuFrequencyMhz(fullFreq);
+    stats_.switches++;
+    settle = PERF_GUARD_PER_CALL;
+  }
+  unlock_();
+  // The old per-call code waited for the clock after every switch
+  if (settle) delay(50);
+}
+
+PerfGuard::~PerfGuard() {
+  lock_();
+  const bool outer = --depth_ == 0;
+  if ((outer || PERF_GUARD_PER_CALL) && SAVE_POWER && getCpuFrequencyMhz() != POWER_SAVE_FREQ) {
+    setCpuFrequencyMhz(POWER_SAVE_FREQ);
+    stats_.switches++;
+  }
+  if (outer) {
+    const uint32_t elapsed = micros() - outerStart_;
+    stats_.operations++;
+    stats_.busyMicros += elapsed;
+    ESP_LOGD(tag, "%s: %lu us (%lu ops, %lu switches, %lu nested)", outerLabel_ ? outerLabel_ : "op",
+             (unsigned long)elapsed, (unsigned long)stats_.operations,
+             (unsigned long)stats_.switches, (unsigned long)stats_.nested);
+  }
+  unlock_();
+}
+
+// ===================== private functions =====================
+// A mutex, not a critical section: changing the clock can block
+static SemaphoreHandle_t perfMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+void PerfGuard::lock_()   { xSemaphoreTake(perfMutex(), portMAX_DELAY); }
+void PerfGuard::unlock_() { xSemaphoreGive(perfMutex()); }
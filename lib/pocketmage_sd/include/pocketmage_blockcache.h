@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <pocketmage_handlecache.h>
+
+// ===================== BLOCK CACHE =====================
+// Fixed-size blocks of recently read files, kept between PocketmageSD and
+// the card so repeated and neighbouring reads don't go back to SD. Blocks
+// are evicted least recently used first and live in PSRAM when there is
+// some (SD_CACHE_BLOCKS x SD_CACHE_BLOCK_SIZE in config.h; fewer blocks in
+// internal RAM if that much can't be had).
+//
+// A read that starts where the previous read of the same file ended counts
+// as sequential; from the second one on, the next blocks are fetched with the
+// same open file: one per 8 blocks of cache, at most 2, none below 8 blocks.
+// The cache never holds written data: writes go straight to the card and
+// drop every cached block of the file, so no block is ever dirty.
+class BlockCache {
+public:
+  struct Stats {
+    uint32_t hits;        // blocks served from RAM
+    uint32_t misses;      // blocks read from the card on demand
+    uint32_t readAhead;   // blocks read from the card ahead of need
+    uint64_t bytesRead;   // bytes returned to callers
+    uint64_t cardBytes;   // bytes read from the card
+
+    float hitRatio() const { return hits + misses ? (float)hits / (hits + misses) : 0.0f; }
+  };
+
+  explicit BlockCache() {}
+  ~BlockCache();
+  BlockCache(const BlockCache&)            = delete;
+  BlockCache& operator=(const BlockCache&) = delete;
+
+  // Reserve blockCount blocks of blockSize bytes, 0 blocks disables caching
+  bool begin(size_t blockCount, size_t blockSize);
+  // Read misses through these handles instead of opening the file each time
+  void setHandles(HandleCache* handles)                   { handles_ = handles; }
+
+  // Read len bytes at offset, returns the bytes read (short at end of file)
+  size_t read(fs::FS& fs, const char* path, size_t offset, uint8_t* dst, size_t len);
+  // Forget every block of path, after it was written, renamed or deleted
+  void   invalidate(const char* path);
+  void   clear();
+
+  const Stats& stats() const                                   { return stats_; }
+  void         resetStats()                                     { stats_ = {}; }
+  size_t       blockCount() const                              { return count_; }
+  size_t       blockSize() const                                { return size_; }
+  // Blocks fetched ahead of a sequential reader, scaled with blockCount()
+  size_t       readAhead() const                                { return readAhead_; }
+
+private:
+  // Blocks are looked up by path hash, then the path itself, so two paths
+  // sharing a hash never see each other's bytes
+  struct Block {
+    uint32_t file;        // path hash, 0 when the block is free
+    uint32_t index;       // offset / size_
+    uint32_t length;      // valid bytes, short for the last block of a file
+    uint32_t lastUse;
+    fs::FS*  fs;
+    uint8_t* data;
+    char     path[96];    // longer paths are read past the cache
+  };
+
+  static constexpr const char* tag                = "MAGE_SD_CACHE";
+  static constexpr size_t      minReadAheadBlocks = 8;
+  static constexpr uint8_t     maxReadAhead       = 2;
+
+  Block* find_(fs::FS& fs, const char* path, uint32_t file, uint32_t index);
+  Block* victim_();
+  // Load one block from an open file, returns nullptr on a read error
+  Block* fill_(File& f, fs::FS& fs, const char* path, uint32_t file, uint32_t index);
+  size_t readDirect_(fs::FS& fs, const char* path, size_t offset, uint8_t* dst, size_t len);
+  static uint32_t hash_(const char* path);
+  File* open_(fs::FS& fs, const char* path);
+  void  close_();
+
+  SemaphoreHandle_t lock_    = nullptr;
+  HandleCache*      handles_ = nullptr;
+  File              own_;      // the open file when there is no HandleCache
+  Block*            blocks_  = nullptr;
+  uint8_t*          store_   = nullptr;
+  size_t            count_   = 0;
+  size_t            size_    = 0;
+  size_t            readAhead_ = 0;
+  uint32_t          useTick_ = 0;
+
+  // Sequential read detection
+  uint32_t          lastFile_  = 0;
+  fs::FS*           lastFs_    = nullptr;
+  char              lastPath_[sizeof(Block::path)] = {};
+  size_t            lastEnd_   = 0;
+  uint8_t           streak_    = 0;
+
+  Stats             stats_     = {};
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// ===================== HANDLE CACHE =====================
+// Keeps the last few files opened for reading open, so reading a hot asset
+// again (or a size check followed by a read) skips the FAT path walk in
+// open(). Least recently used handles are closed first.
+//
+// acquire() returns a handle and holds the cache lock until release(), so
+// an invalidate() from another task can't close it mid-read:
+//
+//   File* f = handles.acquire(fs, path);
+//   if (f) f->read(...);
+//   handles.release();
+//
+// Anything that writes, renames or deletes a file must invalidate() it
+// first, and closeAll() must run before a restart or deep sleep.
+//
+// begin() creates the lock and must run before any other task can reach the
+// cache; until then acquire() hands out nothing.
+class HandleCache {
+public:
+  explicit HandleCache() {}
+
+  bool begin();
+  bool ready() const                                       { return mutex_ != nullptr; }
+
+  // Open handle for path (nullptr if it can't be opened), lock held either way
+  File* acquire(fs::FS& fs, const char* path);
+  void  release();
+
+  void invalidate(const char* path);
+  void closeAll();
+
+  uint32_t hits() const                                         { return hits_; }
+  uint32_t opens() const                                       { return opens_; }
+
+private:
+  struct Slot {
+    char     path[96] = "";
+    fs::FS*  fs       = nullptr;
+    File     file;
+    uint32_t lastUse  = 0;
+  };
+
+  static constexpr const char* tag   = "MAGE_SD_HANDLES";
+  static constexpr uint8_t     slots = 4;
+
+  bool lock_();
+  void unlock_();
+
+  SemaphoreHandle_t mutex_   = nullptr;
+  Slot              slots_[slots];
+  uint32_t          useTick_ = 0;
+  uint32_t          hits_    = 0;
+  uint32_t          opens_   = 0;
+};
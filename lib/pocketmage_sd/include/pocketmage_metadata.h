@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+
+// ===================== METADATA INDEX =====================
+// File metadata (last save time, size, character count) kept in a hashed
+// table of fixed 128 byte records on the SD card, so an update reads and
+// writes a record or two instead of rewriting a text file of every entry.
+//
+// Records are 128 byte aligned, so each lives in one SD sector and a write
+// either lands or doesn't. A rename writes the new record before freeing the
+// old one. The table doubles through a temporary file once it is 3/4 full.
+// begin() imports the old "path|time|N Bytes|N Char" text file whenever it
+// changed outside the index, replacing every entry with the file's.
+class MetadataIndex {
+public:
+  struct Entry {
+    char     path[96];
+    char     timestamp[16];   // YYYYMMDD-HHMM
+    uint32_t bytes;
+    uint32_t chars;
+    uint8_t  state;           // slot state, managed by the index
+    uint8_t  reserved[7];
+  };
+  static_assert(sizeof(Entry) == 128, "metadata records must stay sector aligned");
+
+  struct Stats {
+    uint32_t reads;           // records read since begin()
+    uint32_t writes;          // records written since begin()
+  };
+
+  explicit MetadataIndex() {}
+
+  // Opens (or creates) the index and imports legacyPath if it changed; cheap
+  // once open
+  bool begin(fs::FS& fs, const char* indexPath, const char* legacyPath = nullptr);
+  void end();
+  // Writes every entry to the text file begin() imports, if any changed
+  bool exportText();
+
+  bool get(const String& path, Entry& out);
+  bool put(const String& path, const char* timestamp, uint32_t bytes, uint32_t chars);
+  bool remove(const String& path);
+  bool rename(const String& oldPath, const String& newPath);
+
+  size_t       size() const                                     { return used_; }
+  const Stats& stats() const                                   { return stats_; }
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved0;
+    uint32_t slots;
+    uint32_t legacyHash;      // of the text file as last imported or exported
+    uint8_t  reserved[112];
+  };
+  static_assert(sizeof(Header) == sizeof(Entry), "header takes one record slot");
+
+  enum : uint8_t { SLOT_EMPTY = 0, SLOT_USED = 1, SLOT_FREED = 2 };
+
+  static constexpr const char* tag        = "MAGE_META";
+  static constexpr uint32_t    magic      = 0x4154454D;  // "META"
+  static constexpr uint16_t    version    = 1;
+  static constexpr uint32_t    minSlots   = 64;
+
+  bool   create_(const String& path, uint32_t slots);
+  bool   import_();
+  bool   clear_();
+  bool   writeHeader_();
+  bool   grow_();
+  // Slot holding path (state SLOT_USED), or the first reusable slot on its
+  // probe chain and that slot's state
+  bool   find_(const char* path, uint32_t& slot, uint8_t& state);
+  bool   readSlot_(uint32_t slot, Entry& out);
+  bool   writeSlot_(uint32_t slot, const Entry& entry);
+  bool   insert_(const Entry& entry);
+  // corrupt is set when the file opened but isn't a usable index
+  bool   open_(bool* corrupt = nullptr);
+  static uint32_t hash_(const char* path);
+  static uint32_t hashFile_(fs::FS& fs, const char* path);
+  static size_t   offset_(uint32_t slot) { return sizeof(Header) + (size_t)slot * sizeof(Entry); }
+
+  fs::FS*  fs_      = nullptr;
+  String   path_;
+  String   legacyPath_;
+  File     file_;
+  uint32_t slots_      = 0;
+  uint32_t legacyHash_ = 0;
+  bool     changed_    = false;  // since the text file was written
+  uint32_t used_    = 0;
+  uint32_t freed_   = 0;
+  Stats    stats_   = {};
+};
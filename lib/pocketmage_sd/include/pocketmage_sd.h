@@ -8,6 +8,7 @@
 #pragma once
 #include <Arduino.h>
 #include <FS.h>
+#include <pocketmage_sdworker.h>
 
 // forward-declaration to avoid including U8g2lib.h, GxEPD2_BW.h, pocketmage_oled.h, and pocketmage_eink.h
 class PocketmageOled;
@@ -41,10 +42,18 @@ public:
   bool readBinaryFile(const char* path, uint8_t* buf, size_t len);
   // Convenience: read file size
   size_t getFileSize(const char* path);
+
+  // Start the SD worker task; until then the calls above run on the caller
+  bool startWorker()                         { return worker_.begin(fileSys_); }
+  // For async requests (submit/wait) beside the synchronous calls above
+  SdWorker& worker()                                        { return worker_; }
+  // Close cached file handles, before a restart or deep sleep
+  void closeHandles()                                { worker_.closeHandles(); }
   
 private:
   static constexpr const char*  tag               = "MAGE_SD";
   fs::FS*                       fileSys_          = nullptr;    // class reference to sd file system object
+  SdWorker                      worker_;                        // runs reads/writes/stats off the caller's task
 
   PocketmageOled*               oled_             = nullptr;
   PocketmageEink*               eink_             = nullptr;
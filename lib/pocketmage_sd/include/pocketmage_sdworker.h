@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <pocketmage_blockcache.h>
+
+// ===================== SD WORKER =====================
+// Runs SD reads, writes, appends and size checks on a task of its own, so
+// the loop and the eink task can hand work off instead of blocking on the
+// card. Requests go into one of two lanes; the worker always empties the
+// interactive lane first, so a card read for the screen never queues behind
+// a background save.
+//
+// A Request belongs to the caller and must outlive its completion, as must
+// its path and buffers. Completion is reported through the optional done
+// callback (run on the worker task) and by wait(), which blocks until the
+// request is finished:
+//
+//   SdWorker::Request req = SdWorker::Request::read("/a.bin", buf, len);
+//   worker.submit(req, SdWorker::Interactive);
+//   ...                          // do something else meanwhile
+//   if (worker.wait(req)) use(buf);
+//
+// Reads go through a BlockCache, and reads and stats borrow open files
+// from a HandleCache; writes invalidate both.
+//
+// run() is the synchronous form. It executes inline when called from the
+// worker task itself (a done callback) or before begin(), so it can't
+// deadlock.
+class SdWorker {
+public:
+  enum class Op : uint8_t { Read, Write, Append, Stat };
+  enum Lane : uint8_t { Interactive = 0, Background = 1, LaneCount = 2 };
+
+  struct Request {
+    using DoneFn = void (*)(Request& req, void* ctx);
+
+    Op             op     = Op::Stat;
+    fs::FS*        fs     = nullptr;   // nullptr for the worker's file system
+    const char*    path   = nullptr;
+    uint8_t*       buf    = nullptr;   // Read: destination
+    const uint8_t* data   = nullptr;   // Write/Append: source
+    size_t         len    = 0;         // Read/Write/Append: bytes requested
+    size_t         offset = 0;         // Read: where in the file to start
+    bool           eol    = false;     // Append: follow data with "\r\n"
+    size_t         result = 0;         // bytes moved, or the file size for Stat
+    bool           ok     = false;
+    DoneFn         done   = nullptr;
+    void*          ctx    = nullptr;
+
+    static Request read(const char* path, uint8_t* buf, size_t len, size_t offset = 0);
+    static Request write(const char* path, const uint8_t* data, size_t len);
+    // eol appends the line end in the same write, so nothing lands between
+    static Request append(const char* path, const uint8_t* data, size_t len, bool eol = false);
+    static Request stat(const char* path);
+
+  private:
+    friend class SdWorker;
+    SemaphoreHandle_t signal_ = nullptr;
+    StaticSemaphore_t signalStore_;
+  };
+
+  explicit SdWorker() { cache_.setHandles(&handles_); }
+
+  bool begin(fs::FS* fileSys);
+  bool isRunning() const                                 { return task_ != nullptr; }
+  bool onWorkerTask() const;
+
+  // Queue a request, returns false if the worker isn't running
+  bool submit(Request& req, Lane lane = Background);
+  // Block until a submitted request is done, returns its ok flag
+  bool wait(Request& req);
+  // submit() + wait(), or inline where waiting would deadlock
+  bool run(Request& req, Lane lane = Interactive);
+
+  // Drop cached blocks and handles of path, before it is renamed or deleted
+  void invalidate(const char* path);
+  // Close every cached handle, before a restart or deep sleep
+  void closeHandles()                                    { handles_.closeAll(); }
+
+  BlockCache&  cache()                                       { return cache_; }
+  HandleCache& handles()                                   { return handles_; }
+
+private:
+  static constexpr const char* tag        = "MAGE_SD_WORKER";
+  static constexpr UBaseType_t queueDepth = 8;
+
+  void execute_(Request& req);
+  static void taskMain_(void* parameter);
+
+  fs::FS*       fileSys_           = nullptr;
+  TaskHandle_t  task_              = nullptr;
+  QueueHandle_t lanes_[LaneCount]  = {};
+  HandleCache   handles_;
+  BlockCache    cache_;
+};
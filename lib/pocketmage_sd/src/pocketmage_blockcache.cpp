@@ -0,0 +1,187 @@
+#include <pocketmage_blockcache.h>
+#include <esp_heap_caps.h>
+
+// ===================== main functions =====================
+BlockCache::~BlockCache() {
+  free(store_);
+  free(blocks_);
+}
+
+bool BlockCache::begin(size_t blockCount, size_t blockSize) {
+  if (!lock_) lock_ = xSemaphoreCreateMutex();
+  if (!lock_) return false;
+  if (blocks_) return true;
+  size_ = blockSize;
+
+  if (psramFound()) {
+    store_ = static_cast<uint8_t*>(heap_caps_malloc(blockCount * blockSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  }
+  // Internal RAM is scarcer, settle for fewer blocks
+  while (!store_ && blockCount > 0) {
+    store_ = static_cast<uint8_t*>(heap_caps_malloc(blockCount * blockSize, MALLOC_CAP_8BIT));
+    if (!store_) blockCount /= 2;
+  }
+  if (store_) blocks_ = static_cast<Block*>(calloc(blockCount, sizeof(Block)));
+  if (!blocks_) {
+    free(store_);
+    store_ = nullptr;
+    ESP_LOGW(tag, "No memory for a block cache, reading straight from SD");
+    return true;
+  }
+
+  count_ = blockCount;
+  for (size_t i = 0; i < count_; i++) blocks_[i].data = store_ + i * size_;
+  // A small cache would evict blocks still in use to make room for guesses
+  readAhead_ = count_ < minReadAheadBlocks ? 0 : min(count_ / minReadAheadBlocks, (size_t)maxReadAhead);
+  ESP_LOGI(tag, "%u blocks of %u bytes, %u read ahead", (unsigned)count_, (unsigned)size_, (unsigned)readAhead_);
+  return true;
+}
+
+size_t BlockCache::read(fs::FS& fs, const char* path, size_t offset, uint8_t* dst, size_t len) {
+  if (!count_ || !lock_ || strlen(path) >= sizeof(Block::path)) return readDirect_(fs, path, offset, dst, len);
+
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  const uint32_t file = hash_(path);
+  const bool     same = file == lastFile_ && &fs == lastFs_ && strcmp(path, lastPath_) == 0;
+  streak_ = (same && offset == lastEnd_) ? min(streak_ + 1, 255) : 0;
+
+  // The file is opened on the first miss only, then shared by the rest
+  File*  f      = nullptr;
+  bool   opened = false;
+  size_t done   = 0;
+  while (done < len) {
+    const size_t   pos   = offset + done;
+    const uint32_t index = pos / size_;
+    const size_t   skip  = pos % size_;
+
+    Block* b = find_(fs, path, file, index);
+    if (b) stats_.hits++;
+    else {
+      if (!opened) {
+        f      = open_(fs, path);
+        opened = true;
+      }
+      if (!f) break;
+      b = fill_(*f, fs, path, file, index);
+      if (!b) break;
+      stats_.misses++;
+    }
+    b->lastUse = ++useTick_;
+
+    if (skip >= b->length) break;  // past the end of the file
+    const size_t n = min(len - done, (size_t)b->length - skip);
+    memcpy(dst + done, b->data + skip, n);
+    done += n;
+    if (b->length < size_) break;  // last block of the file
+  }
+
+  // Sequential reader: fetch what it will ask for next while the file is open
+  if (readAhead_ && streak_ > 0 && done == len && len > 0) {
+    const uint32_t next = (offset + len - 1) / size_ + 1;
+    for (uint32_t index = next; index < next + readAhead_; index++) {
+      if (find_(fs, path, file, index)) continue;
+      if (!opened) {
+        f      = open_(fs, path);
+        opened = true;
+      }
+      if (!f) break;
+      Block* b = fill_(*f, fs, path, file, index);
+      if (!b) break;
+      stats_.readAhead++;
+      if (b->length < size_) break;
+    }
+  }
+  if (opened) close_();
+
+  lastFile_ = file;
+  lastFs_   = &fs;
+  lastEnd_  = offset + done;
+  strlcpy(lastPath_, path, sizeof(lastPath_));
+  stats_.bytesRead += done;
+  xSemaphoreGive(lock_);
+  return done;
+}
+
+void BlockCache::invalidate(const char* path) {
+  if (!count_ || !lock_) return;
+  const uint32_t file = hash_(path);
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  // Every file system's copy, the caller doesn't say which one changed
+  for (size_t i = 0; i < count_; i++) {
+    if (blocks_[i].file == file && strcmp(blocks_[i].path, path) == 0) blocks_[i].file = 0;
+  }
+  if (lastFile_ == file && strcmp(lastPath_, path) == 0) lastFile_ = 0;
+  xSemaphoreGive(lock_);
+}
+
+void BlockCache::clear() {
+  if (!count_ || !lock_) return;
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  for (size_t i = 0; i < count_; i++) blocks_[i].file = 0;
+  lastFile_ = 0;
+  xSemaphoreGive(lock_);
+}
+
+// ===================== private functions =====================
+BlockCache::Block* BlockCache::find_(fs::FS& fs, const char* path, uint32_t file, uint32_t index) {
+  for (size_t i = 0; i < count_; i++) {
+    Block& b = blocks_[i];
+    if (b.file == file && b.index == index && b.fs == &fs && strcmp(b.path, path) == 0) return &b;
+  }
+  return nullptr;
+}
+
+BlockCache::Block* BlockCache::victim_() {
+  Block* victim = &blocks_[0];
+  for (size_t i = 0; i < count_; i++) {
+    if (!blocks_[i].file) return &blocks_[i];
+    if (blocks_[i].lastUse < victim->lastUse) victim = &blocks_[i];
+  }
+  return victim;
+}
+
+BlockCache::Block* BlockCache::fill_(File& f, fs::FS& fs, const char* path, uint32_t file, uint32_t index) {
+  Block* b = victim_();
+  b->file = 0;
+  if (!f.seek((size_t)index * size_)) return nullptr;
+  const size_t n = f.read(b->data, size_);
+  stats_.cardBytes += n;
+
+  b->file    = file;
+  b->index   = index;
+  b->length  = n;
+  b->lastUse = ++useTick_;
+  b->fs      = &fs;
+  strlcpy(b->path, path, sizeof(b->path));
+  return b;
+}
+
+size_t BlockCache::readDirect_(fs::FS& fs, const char* path, size_t offset, uint8_t* dst, size_t len) {
+  File* f = open_(fs, path);
+  const size_t n = (f && f->seek(offset)) ? f->read(dst, len) : 0;
+  close_();
+  return n;
+}
+
+// Borrow a cached handle when there is a HandleCache (begun), else open one
+File* BlockCache::open_(fs::FS& fs, const char* path) {
+  if (handles_ && handles_->ready()) return handles_->acquire(fs, path);
+  own_ = fs.open(path, FILE_READ);
+  if (own_ && own_.isDirectory()) own_.close();
+  return own_ ? &own_ : nullptr;
+}
+
+void BlockCache::close_() {
+  if (handles_ && handles_->ready()) handles_->release();
+  else if (own_) own_.close();
+}
+
+// FNV-1a, 0 is kept for free blocks
+uint32_t BlockCache::hash_(const char* path) {
+  uint32_t h = 2166136261u;
+  while (*path) {
+    h ^= (uint8_t)*path++;
+    h *= 16777619u;
+  }
+  return h ? h : 1;
+}
@@ -0,0 +1,74 @@
+#include <pocketmage_handlecache.h>
+
+// ===================== main functions =====================
+bool HandleCache::begin() {
+  if (!mutex_) mutex_ = xSemaphoreCreateMutex();
+  return mutex_ != nullptr;
+}
+
+File* HandleCache::acquire(fs::FS& fs, const char* path) {
+  if (!lock_()) return nullptr;
+
+  Slot* victim = &slots_[0];
+  for (Slot& slot : slots_) {
+    if (slot.fs == &fs && slot.file && strcmp(slot.path, path) == 0) {
+      hits_++;
+      slot.lastUse = ++useTick_;
+      return &slot.file;
+    }
+    if (!slot.file || (victim->file && slot.lastUse < victim->lastUse)) victim = &slot;
+  }
+
+  if (victim->file) victim->file.close();
+  victim->path[0] = '\0';
+  victim->fs      = nullptr;
+
+  victim->file = fs.open(path, FILE_READ);
+  if (!victim->file || victim->file.isDirectory()) {
+    if (victim->file) victim->file.close();
+    return nullptr;
+  }
+  opens_++;
+  // A path too long to key is never matched again, and is closed when the
+  // slot is reused
+  if (strlen(path) < sizeof(victim->path)) strlcpy(victim->path, path, sizeof(victim->path));
+  victim->fs      = &fs;
+  victim->lastUse = ++useTick_;
+  return &victim->file;
+}
+
+void HandleCache::release() {
+  unlock_();
+}
+
+void HandleCache::invalidate(const char* path) {
+  if (!lock_()) return;
+  for (Slot& slot : slots_) {
+    if (slot.file && strcmp(slot.path, path) == 0) {
+      slot.file.close();
+      slot.path[0] = '\0';
+      slot.fs      = nullptr;
+    }
+  }
+  unlock_();
+}
+
+void HandleCache::closeAll() {
+  if (!lock_()) return;
+  for (Slot& slot : slots_) {
+    if (slot.file) slot.file.close();
+    slot.path[0] = '\0';
+    slot.fs      = nullptr;
+  }
+  unlock_();
+  ESP_LOGI(tag, "Closed cached handles (%lu hits, %lu opens)", (unsigned long)hits_, (unsigned long)opens_);
+}
+
+// ===================== private functions =====================
+bool HandleCache::lock_() {
+  return mutex_ && xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE;
+}
+
+void HandleCache::unlock_() {
+  if (mutex_) xSemaphoreGive(mutex_);
+}
@@ -0,0 +1,381 @@
+#include <pocketmage_metadata.h>
+
+// ===================== main functions =====================
+bool MetadataIndex::begin(fs::FS& fs, const char* indexPath, const char* legacyPath) {
+  if (fs_ == &fs && path_ == indexPath && file_) return true;
+  end();
+  fs_         = &fs;
+  path_       = indexPath;
+  legacyPath_ = legacyPath ? legacyPath : "";
+  legacyHash_ = 0;
+  changed_    = false;
+  stats_      = {};
+
+  // A rebuild cut off between removing the index and renaming its replacement
+  const String temp = path_ + ".tmp";
+  if (!fs.exists(path_) && fs.exists(temp)) fs.rename(temp, path_);
+
+  const bool fresh = !fs.exists(path_);
+  if (fresh && !create_(path_, minSlots)) {
+    fs_ = nullptr;
+    return false;
+  }
+  bool corrupt = false;
+  if (!open_(&corrupt)) {
+    // Torn or foreign: start over, the text file has the entries
+    if (!corrupt || !fs.remove(path_) || !create_(path_, minSlots) || !open_()) {
+      fs_ = nullptr;
+      return false;
+    }
+    ESP_LOGW(tag, "Rebuilt bad metadata index %s", path_.c_str());
+  }
+
+  // Changed by PocketMage OS (or a PC) since this index last saw it
+  if (legacyPath_.length() && fs.exists(legacyPath_)) {
+    const uint32_t h = hashFile_(fs, legacyPath_.c_str());
+    // Only marked as seen once imported in full, a cut off import runs again
+    if (h != legacyHash_ && import_()) {
+      legacyHash_ = h;
+      writeHeader_();
+    }
+  }
+
+  ESP_LOGI(tag, "%u entries in %u slots", (unsigned)used_, (unsigned)slots_);
+  return true;
+}
+
+void MetadataIndex::end() {
+  if (file_) file_.close();
+  fs_ = nullptr;
+}
+
+bool MetadataIndex::exportText() {
+  if (!fs_ || !changed_ || !legacyPath_.length()) return true;
+
+  const String temp = legacyPath_ + ".tmp";
+  File out = fs_->open(temp, FILE_WRITE);
+  if (!out) {
+    ESP_LOGE(tag, "Failed to open %s for writing", temp.c_str());
+    return false;
+  }
+  // One sequential pass over the table, one line per entry
+  bool  ok = file_.seek(offset_(0));
+  Entry entry;
+  for (uint32_t i = 0; ok && i < slots_; i++) {
+    ok = file_.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    stats_.reads++;
+    if (!ok || entry.state != SLOT_USED) continue;
+    entry.path[sizeof(entry.path) - 1]           = '\0';
+    entry.timestamp[sizeof(entry.timestamp) - 1] = '\0';
+    ok = out.printf("%s|%s|%lu Bytes|%lu Char\n", entry.path, entry.timestamp,
+                    (unsigned long)entry.bytes, (unsigned long)entry.chars) > 0;
+  }
+  out.close();
+  if (!ok) {
+    ESP_LOGE(tag, "Export failed for %s", legacyPath_.c_str());
+    fs_->remove(temp);
+    return false;
+  }
+
+  if (fs_->exists(legacyPath_)) fs_->remove(legacyPath_);
+  if (!fs_->rename(temp, legacyPath_)) {
+    ESP_LOGE(tag, "Failed to move %s into place", temp.c_str());
+    return false;
+  }
+  // What the next begin() will find, so it doesn't import it straight back
+  legacyHash_ = hashFile_(*fs_, legacyPath_.c_str());
+  changed_    = false;
+  ESP_LOGI(tag, "Exported %u entries to %s", (unsigned)used_, legacyPath_.c_str());
+  return writeHeader_();
+}
+
+bool MetadataIndex::get(const String& path, Entry& out) {
+  if (!fs_) return false;
+  uint32_t slot;
+  uint8_t  state;
+  if (!find_(path.c_str(), slot, state) || state != SLOT_USED) return false;
+  return readSlot_(slot, out);
+}
+
+bool MetadataIndex::put(const String& path, const char* timestamp, uint32_t bytes, uint32_t chars) {
+  if (!fs_) return false;
+  if (path.length() >= sizeof(Entry::path)) {
+    ESP_LOGE(tag, "Path too long for metadata: %s", path.c_str());
+    return false;
+  }
+  Entry entry = {};
+  strncpy(entry.path, path.c_str(), sizeof(entry.path) - 1);
+  strncpy(entry.timestamp, timestamp, sizeof(entry.timestamp) - 1);
+  entry.bytes = bytes;
+  entry.chars = chars;
+  entry.state = SLOT_USED;
+  if (!insert_(entry)) return false;
+  changed_ = true;
+  return true;
+}
+
+bool MetadataIndex::remove(const String& path) {
+  if (!fs_) return false;
+  uint32_t slot;
+  uint8_t  state;
+  if (!find_(path.c_str(), slot, state) || state != SLOT_USED) return true;
+
+  // Freed, not emptied, so probe chains running through the slot stay intact
+  Entry entry = {};
+  entry.state = SLOT_FREED;
+  if (!writeSlot_(slot, entry)) return false;
+  used_--;
+  freed_++;
+  changed_ = true;
+  return true;
+}
+
+bool MetadataIndex::rename(const String& oldPath, const String& newPath) {
+  Entry entry;
+  if (!get(oldPath, entry)) return true;
+  // New record first: a crash in between leaves a duplicate, not a loss
+  if (!put(newPath, entry.timestamp, entry.bytes, entry.chars)) return false;
+  return remove(oldPath);
+}
+
+// ===================== private functions =====================
+bool MetadataIndex::create_(const String& path, uint32_t slots) {
+  File file = fs_->open(path, FILE_WRITE);
+  if (!file) {
+    ESP_LOGE(tag, "Failed to create %s", path.c_str());
+    return false;
+  }
+  Header header = {};
+  header.magic      = magic;
+  header.version    = version;
+  header.slots      = slots;
+  header.legacyHash = legacyHash_;
+  bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+  const Entry empty = {};
+  for (uint32_t i = 0; ok && i < slots; i++) {
+    ok = file.write((const uint8_t*)&empty, sizeof(empty)) == sizeof(empty);
+  }
+  file.close();
+  if (!ok) ESP_LOGE(tag, "Write failed for %s", path.c_str());
+  return ok;
+}
+
+bool MetadataIndex::writeHeader_() {
+  Header header = {};
+  header.magic      = magic;
+  header.version    = version;
+  header.slots      = slots_;
+  header.legacyHash = legacyHash_;
+  stats_.writes++;
+  if (!file_.seek(0) || file_.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+    ESP_LOGE(tag, "Header write failed for %s", path_.c_str());
+    return false;
+  }
+  file_.flush();
+  return true;
+}
+
+bool MetadataIndex::open_(bool* corrupt) {
+  file_ = fs_->open(path_, "r+");
+  if (!file_) {
+    ESP_LOGE(tag, "Failed to open %s", path_.c_str());
+    return false;
+  }
+  Header header;
+  if (file_.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+      header.magic != magic || header.version != version || header.slots == 0 ||
+      file_.size() < offset_(header.slots)) {
+    ESP_LOGE(tag, "Bad metadata index %s", path_.c_str());
+    file_.close();
+    if (corrupt) *corrupt = true;
+    return false;
+  }
+  slots_      = header.slots;
+  legacyHash_ = header.legacyHash;
+
+  // Counts for the load factor, read once per begin() in one sequential pass
+  used_  = 0;
+  freed_ = 0;
+  Entry entry;
+  for (uint32_t i = 0; i < slots_; i++) {
+    if (file_.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) break;
+    if (entry.state == SLOT_USED)  used_++;
+    if (entry.state == SLOT_FREED) freed_++;
+  }
+  return true;
+}
+
+bool MetadataIndex::import_() {
+  const char* legacyPath = legacyPath_.c_str();
+  File legacy = fs_->open(legacyPath, FILE_READ);
+  if (!legacy) return false;
+  // The text file is the whole list: entries removed from it must go too,
+  // or exportText() would write them straight back
+  if (!clear_()) {
+    legacy.close();
+    return false;
+  }
+
+  size_t count = 0;
+  while (legacy.available()) {
+    // path|YYYYMMDD-HHMM|N Bytes|N Char
+    String line = legacy.readStringUntil('\n');
+    line.trim();
+    const int a = line.indexOf('|');
+    const int b = line.indexOf('|', a + 1);
+    const int c = line.indexOf('|', b + 1);
+    if (a <= 0 || b < 0 || c < 0) continue;
+    const String path = line.substring(0, a);
+    const String time = line.substring(a + 1, b);
+    if (put(path, time.c_str(), line.substring(b + 1, c).toInt(), line.substring(c + 1).toInt())) count++;
+  }
+  legacy.close();
+  changed_ = false;  // the index now holds what the text file says
+  ESP_LOGI(tag, "Imported %u entries from %s", (unsigned)count, legacyPath);
+  return true;
+}
+
+// Empties every slot in one sequential pass. A crash part way leaves the
+// header's legacyHash alone, so the next begin() imports again
+bool MetadataIndex::clear_() {
+  const Entry empty = {};
+  bool ok = file_.seek(offset_(0));
+  for (uint32_t i = 0; ok && i < slots_; i++) {
+    ok = file_.write((const uint8_t*)&empty, sizeof(empty)) == sizeof(empty);
+    stats_.writes++;
+  }
+  file_.flush();
+  if (!ok) {
+    ESP_LOGE(tag, "Failed to clear %s", path_.c_str());
+    return false;
+  }
+  used_  = 0;
+  freed_ = 0;
+  return true;
+}
+
+bool MetadataIndex::grow_() {
+  // Mostly freed slots only need a rebuild, not a bigger table
+  const uint32_t slots = (used_ + 1) * 2 > slots_ ? slots_ * 2 : slots_;
+  const String   temp  = path_ + ".tmp";
+  if (!create_(temp, slots)) return false;
+
+  File old = file_;
+  file_ = fs_->open(temp, "r+");
+  if (!file_) {
+    file_ = old;
+    return false;
+  }
+  const uint32_t oldSlots = slots_;
+  slots_ = slots;
+  used_  = 0;
+  freed_ = 0;
+
+  bool  ok = old.seek(offset_(0));
+  Entry entry;
+  for (uint32_t i = 0; ok && i < oldSlots; i++) {
+    ok = old.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    stats_.reads++;
+    if (ok && entry.state == SLOT_USED) ok = insert_(entry);
+  }
+  old.close();
+  file_.close();
+  if (!ok) {
+    ESP_LOGE(tag, "Rebuild failed, keeping %s", path_.c_str());
+    fs_->remove(temp);
+    return open_();
+  }
+
+  fs_->remove(path_);
+  if (!fs_->rename(temp, path_)) return false;
+  ESP_LOGI(tag, "Rebuilt with %u slots", (unsigned)slots);
+  return open_();
+}
+
+bool MetadataIndex::find_(const char* path, uint32_t& slot, uint8_t& state) {
+  const uint32_t start = hash_(path) % slots_;
+  bool  reusable = false;
+  Entry entry;
+  for (uint32_t i = 0; i < slots_; i++) {
+    const uint32_t s = (start + i) % slots_;
+    if (!readSlot_(s, entry)) return false;
+    if (entry.state == SLOT_USED) {
+      if (strncmp(entry.path, path, sizeof(entry.path)) == 0) {
+        slot  = s;
+        state = SLOT_USED;
+        return true;
+      }
+    }
+    else if (entry.state == SLOT_FREED) {
+      if (!reusable) {
+        reusable = true;
+        slot     = s;
+        state    = SLOT_FREED;
+      }
+    }
+    else {
+      if (!reusable) {
+        slot  = s;
+        state = SLOT_EMPTY;
+      }
+      return true;
+    }
+  }
+  return reusable;
+}
+
+bool MetadataIndex::insert_(const Entry& entry) {
+  uint32_t slot;
+  uint8_t  state;
+  if (!find_(entry.path, slot, state)) return false;
+  if (state != SLOT_USED && (used_ + freed_ + 1) * 4 > slots_ * 3) {
+    if (!grow_() || !find_(entry.path, slot, state)) return false;
+  }
+  if (!writeSlot_(slot, entry)) return false;
+  if (state != SLOT_USED) used_++;
+  if (state == SLOT_FREED) freed_--;
+  return true;
+}
+
+bool MetadataIndex::readSlot_(uint32_t slot, Entry& out) {
+  stats_.reads++;
+  return file_.seek(offset_(slot)) && file_.read((uint8_t*)&out, sizeof(out)) == sizeof(out);
+}
+
+bool MetadataIndex::writeSlot_(uint32_t slot, const Entry& entry) {
+  stats_.writes++;
+  if (!file_.seek(offset_(slot)) || file_.write((const uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) {
+    ESP_LOGE(tag, "Write failed for slot %u", (unsigned)slot);
+    return false;
+  }
+  file_.flush();
+  return true;
+}
+
+// FNV-1a
+uint32_t MetadataIndex::hash_(const char* path) {
+  uint32_t h = 2166136261u;
+  while (*path) {
+    h ^= (uint8_t)*path++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// FNV-1a of a file's bytes, 0 when it can't be read
+uint32_t MetadataIndex::hashFile_(fs::FS& fs, const char* path) {
+  File file = fs.open(path, FILE_READ);
+  if (!file) return 0;
+  uint32_t h = 2166136261u;
+  uint8_t  buf[256];
+  size_t   n;
+  while ((n = file.read(buf, sizeof(buf))) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      h ^= buf[i];
+      h *= 16777619u;
+    }
+  }
+  file.close();
+  return h;
+}
@@ -8,10 +8,9 @@
 #include <pocketmage_sd.h>
 #include <pocketmage_oled.h> 
 #include <pocketmage_eink.h> 
+#include <pocketmage_perf.h>
 #include <config.h> // for FULL_REFRESH_AFTER
 
-extern bool SAVE_POWER;
-
 // ===================== main functions =====================
 // Low-Level SDMMC Operations switch to using internal fs::FS*
 void PocketmageSD::listDir(fs::FS &fs, const char *dirname) {
@@ -21,8 +20,7 @@ void PocketmageSD::listDir(fs::FS &fs, const char *dirname) {
     return;
   }
   else {
-    setCpuFrequencyMhz(240);
-    delay(50);
+    PerfGuard perf("SD listDir");
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Listing directory %s\r\n", dirname);
 
@@ -71,7 +69,6 @@ void PocketmageSD::listDir(fs::FS &fs, const char *dirname) {
     // }
 
     if (noTimeout_) *noTimeout_ = false;
-    if (SAVE_POWER) setCpuFrequencyMhz(40);
   }
 }
 void PocketmageSD::readFile(fs::FS &fs, const char *path) {
@@ -81,8 +78,7 @@ void PocketmageSD::readFile(fs::FS &fs, const char *path) {
     return;
   }
   else {
-    setCpuFrequencyMhz(240);
-    delay(50);
+    PerfGuard perf("SD readFile");
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Reading file %s\r\n", path);
 
@@ -95,7 +91,6 @@ void PocketmageSD::readFile(fs::FS &fs, const char *path) {
 
     file.close();
     if (noTimeout_) *noTimeout_ = false;
-    if (SAVE_POWER) setCpuFrequencyMhz(40);
   }
 }
 String PocketmageSD::readFileToString(fs::FS &fs, const char *path) {
@@ -105,14 +100,14 @@ String PocketmageSD::readFileToString(fs::FS &fs, const char *path) {
     return "";
   }
   else { 
-    setCpuFrequencyMhz(240);
-    delay(50);
+    PerfGuard perf("SD readFileToString");
 
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Reading file: %s\r\n", path);
 
-    File file = fs.open(path);
-    if (!file || file.isDirectory()) {
+    SdWorker::Request stat = SdWorker::Request::stat(path);
+    stat.fs = &fs;
+    if (!worker_.run(stat, SdWorker::Interactive)) {
       if (noTimeout_) *noTimeout_ = false;
       ESP_LOGE(tag, "Failed to open file for reading: %s", path);
       if (oled_) oled_->oledWord("Load Failed");
@@ -120,12 +115,18 @@ String PocketmageSD::readFileToString(fs::FS &fs, const char *path) {
       return "";  // Return an empty string on failure
     }
 
-    // TODO: Can't we use readString()?
-    // Serial.println("- reading from file:");
-    ESP_LOGI(tag, "Reading from file: %s", file.path());
-    String content = file.readString();
-
-    file.close();
+    // Sequential chunks, so the block cache reads ahead of us
+    String content;
+    content.reserve(stat.result);
+    uint8_t buf[512];
+    for (size_t offset = 0; offset < stat.result; ) {
+      SdWorker::Request req = SdWorker::Request::read(path, buf, min(sizeof(buf), stat.result - offset), offset);
+      req.fs = &fs;
+      worker_.run(req, SdWorker::Interactive);
+      if (req.result == 0) break;
+      content.concat((const char*)buf, req.result);
+      offset += req.result;
+    }
     if (eink_) eink_->setFullRefreshAfter(FULL_REFRESH_AFTER); //Force a full refresh
     if (noTimeout_) *noTimeout_ = false;
     return content;  // Return the complete String
@@ -138,27 +139,19 @@ void PocketmageSD::writeFile(fs::FS &fs, const char *path, const char *message)
     return;
   }
   else {
-    setCpuFrequencyMhz(240);
-    delay(50);
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Writing file: %s\r\n", path);
-    delay(200);
 
-    File file = fs.open(path, FILE_WRITE);
-    if (!file) {
-      if (noTimeout_) *noTimeout_ = false;
-      ESP_LOGE(tag, "Failed to open %s for writing", path);
-      return;
-    }
-    if (file.print(message)) {
+    // Runs on the worker's background lane, behind any pending reads
+    SdWorker::Request req = SdWorker::Request::write(path, (const uint8_t*)message, strlen(message));
+    req.fs = &fs;
+    if (worker_.run(req, SdWorker::Background)) {
       ESP_LOGV(tag, "File written %s", path);
     } 
     else {
       ESP_LOGE(tag, "Write failed for %s", path);
     }
-    file.close();
     if (noTimeout_) *noTimeout_ = false;
-    if (SAVE_POWER) setCpuFrequencyMhz(40);
   }
 }
 void PocketmageSD::appendFile(fs::FS &fs, const char *path, const char *message) {
@@ -168,26 +161,20 @@ void PocketmageSD::appendFile(fs::FS &fs, const char *path, const char *message)
     return;
   }
   else {
-    setCpuFrequencyMhz(240);
-    delay(50);
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Appending to file: %s\r\n", path);
 
-    File file = fs.open(path, FILE_APPEND);
-    if (!file) {
-      if (noTimeout_) *noTimeout_ = false;
-      ESP_LOGE(tag, "Failed to open for appending: %s", path);
-      return;
-    }
-    if (file.println(message)) {
+    // One request with the line end println() used to add, so another
+    // append can't split the line
+    SdWorker::Request req = SdWorker::Request::append(path, (const uint8_t*)message, strlen(message), true);
+    req.fs = &fs;
+    if (worker_.run(req, SdWorker::Background)) {
       ESP_LOGV(tag, "Message appended to %s", path);
     } 
     else {
       ESP_LOGE(tag, "Append failed: %s", path);
     }
-    file.close();
     if (noTimeout_) *noTimeout_ = false;
-    if (SAVE_POWER) setCpuFrequencyMhz(40);
   }
 }
 void PocketmageSD::renameFile(fs::FS &fs, const char *path1, const char *path2) {
@@ -197,11 +184,12 @@ void PocketmageSD::renameFile(fs::FS &fs, const char *path1, const char *path2)
     return;
   }
   else {
-    setCpuFrequencyMhz(240);
-    delay(50);
+    PerfGuard perf("SD renameFile");
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Renaming file %s to %s\r\n", path1, path2);
 
+    worker_.invalidate(path1);
+    worker_.invalidate(path2);
     if (fs.rename(path1, path2)) {
       ESP_LOGV(tag, "Renamed %s to %s\r\n", path1, path2);
     } 
@@ -209,7 +197,6 @@ void PocketmageSD::renameFile(fs::FS &fs, const char *path1, const char *path2)
       ESP_LOGE(tag, "Rename failed: %s to %s", path1, path2);
     }
     if (noTimeout_) *noTimeout_ = false;
-    if (SAVE_POWER) setCpuFrequencyMhz(40);
   }
 }
 void PocketmageSD::deleteFile(fs::FS &fs, const char *path) {
@@ -219,10 +206,10 @@ void PocketmageSD::deleteFile(fs::FS &fs, const char *path) {
     return;
   }
   else {
-    setCpuFrequencyMhz(240);
-    delay(50);
+    PerfGuard perf("SD deleteFile");
     if (noTimeout_) *noTimeout_ = true;
     ESP_LOGI(tag, "Deleting file: %s\r\n", path);
+    worker_.invalidate(path);
     if (fs.remove(path)) {
       ESP_LOGV(tag, "File deleted: %s", path);
     } 
@@ -230,7 +217,6 @@ void PocketmageSD::deleteFile(fs::FS &fs, const char *path) {
       ESP_LOGE(tag, "Delete failed for %s", path);
     }
    if (noTimeout_) *noTimeout_ = false;
-    if (SAVE_POWER) setCpuFrequencyMhz(40);
   }
 }
 bool PocketmageSD::readBinaryFile(const char* path, uint8_t* buf, size_t len) {
@@ -243,37 +229,24 @@ bool PocketmageSD::readBinaryFile(const char* path, uint8_t* buf, size_t len) {
     return false;
   }
 
-  setCpuFrequencyMhz(240);
   if (noTimeout_)
     *noTimeout_ = true;
 
-  File f = fileSys_->open(path, "r");
-  if (!f || f.isDirectory()) {
-    if (noTimeout_)
-      *noTimeout_ = false;
-    ESP_LOGE(tag, "Failed to open file: %s", path);
-    return false;
-  }
-
-  size_t n = f.read(buf, len);
-  f.close();
+  SdWorker::Request req = SdWorker::Request::read(path, buf, len);
+  const bool ok = worker_.run(req, SdWorker::Interactive);
+  if (!ok)
+    ESP_LOGE(tag, "Failed to read file: %s", path);
 
   if (noTimeout_)
     *noTimeout_ = false;
-  if (SAVE_POWER)
-    setCpuFrequencyMhz(40);
 
-  return n == len;
+  return ok;
 }
 
 size_t PocketmageSD::getFileSize(const char* path) {
   if (!fileSys_ || (noSD_ && *noSD_))
     return 0;
 
-  File f = fileSys_->open(path, "r");
-  if (!f)
-    return 0;
-  size_t size = f.size();
-  f.close();
-  return size;
+  SdWorker::Request req = SdWorker::Request::stat(path);
+  return worker_.run(req, SdWorker::Interactive) ? req.result : 0;
 }
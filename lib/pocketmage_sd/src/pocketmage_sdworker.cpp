@@ -0,0 +1,164 @@
+#include <pocketmage_sdworker.h>
+#include <pocketmage_perf.h>
+#include <config.h>  // for SD_CACHE_BLOCKS, SD_CACHE_BLOCK_SIZE
+
+// ===================== requests =====================
+SdWorker::Request SdWorker::Request::read(const char* path, uint8_t* buf, size_t len, size_t offset) {
+  Request req;
+  req.op     = Op::Read;
+  req.path   = path;
+  req.buf    = buf;
+  req.len    = len;
+  req.offset = offset;
+  return req;
+}
+
+SdWorker::Request SdWorker::Request::write(const char* path, const uint8_t* data, size_t len) {
+  Request req;
+  req.op   = Op::Write;
+  req.path = path;
+  req.data = data;
+  req.len  = len;
+  return req;
+}
+
+SdWorker::Request SdWorker::Request::append(const char* path, const uint8_t* data, size_t len, bool eol) {
+  Request req = write(path, data, len);
+  req.op  = Op::Append;
+  req.eol = eol;
+  return req;
+}
+
+SdWorker::Request SdWorker::Request::stat(const char* path) {
+  Request req;
+  req.op   = Op::Stat;
+  req.path = path;
+  return req;
+}
+
+// ===================== main functions =====================
+bool SdWorker::begin(fs::FS* fileSys) {
+  if (task_) return true;
+  fileSys_ = fileSys;
+  // Both locks exist before the task does, so nothing races to create them
+  if (!handles_.begin()) return false;
+  cache_.begin(SD_CACHE_BLOCKS, SD_CACHE_BLOCK_SIZE);
+  for (QueueHandle_t& lane : lanes_) {
+    if (!lane) lane = xQueueCreate(queueDepth, sizeof(Request*));
+    if (!lane) return false;
+  }
+  xTaskCreatePinnedToCore(
+    taskMain_,           // Function name
+    "sdWorker",          // Task name
+    4096,                // Stack size
+    this,                // Parameters
+    2,                   // Priority, above the loop and eink tasks it serves
+    &task_,              // Task handle
+    1                    // Core ID
+  );
+  if (!task_) ESP_LOGE(tag, "Failed to start worker task");
+  return task_ != nullptr;
+}
+
+void SdWorker::invalidate(const char* path) {
+  handles_.invalidate(path);
+  cache_.invalidate(path);
+}
+
+bool SdWorker::onWorkerTask() const {
+  return task_ && xTaskGetCurrentTaskHandle() == task_;
+}
+
+bool SdWorker::submit(Request& req, Lane lane) {
+  if (!task_ || lane >= LaneCount) return false;
+  if (!req.signal_) req.signal_ = xSemaphoreCreateBinaryStatic(&req.signalStore_);
+  xSemaphoreTake(req.signal_, 0);  // clear a completion left from an earlier run
+
+  req.ok     = false;
+  req.result = 0;
+  Request* item = &req;
+  if (xQueueSend(lanes_[lane], &item, portMAX_DELAY) != pdTRUE) return false;
+  // One notification per request, so the worker takes exactly one per item
+  xTaskNotifyGive(task_);
+  return true;
+}
+
+bool SdWorker::wait(Request& req) {
+  if (!req.signal_) return req.ok;
+  xSemaphoreTake(req.signal_, portMAX_DELAY);
+  return req.ok;
+}
+
+bool SdWorker::run(Request& req, Lane lane) {
+  if (!task_ || onWorkerTask()) {
+    execute_(req);
+    if (req.done) req.done(req, req.ctx);
+    return req.ok;
+  }
+  return submit(req, lane) && wait(req);
+}
+
+// ===================== private functions =====================
+void SdWorker::execute_(Request& req) {
+  req.ok     = false;
+  req.result = 0;
+  fs::FS* fileSys = req.fs ? req.fs : fileSys_;
+  if (!fileSys || !req.path) return;
+
+  PerfGuard perf("SD worker");
+  switch (req.op) {
+    case Op::Read:
+      req.result = cache_.read(*fileSys, req.path, req.offset, req.buf, req.len);
+      req.ok     = req.result == req.len;
+      break;
+    case Op::Write:
+    case Op::Append: {
+      // A cached read handle would keep the old size
+      handles_.invalidate(req.path);
+      File f = fileSys->open(req.path, req.op == Op::Write ? FILE_WRITE : FILE_APPEND);
+      if (!f) break;
+      req.result = f.write(req.data, req.len);
+      req.ok     = req.result == req.len;
+      if (req.ok && req.op == Op::Append && req.eol) req.ok = f.write((const uint8_t*)"\r\n", 2) == 2;
+      f.close();
+      cache_.invalidate(req.path);
+      break;
+    }
+    case Op::Stat: {
+      if (!handles_.ready()) {
+        File f = fileSys->open(req.path, FILE_READ);
+        if (f && !f.isDirectory()) {
+          req.result = f.size();
+          req.ok     = true;
+        }
+        if (f) f.close();
+        break;
+      }
+      File* f = handles_.acquire(*fileSys, req.path);
+      if (f) {
+        req.result = f->size();
+        req.ok     = true;
+      }
+      handles_.release();
+      break;
+    }
+  }
+  if (!req.ok) ESP_LOGE(tag, "Request %d failed: %s", (int)req.op, req.path);
+}
+
+void SdWorker::taskMain_(void* parameter) {
+  SdWorker* self = static_cast<SdWorker*>(parameter);
+  for (;;) {
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+    Request* req = nullptr;
+    for (QueueHandle_t lane : self->lanes_) {
+      if (xQueueReceive(lane, &req, 0) == pdTRUE) break;
+    }
+    if (!req) continue;
+
+    self->execute_(*req);
+    if (req->done) req->done(*req, req->ctx);
+    xSemaphoreGive(req->signal_);
+  }
+}
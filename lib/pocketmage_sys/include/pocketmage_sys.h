@@ -40,5 +40,6 @@ void PocketMage_INIT();
 // ===================== GLOBAL TEXT HELPERS =====================
 String vectorToString();
 void stringToVector(String inputText);
+void reflowLines();
 String removeChar(String str, char character);
 int stringToInt(String str);
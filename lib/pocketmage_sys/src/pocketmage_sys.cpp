@@ -7,6 +7,9 @@
 #include <pocketmage_bz.h>
 #include <pocketmage_touch.h>
 #include <pocketmage_clock.h>
+#include <pocketmage_journal.h>
+#include <pocketmage_metadata.h>
+#include <pocketmage_perf.h>
 #include <config.h>
 #include <RTClib.h>
 #include <SD_MMC.h>
@@ -18,6 +21,23 @@
 
 static constexpr const char* TAG = "SYSTEM";
 
+// Tracks what of editingFile is on the SD card, so saves only write edits
+static TextJournal journal;
+// File metadata, opened on first use
+static MetadataIndex metadata;
+
+// Flush hook: no file handle may stay open across a restart or deep sleep,
+// and PocketMage OS or a PC must find the edits in the file, not the
+// journal, and the metadata in the text file
+static void closeFiles() {
+    SD().closeHandles();
+    if (!noSD && !journal.flush(SD_MMC, editingFile, allLines))
+        ESP_LOGE(TAG, "Flush failed: %s", editingFile.c_str());
+    // PocketMage OS reads the text file, not the index
+    metadata.exportText();
+    metadata.end();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //            Use this function in apps to return to PocketMage OS           //
 bool rebootToPocketMage() {
@@ -37,17 +57,18 @@ bool rebootToPocketMage() {
     }
 
     Serial.println("Boot partition set to OTA0 (PocketMage OS). Restarting...");
+    closeFiles();
     esp_restart();
     return true;
 }
 ///////////////////////////////////////////////////////////////////////////////
 
 // Helpers
-static int countVisibleChars(String input) {
-  int count = 0;
+static size_t countVisibleChars(const char* text, size_t length) {
+  size_t count = 0;
 
-  for (size_t i = 0; i < input.length(); i++) {
-    char c = input[i];
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
     // Check if the character is a visible character or space
     if (c >= 32 && c <= 126) {  // ASCII range for printable characters and space
       count++;
@@ -57,6 +78,23 @@ static int countVisibleChars(String input) {
   return count;
 }
 
+// Counts a file in fixed chunks, never holding more than one in memory
+static bool countFile(const String& path, size_t& bytes, size_t& chars) {
+  File file = SD_MMC.open(path);
+  if (!file || file.isDirectory()) return false;
+
+  char buf[512];
+  bytes = 0;
+  chars = 0;
+  size_t n;
+  while ((n = file.read((uint8_t*)buf, sizeof(buf))) > 0) {
+    bytes += n;
+    chars += countVisibleChars(buf, n);
+  }
+  file.close();
+  return true;
+}
+
 namespace pocketmage::file{
     
     void saveFile() {
@@ -66,11 +104,7 @@ namespace pocketmage::file{
         return;
     } else {
         SDActive = true;
-        setCpuFrequencyMhz(240);
-        delay(50);
-
-        String textToSave = vectorToString();
-        ESP_LOGV(TAG, "Text to save: %s", textToSave.c_str());
+        PerfGuard perf("saveFile");
 
         if (editingFile == "" || editingFile == "-")
         editingFile = "/temp.txt";
@@ -78,7 +112,12 @@ namespace pocketmage::file{
         if (!editingFile.startsWith("/"))
         editingFile = "/" + editingFile;
         // OLED().oledWord("Saving File: "+ editingFile);
-        SD().writeFile(SD_MMC, (editingFile).c_str(), textToSave.c_str());
+        // Written around the SD worker, and a compaction replaces the file:
+        // no cached handle may stay open on it
+        SD().worker().invalidate(editingFile.c_str());
+        // Writes only what changed since the last load/save
+        if (!journal.save(SD_MMC, editingFile, allLines))
+        ESP_LOGE(TAG, "Save failed: %s", editingFile.c_str());
         // OLED().oledWord("Saved: "+ editingFile);
 
         // Write MetaData
@@ -86,72 +125,35 @@ namespace pocketmage::file{
 
         // delay(1000);
         keypad.enableInterrupts();
-        if (SAVE_POWER)
-        setCpuFrequencyMhz(POWER_SAVE_FREQ);
         SDActive = false;
     }
     }
     
     void writeMetadata(const String& path) {
-    File file = SD_MMC.open(path);
-    if (!file || file.isDirectory()) {
-        ESP_LOGE(TAG, "Invalid file for metadata: %s", file.path());
+    size_t fileSizeBytes = 0;
+    size_t charCount     = 0;
+
+    if (path == journal.path()) {
+        // The open document is what the file and its journal add up to
+        fileSizeBytes = allLines.length();
+        charCount     = countVisibleChars(allLines.text(), fileSizeBytes);
+    } else if (!countFile(path, fileSizeBytes, charCount)) {
+        ESP_LOGE(TAG, "Invalid file for metadata: %s", path.c_str());
         return;
     }
 
-    // Get file size
-    size_t fileSizeBytes = file.size();
-    file.close();
-
-    // Format size string
-    String fileSizeStr = String(fileSizeBytes) + " Bytes";
-
-    // Get line and char counts
-    int charCount = countVisibleChars(SD().readFileToString(SD_MMC, path.c_str()));
-
-    String charStr = String(charCount) + " Char";
-
     // Get current time from RTC
     DateTime now = CLOCK().nowDT();
     char timestamp[20];
     sprintf(timestamp, "%04d%02d%02d-%02d%02d", now.year(), now.month(), now.day(), now.hour(),
             now.minute());
 
-    // Compose new metadata line
-    String newEntry = path + "|" + timestamp + "|" + fileSizeStr + "|" + charStr;
-
-    const char* metaPath = SYS_METADATA_FILE;
-
-    // Read existing entries and rebuild the file without duplicates
-    File metaFile = SD_MMC.open(metaPath, FILE_READ);
-    String updatedMeta = "";
-    bool replaced = false;
-
-    if (metaFile) {
-        while (metaFile.available()) {
-        String line = metaFile.readStringUntil('\n');
-        if (line.startsWith(path + "|")) {
-            updatedMeta += newEntry + "\n";
-            replaced = true;
-        } else if (line.length() > 1) {
-            updatedMeta += line + "\n";
-        }
-        }
-        metaFile.close();
-    }
-
-    if (!replaced) {
-        updatedMeta += newEntry + "\n";
-    }
-
-    // Write back the updated metadata
-    metaFile = SD_MMC.open(metaPath, FILE_WRITE);
-    if (!metaFile) {
-        ESP_LOGE(TAG, "Failed to open metadata file for writing: %s", metaPath);
+    // Update this file's record in place
+    if (!metadata.begin(SD_MMC, SYS_METADATA_INDEX, SYS_METADATA_FILE) ||
+        !metadata.put(path, timestamp, fileSizeBytes, charCount)) {
+        ESP_LOGE(TAG, "Failed to update metadata for %s", path.c_str());
         return;
     }
-    metaFile.print(updatedMeta);
-    metaFile.close();
 
     ESP_LOGI(TAG, "Metadata updated");
     }
@@ -163,25 +165,26 @@ namespace pocketmage::file{
         return;
     } else {
         SDActive = true;
-        setCpuFrequencyMhz(240);
-        delay(50);
+        PerfGuard perf("loadFile");
 
         keypad.disableInterrupts();
         if (showOLED)
         OLED().oledWord("Loading File");
         if (!editingFile.startsWith("/"))
         editingFile = "/" + editingFile;
-        String textToLoad = SD().readFileToString(SD_MMC, (editingFile).c_str());
-        ESP_LOGV(TAG, "Text to load: %s", textToLoad.c_str());
-
-        stringToVector(textToLoad);
+        EINK().setTXTFont(EINK().getCurrentFont());
+        SD().worker().invalidate(editingFile.c_str());  // replaying may compact the file
+        const bool loaded = journal.load(SD_MMC, editingFile, allLines);
+        if (!loaded) {
+        OLED().oledWord("Load Failed");
+        delay(500);
+        }
+        reflowLines();
         keypad.enableInterrupts();
         if (showOLED) {
         OLED().oledWord("File Loaded");
         delay(200);
         }
-        if (SAVE_POWER)
-        setCpuFrequencyMhz(POWER_SAVE_FREQ);
         SDActive = false;
     }
     }
@@ -193,62 +196,30 @@ namespace pocketmage::file{
         return;
     } else {
         SDActive = true;
-        setCpuFrequencyMhz(240);
-        delay(50);
+        PerfGuard perf("delFile");
 
         keypad.disableInterrupts();
         // OLED().oledWord("Deleting File: "+ fileName);
         if (!fileName.startsWith("/"))
         fileName = "/" + fileName;
         SD().deleteFile(SD_MMC, fileName.c_str());
+        TextJournal::remove(SD_MMC, fileName);
+        journal.forget(fileName);
         // OLED().oledWord("Deleted: "+ fileName);
 
         // Delete MetaData
         pocketmage::file::deleteMetadata(fileName);
 
-        delay(1000);
         keypad.enableInterrupts();
-        if (SAVE_POWER)
-        setCpuFrequencyMhz(POWER_SAVE_FREQ);
         SDActive = false;
     }
     }
     
     void deleteMetadata(String path) {
-    const char* metaPath = SYS_METADATA_FILE;
-
-    // Open metadata file for reading
-    File metaFile = SD_MMC.open(metaPath, FILE_READ);
-    if (!metaFile) {
-        ESP_LOGE(TAG, "Metadata file not found: %s", metaPath);
-        return;
-    }
-
-    // Store lines that don't match the given path
-    std::vector<String> keptLines;
-    while (metaFile.available()) {
-        String line = metaFile.readStringUntil('\n');
-        if (!line.startsWith(path + "|")) {
-        keptLines.push_back(line);
-        }
-    }
-    metaFile.close();
-
-    // Delete the original metadata file
-    SD_MMC.remove(metaPath);
-
-    // Recreate the file and write back the kept lines
-    File writeFile = SD_MMC.open(metaPath, FILE_WRITE);
-    if (!writeFile) {
-        ESP_LOGE(TAG, "Failed to recreate metadata file. %s", writeFile.path());
+    if (!metadata.begin(SD_MMC, SYS_METADATA_INDEX, SYS_METADATA_FILE) || !metadata.remove(path)) {
+        ESP_LOGE(TAG, "Failed to delete metadata for %s", path.c_str());
         return;
     }
-
-    for (const String& line : keptLines) {
-        writeFile.println(line);
-    }
-
-    writeFile.close();
     ESP_LOGI(TAG, "Metadata entry deleted (if it existed).");
     }
     
@@ -259,8 +230,7 @@ namespace pocketmage::file{
         return;
     } else {
         SDActive = true;
-        setCpuFrequencyMhz(240);
-        delay(50);
+        PerfGuard perf("renFile");
 
         keypad.disableInterrupts();
         // OLED().oledWord("Renaming "+ oldFile + " to " + newFile);
@@ -269,6 +239,8 @@ namespace pocketmage::file{
         if (!newFile.startsWith("/"))
         newFile = "/" + newFile;
         SD().renameFile(SD_MMC, oldFile.c_str(), newFile.c_str());
+        TextJournal::rename(SD_MMC, oldFile, newFile);
+        journal.forget(oldFile);
         OLED().oledWord(oldFile + " -> " + newFile);
         delay(1000);
 
@@ -276,63 +248,18 @@ namespace pocketmage::file{
         pocketmage::file::renMetadata(oldFile, newFile);
 
         keypad.enableInterrupts();
-        if (SAVE_POWER)
-        setCpuFrequencyMhz(POWER_SAVE_FREQ);
         SDActive = false;
     }
     }
     
     void renMetadata(String oldPath, String newPath) {
-    setCpuFrequencyMhz(240);
-    const char* metaPath = SYS_METADATA_FILE;
-
-    // Open metadata file for reading
-    File metaFile = SD_MMC.open(metaPath, FILE_READ);
-    if (!metaFile) {
-        ESP_LOGE(TAG, "Metadata file not found: %s", metaPath);
-        return;
-    }
-
-    std::vector<String> updatedLines;
-
-    while (metaFile.available()) {
-        String line = metaFile.readStringUntil('\n');
-        if (line.startsWith(oldPath + "|")) {
-        // Replace old path with new path at the start of the line
-        int separatorIndex = line.indexOf('|');
-        if (separatorIndex != -1) {
-            // Keep rest of line after '|'
-            String rest = line.substring(separatorIndex);
-            line = newPath + rest;
-        } else {
-            // Just replace whole line with new path if malformed
-            line = newPath;
-        }
-        }
-        updatedLines.push_back(line);
-    }
-
-    metaFile.close();
-
-    // Delete old metadata file
-    SD_MMC.remove(metaPath);
-
-    // Recreate file and write updated lines
-    File writeFile = SD_MMC.open(metaPath, FILE_WRITE);
-    if (!writeFile) {
-        ESP_LOGE(TAG, "Failed to recreate metadata file. %s", writeFile.path());
-        return;
+    PerfGuard perf("renMetadata");
+    if (!metadata.begin(SD_MMC, SYS_METADATA_INDEX, SYS_METADATA_FILE) ||
+        !metadata.rename(oldPath, newPath)) {
+        ESP_LOGE(TAG, "Failed to rename metadata for %s", oldPath.c_str());
+    } else {
+        ESP_LOGI(TAG, "Metadata updated for renamed file.");
     }
-
-    for (const String& l : updatedLines) {
-        writeFile.println(l);
-    }
-
-    writeFile.close();
-    ESP_LOGI(TAG, "Metadata updated for renamed file.");
-
-    if (SAVE_POWER)
-        setCpuFrequencyMhz(40);
     }
     
     void copyFile(String oldFile, String newFile) {
@@ -342,8 +269,7 @@ namespace pocketmage::file{
         return;
     } else {
         SDActive = true;
-        setCpuFrequencyMhz(240);
-        delay(50);
+        PerfGuard perf("copyFile");
 
         keypad.disableInterrupts();
         OLED().oledWord("Loading File");
@@ -351,6 +277,8 @@ namespace pocketmage::file{
         oldFile = "/" + oldFile;
         if (!newFile.startsWith("/"))
         newFile = "/" + newFile;
+        SD().worker().invalidate(oldFile.c_str());
+        journal.flush(SD_MMC, oldFile, allLines);  // copy the edits too
         String textToLoad = SD().readFileToString(SD_MMC, (oldFile).c_str());
         SD().writeFile(SD_MMC, (newFile).c_str(), textToLoad.c_str());
         OLED().oledWord("Saved: " + newFile);
@@ -361,8 +289,6 @@ namespace pocketmage::file{
         delay(1000);
         keypad.enableInterrupts();
 
-        if (SAVE_POWER)
-        setCpuFrequencyMhz(POWER_SAVE_FREQ);
         SDActive = false;
     }
     }
@@ -374,19 +300,19 @@ namespace pocketmage::file{
         return;
     } else {
         SDActive = true;
-        setCpuFrequencyMhz(240);
-        delay(50);
+        PerfGuard perf("appendToFile");
 
         keypad.disableInterrupts();
+        SD().worker().invalidate(path.c_str());
+        journal.flush(SD_MMC, path, allLines);
         SD().appendFile(SD_MMC, path.c_str(), inText.c_str());
+        journal.forget(path);
 
         // Write MetaData
         pocketmage::file::writeMetadata(path);
 
         keypad.enableInterrupts();
 
-        if (SAVE_POWER)
-        setCpuFrequencyMhz(POWER_SAVE_FREQ);
         SDActive = false;
     }
     }
@@ -477,6 +403,7 @@ namespace pocketmage::time{
 
         // Sleep the device
         BZ().playJingle(Jingles::Shutdown);
+        closeFiles();
         esp_deep_sleep_start();
         }
     } else {
@@ -636,6 +563,7 @@ namespace pocketmage::power{
     prefs.end();
 
     // Sleep the ESP32
+    closeFiles();
     esp_deep_sleep_start();
     }
     
@@ -775,6 +703,18 @@ namespace pocketmage::debug{
         digitalRead(PWR_BTN), digitalRead(KB_IRQ), digitalRead(CHRG_SENS), digitalRead(RTC_INT),
         batteryVoltage, (float)getCpuFrequencyMhz(), (int)GxEPD2_310_GDEQ031T10::useFastFullUpdate);
 
+    // SD/CPU clock switching cost so far
+    const PerfGuard::Stats& perf = PerfGuard::stats();
+    ESP_LOGD(TAG, "PERF: %lu ops, %lu clock switches, %lu nested, %lu ms busy",
+        (unsigned long)perf.operations, (unsigned long)perf.switches, (unsigned long)perf.nested,
+        (unsigned long)(perf.busyMicros / 1000));
+
+    // SD read cache
+    const BlockCache::Stats& cache = SD().worker().cache().stats();
+    ESP_LOGD(TAG, "SD_CACHE: %.0f%% hits (%lu/%lu), %lu read ahead, %llu bytes read, %llu from card",
+        cache.hitRatio() * 100.0f, (unsigned long)cache.hits, (unsigned long)(cache.hits + cache.misses),
+        (unsigned long)cache.readAhead, (unsigned long long)cache.bytesRead, (unsigned long long)cache.cardBytes);
+
     // Display system time
     ESP_LOGD(TAG, "SYSTEM_CLOCK: %d/%d/%d (%s) %d:%d:%d", now.month(), now.day(), now.year(),
         daysOfTheWeek[now.dayOfTheWeek()], now.hour(), now.minute(), now.second());
@@ -783,68 +723,25 @@ namespace pocketmage::debug{
 }    // namespace pocketmage::debug
 
 // ===================== GLOBAL TEXT HELPERS =====================
+// The document keeps the text as loaded or typed, hard breaks included,
+// so saving is a straight copy
 String vectorToString() {
-String result;
-EINK().setTXTFont(EINK().getCurrentFont());
-
-for (size_t i = 0; i < allLines.size(); i++) {
-    result += allLines[i];
-
-    int16_t x1, y1;
-    uint16_t charWidth, charHeight;
-    display.getTextBounds(allLines[i], 0, 0, &x1, &y1, &charWidth, &charHeight);
-
-    // Add newline only if the line doesn't fully use the available space
-    if (charWidth < display.width() && i < allLines.size() - 1) {
-    result += '\n';
-    }
-}
-
-return result;
+return String(allLines.text(), allLines.length());
 }
 
 void stringToVector(String inputText) {
 EINK().setTXTFont(EINK().getCurrentFont());
-allLines.clear();
-String currentLine_;
-
-for (size_t i = 0; i < inputText.length(); i++) {
-    char c = inputText[i];
-
-    int16_t x1, y1;
-    uint16_t charWidth, charHeight;
-    display.getTextBounds(currentLine_, 0, 0, &x1, &y1, &charWidth, &charHeight);
-
-    // Check if new line needed
-    if ((c == '\n' || charWidth >= display.width() - 5) && !currentLine_.isEmpty()) {
-    if (currentLine_.endsWith(" ")) {
-        allLines.push_back(currentLine_);
-        currentLine_ = "";
-    } else {
-        int lastSpace = currentLine_.lastIndexOf(' ');
-        if (lastSpace != -1) {
-        // Split line at last space
-        String partialWord = currentLine_.substring(lastSpace + 1);
-        currentLine_ = currentLine_.substring(0, lastSpace);
-        allLines.push_back(currentLine_);
-        currentLine_ = partialWord;  // Start new line with partial word
-        } else {
-        // No spaces, whole line is a single word
-        allLines.push_back(currentLine_);
-        currentLine_ = "";
-        }
-    }
-    }
-
-    if (c != '\n') {
-    currentLine_ += c;
-    }
+allLines.load(inputText.c_str(), inputText.length());
+reflowLines();
 }
 
-// Push last line if not empty
-if (!currentLine_.isEmpty()) {
-    allLines.push_back(currentLine_);
-}
+// Rebuilds the display lines after the text or the font changed
+void reflowLines() {
+const FontMetrics& metrics = FontMetrics::of(EINK().getCurrentFont());
+const uint16_t     maxWidth = display.width() - 5;
+allLines.reflow([&](const char* text, size_t length, const TextDocument::SpanFn& emit) {
+    TextWrap::wrap(text, length, metrics, maxWidth, emit);
+});
 }
 
 String removeChar(String str, char character) {
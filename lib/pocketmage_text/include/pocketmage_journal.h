@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+
+class TextDocument;
+
+// ===================== TEXT JOURNAL =====================
+// Saves a TextDocument without rewriting the whole file each time.
+//
+// A save writes only the text after the document's dirtyFrom() point. When
+// that is the end of the file on disk (the usual case, typing at the end),
+// the new text is appended to the file itself. Otherwise a record "cut the
+// text at offset, then append these bytes" goes to an append-only journal
+// next to the file (<path>.jnl), and load() replays it. Once the journal
+// outgrows half the document it is compacted: the full text goes to
+// <path>.tmp, replaces the file, and the journal is removed.
+//
+// Replaying a journal onto a file that already holds its edits gives the
+// same text again, so a crash between writing the file and removing the
+// journal loses nothing. A torn last record is dropped.
+//
+// The journal starts with the length and CRC-32 of the file it was written
+// against. If the file was changed elsewhere since (a PC, PocketMage OS),
+// the journal no longer applies and is discarded rather than replayed onto
+// different text.
+class TextJournal {
+public:
+  explicit TextJournal() {}
+
+  // Reads path and its journal into doc, and takes over saving it
+  bool load(fs::FS& fs, const String& path, TextDocument& doc);
+  // Writes the edits since the last load/save
+  bool save(fs::FS& fs, const String& path, TextDocument& doc);
+  // Writes the full text to path and drops the journal
+  bool compact(fs::FS& fs, const String& path, TextDocument& doc);
+  // Brings the file itself up to date, e.g. before it is copied
+  bool flush(fs::FS& fs, const String& path, TextDocument& doc);
+  // Stop tracking path, e.g. after something else wrote to it
+  void forget(const String& path)          { if (path == path_) path_ = ""; }
+  const String& path() const                                { return path_; }
+
+  // Keep a journal with its file
+  static void remove(fs::FS& fs, const String& path);
+  static void rename(fs::FS& fs, const String& oldPath, const String& newPath);
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint32_t baseLength;   // the file the records apply to
+    uint32_t baseCrc;
+  };
+  struct Record {
+    uint32_t magic;
+    uint32_t offset;   // text from here on is replaced
+    uint32_t length;   // by this many bytes following the record
+  };
+
+  static constexpr const char* tag          = "TEXT_JNL";
+  static constexpr uint32_t    headerMagic  = 0x324A4D50;  // "PMJ2"
+  static constexpr uint32_t    recordMagic  = 0x314A4D50;  // "PMJ1"
+  static constexpr size_t      minCompact   = 16 * 1024;   // journal bytes before compacting
+  static constexpr size_t      chunk        = 512;         // stack buffer for reads
+
+  static String journalPath_(const String& path) { return path + ".jnl"; }
+  static String tempPath_(const String& path)    { return path + ".tmp"; }
+  bool replay_(fs::FS& fs, const String& path, TextDocument& doc);
+  static bool readInto_(File& file, size_t length, TextDocument& doc, uint32_t* crc = nullptr);
+  static uint32_t crc32_(uint32_t crc, const char* data, size_t length);
+
+  String   path_;              // file the state below describes
+  size_t   baseLength_   = 0;  // bytes in the file itself
+  uint32_t baseCrc_      = 0;  // and their CRC-32
+  size_t   journalBytes_ = 0;  // bytes in its journal, header included
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+// One display line of a TextDocument, a view into the document buffer.
+// Not NUL terminated, and only valid until the document is changed. A line
+// the gap falls into comes in two parts, data then tail.
+struct TextLine {
+  const char* data       = nullptr;
+  uint16_t    length     = 0;
+  const char* tail       = nullptr;
+  uint16_t    tailLength = 0;
+
+  size_t size() const                                { return length + tailLength; }
+  char   charAt(size_t i) const                      { return i < length ? data[i] : tail[i - length]; }
+  bool   startsWith(const char* prefix) const;
+  // Copies up to n - 1 characters from offset from, NUL terminated
+  size_t copy(char* dst, size_t n, size_t from = 0) const;
+};
+
+// ===================== TEXT DOCUMENT =====================
+// The editor text as one gap buffer plus an index of display lines, in
+// place of a String per line. Typing and deleting at the cursor moves the
+// gap, not the text behind it, and the whole document lives in two
+// allocations (buffer and line index) that only grow, geometrically, so a
+// long session doesn't fragment the heap. The buffer goes to PSRAM when
+// there is some.
+//
+// Lines are spans of the text set by reflow(), which takes the wrapping
+// rules (see TextWrap) so this class stays display agnostic. Edits leave the
+// line index stale until the next reflow().
+class TextDocument {
+public:
+  using SpanFn = std::function<void(size_t offset, size_t length)>;
+  using WrapFn = std::function<void(const char* text, size_t length, const SpanFn& emit)>;
+
+  explicit TextDocument() {}
+  ~TextDocument();
+  TextDocument(const TextDocument&)            = delete;
+  TextDocument& operator=(const TextDocument&) = delete;
+
+  // Text, in characters
+  void   clear();
+  bool   load(const char* text, size_t length);
+  bool   insert(size_t pos, const char* text, size_t length);
+  bool   insert(size_t pos, char c) { return insert(pos, &c, 1); }
+  bool   append(const char* text, size_t length) { return insert(this->length(), text, length); }
+  void   erase(size_t pos, size_t length);
+  size_t length() const { return capacity_ - (gapEnd_ - gapStart_); }
+  char   charAt(size_t pos) const;
+  // Whole text, contiguous and NUL terminated. Moves the gap to the end, so
+  // it is an edit as far as line() views are concerned.
+  const char* text();
+
+  // Save tracking: the text before dirtyFrom() is unchanged since the last
+  // markSaved(), so a save only needs to rewrite what comes after it
+  bool   dirty() const     { return dirtyFrom_ != clean; }
+  size_t dirtyFrom() const { return min(dirtyFrom_, length()); }
+  void   markSaved()       { dirtyFrom_ = clean; }
+
+  // Display lines. line() only reads, so the eink and OLED tasks can both
+  // hold lines while nothing edits the document.
+  void     reflow(const WrapFn& wrap);
+  size_t   size() const { return lineCount_; }
+  TextLine line(size_t i) const;
+
+private:
+  struct Span {
+    uint32_t offset;
+    uint16_t length;
+  };
+
+  static constexpr const char* tag       = "TEXT_DOC";
+  static constexpr size_t      minBuffer = 4096;
+  static constexpr size_t      minLines  = 128;
+  static constexpr size_t      clean     = SIZE_MAX;
+
+  bool  reserve_(size_t length);
+  bool  reserveLines_(size_t count);
+  void  moveGap_(size_t pos);
+  static void* alloc_(void* old, size_t bytes);
+
+  // Gap buffer: text is buffer_[0, gapStart_) + buffer_[gapEnd_, capacity_)
+  char*           buffer_   = nullptr;
+  size_t          capacity_ = 0;
+  size_t          gapStart_ = 0;
+  size_t          gapEnd_   = 0;
+
+  Span*           lines_     = nullptr;
+  size_t          lineCap_   = 0;
+  size_t          lineCount_ = 0;
+
+  size_t          dirtyFrom_ = clean;
+};
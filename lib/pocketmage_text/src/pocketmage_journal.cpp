@@ -0,0 +1,215 @@
+#include <pocketmage_journal.h>
+#include <pocketmage_text.h>
+
+// ===================== main functions =====================
+bool TextJournal::load(fs::FS& fs, const String& path, TextDocument& doc) {
+  path_ = "";
+  doc.clear();
+
+  // A compaction cut off between removing the file and renaming its replacement
+  if (!fs.exists(path) && fs.exists(tempPath_(path))) fs.rename(tempPath_(path), path);
+
+  File file = fs.open(path, FILE_READ);
+  if (!file || file.isDirectory()) {
+    ESP_LOGE(tag, "Failed to open %s", path.c_str());
+    return false;
+  }
+  uint32_t crc = 0;
+  const bool ok = readInto_(file, file.size(), doc, &crc);
+  file.close();
+  if (!ok) return false;
+
+  baseLength_ = doc.length();
+  baseCrc_    = crc;
+  if (!replay_(fs, path, doc)) return false;
+
+  path_ = path;
+  doc.markSaved();
+  return true;
+}
+
+bool TextJournal::save(fs::FS& fs, const String& path, TextDocument& doc) {
+  // Nothing known about what is on disk: write it all
+  if (path != path_) return compact(fs, path, doc);
+  if (!doc.dirty()) return true;
+
+  const size_t from = doc.dirtyFrom();
+  const size_t tail = doc.length() - from;
+  const char*  text = doc.text();
+
+  // Only grown since the file was written: extend the file itself
+  if (journalBytes_ == 0 && from == baseLength_) {
+    File file = fs.open(path, FILE_APPEND);
+    if (!file) {
+      ESP_LOGE(tag, "Failed to open %s for appending", path.c_str());
+      return false;
+    }
+    const size_t written = file.write((const uint8_t*)text + from, tail);
+    file.close();
+    if (written != tail) {
+      // Part of the tail may be in the file now, so stop trusting baseLength_
+      ESP_LOGE(tag, "Append failed for %s", path.c_str());
+      path_ = "";
+      return false;
+    }
+    baseLength_ += tail;
+    baseCrc_     = crc32_(baseCrc_, text + from, tail);
+    doc.markSaved();
+    return true;
+  }
+
+  if (journalBytes_ + sizeof(Record) + tail > max(minCompact, doc.length() / 2)) {
+    return compact(fs, path, doc);
+  }
+
+  // A new journal replaces any leftover one and names the file it applies to
+  const bool fresh = journalBytes_ == 0;
+  File journal = fs.open(journalPath_(path), fresh ? FILE_WRITE : FILE_APPEND);
+  if (!journal) {
+    ESP_LOGE(tag, "Failed to open journal for %s", path.c_str());
+    return compact(fs, path, doc);
+  }
+  size_t expected = sizeof(Record) + tail;
+  size_t written  = 0;
+  if (fresh) {
+    const Header header = { headerMagic, (uint32_t)baseLength_, baseCrc_ };
+    written  += journal.write((const uint8_t*)&header, sizeof(header));
+    expected += sizeof(header);
+  }
+  const Record record = { recordMagic, (uint32_t)from, (uint32_t)tail };
+  written += journal.write((const uint8_t*)&record, sizeof(record));
+  written += journal.write((const uint8_t*)text + from, tail);
+  journal.close();
+  journalBytes_ += written;
+  if (written != expected) {
+    // A torn record would hide everything after it from replay
+    ESP_LOGE(tag, "Journal write failed for %s", path.c_str());
+    return compact(fs, path, doc);
+  }
+
+  doc.markSaved();
+  return true;
+}
+
+bool TextJournal::compact(fs::FS& fs, const String& path, TextDocument& doc) {
+  path_ = "";
+
+  const String temp = tempPath_(path);
+  File file = fs.open(temp, FILE_WRITE);
+  if (!file) {
+    ESP_LOGE(tag, "Failed to open %s for writing", temp.c_str());
+    return false;
+  }
+  const size_t length  = doc.length();
+  const size_t written = file.write((const uint8_t*)doc.text(), length);
+  file.close();
+  if (written != length) {
+    ESP_LOGE(tag, "Write failed for %s", temp.c_str());
+    fs.remove(temp);
+    return false;
+  }
+
+  // A crash from here on is caught by load(): with the file gone it moves
+  // the temp file into place, and a leftover journal whose header doesn't
+  // match the new file's length and CRC is discarded, never replayed
+  if (fs.exists(path)) fs.remove(path);
+  if (!fs.rename(temp, path)) {
+    ESP_LOGE(tag, "Failed to move %s into place", temp.c_str());
+    return false;
+  }
+  if (fs.exists(journalPath_(path))) fs.remove(journalPath_(path));
+
+  path_         = path;
+  baseLength_   = length;
+  baseCrc_      = crc32_(0, doc.text(), length);
+  journalBytes_ = 0;
+  doc.markSaved();
+  ESP_LOGI(tag, "Compacted %s (%u bytes)", path.c_str(), (unsigned)length);
+  return true;
+}
+
+bool TextJournal::flush(fs::FS& fs, const String& path, TextDocument& doc) {
+  if (path != path_) return true;
+  if (!save(fs, path, doc)) return false;
+  return journalBytes_ == 0 || compact(fs, path, doc);
+}
+
+void TextJournal::remove(fs::FS& fs, const String& path) {
+  if (fs.exists(journalPath_(path))) fs.remove(journalPath_(path));
+}
+
+void TextJournal::rename(fs::FS& fs, const String& oldPath, const String& newPath) {
+  if (fs.exists(journalPath_(oldPath))) fs.rename(journalPath_(oldPath), journalPath_(newPath));
+}
+
+// ===================== private functions =====================
+bool TextJournal::replay_(fs::FS& fs, const String& path, TextDocument& doc) {
+  journalBytes_ = 0;
+  File journal = fs.open(journalPath_(path), FILE_READ);
+  if (!journal) return true;
+
+  // Records only make sense on the exact file they were written against
+  Header header = {};
+  const size_t total = journal.size();
+  if (journal.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != headerMagic ||
+      header.baseLength != baseLength_ || header.baseCrc != baseCrc_) {
+    journal.close();
+    ESP_LOGW(tag, "Journal of %s doesn't match the file, discarding it", path.c_str());
+    fs.remove(journalPath_(path));
+    return true;
+  }
+
+  size_t good    = sizeof(header);
+  size_t records = 0;
+  while (good + sizeof(Record) <= total) {
+    Record record;
+    if (journal.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) break;
+    if (record.magic != recordMagic || record.length > total - good - sizeof(Record)) break;
+    if (record.offset > doc.length()) break;  // can't follow from the text so far
+
+    doc.erase(record.offset, doc.length());
+    if (!readInto_(journal, record.length, doc)) {
+      journal.close();
+      return false;
+    }
+    good += sizeof(Record) + record.length;
+    records++;
+  }
+  journal.close();
+  journalBytes_ = good;
+  ESP_LOGI(tag, "Replayed %u records for %s", (unsigned)records, path.c_str());
+
+  // Later records would land after the torn one and never be read
+  if (good != total) {
+    ESP_LOGW(tag, "Dropped %u torn journal bytes", (unsigned)(total - good));
+    return compact(fs, path, doc);
+  }
+  return true;
+}
+
+bool TextJournal::readInto_(File& file, size_t length, TextDocument& doc, uint32_t* crc) {
+  char buf[chunk];
+  while (length > 0) {
+    const size_t n = file.read((uint8_t*)buf, min(length, chunk));
+    if (n == 0) break;
+    if (!doc.append(buf, n)) return false;
+    if (crc) *crc = crc32_(*crc, buf, n);
+    length -= n;
+  }
+  return true;
+}
+
+// CRC-32 (IEEE), a nibble at a time to keep the table small
+uint32_t TextJournal::crc32_(uint32_t crc, const char* data, size_t length) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint8_t)data[i];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+  return ~crc;
+}
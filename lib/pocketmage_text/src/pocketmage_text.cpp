@@ -0,0 +1,161 @@
+#include <pocketmage_text.h>
+#include <esp_heap_caps.h>
+
+bool TextLine::startsWith(const char* prefix) const {
+  const size_t n = strlen(prefix);
+  if (n > size()) return false;
+  for (size_t i = 0; i < n; i++) {
+    if (charAt(i) != prefix[i]) return false;
+  }
+  return true;
+}
+
+size_t TextLine::copy(char* dst, size_t n, size_t from) const {
+  if (n == 0) return 0;
+  size_t out = 0;
+  for (size_t i = from; i < size() && out + 1 < n; i++) dst[out++] = charAt(i);
+  dst[out] = '\0';
+  return out;
+}
+
+// ===================== main functions =====================
+TextDocument::~TextDocument() {
+  free(buffer_);
+  free(lines_);
+}
+
+void TextDocument::clear() {
+  gapStart_  = 0;
+  gapEnd_    = capacity_;
+  lineCount_ = 0;
+  dirtyFrom_ = 0;
+}
+
+bool TextDocument::load(const char* text, size_t length) {
+  clear();
+  return insert(0, text, length);
+}
+
+bool TextDocument::insert(size_t pos, const char* text, size_t length) {
+  if (!text || length == 0) return true;
+  if (pos > this->length()) pos = this->length();
+  // One spare byte so text() can always NUL terminate
+  if (!reserve_(this->length() + length + 1)) return false;
+  moveGap_(pos);
+  dirtyFrom_ = min(dirtyFrom_, pos);
+  memcpy(buffer_ + gapStart_, text, length);
+  gapStart_ += length;
+  return true;
+}
+
+void TextDocument::erase(size_t pos, size_t length) {
+  if (pos >= this->length()) return;
+  length = min(length, this->length() - pos);
+  moveGap_(pos);
+  dirtyFrom_ = min(dirtyFrom_, pos);
+  gapEnd_ += length;
+}
+
+char TextDocument::charAt(size_t pos) const {
+  if (pos >= length()) return '\0';
+  return pos < gapStart_ ? buffer_[pos] : buffer_[pos + (gapEnd_ - gapStart_)];
+}
+
+const char* TextDocument::text() {
+  if (!buffer_) return "";
+  moveGap_(length());
+  buffer_[gapStart_] = '\0';
+  return buffer_;
+}
+
+void TextDocument::reflow(const WrapFn& wrap) {
+  lineCount_ = 0;
+  const char* all = text();
+  wrap(all, length(), [&](size_t offset, size_t length) {
+    if (lineCount_ == lineCap_ && !reserveLines_(lineCount_ + 1)) return;
+    // A span is one display line, far below the u16 limit
+    lines_[lineCount_++] = { (uint32_t)offset, (uint16_t)min(length, (size_t)UINT16_MAX) };
+  });
+}
+
+TextLine TextDocument::line(size_t i) const {
+  TextLine out;
+  if (i >= lineCount_) return out;
+  const Span&  span = lines_[i];
+  const size_t gap  = gapEnd_ - gapStart_;
+  // Split around the gap rather than move it: moving would shift text under
+  // views another task is still drawing
+  if (span.offset >= gapStart_) {
+    out.data   = buffer_ + span.offset + gap;
+    out.length = span.length;
+  }
+  else if (span.offset + span.length <= gapStart_) {
+    out.data   = buffer_ + span.offset;
+    out.length = span.length;
+  }
+  else {
+    out.data       = buffer_ + span.offset;
+    out.length     = gapStart_ - span.offset;
+    out.tail       = buffer_ + gapEnd_;
+    out.tailLength = span.length - out.length;
+  }
+  return out;
+}
+
+// ===================== private functions =====================
+bool TextDocument::reserve_(size_t length) {
+  if (length <= capacity_) return true;
+
+  size_t capacity = max(capacity_, minBuffer);
+  while (capacity < length) capacity *= 2;
+
+  // Text after the gap moves to the end of the bigger buffer
+  const size_t tail = capacity_ - gapEnd_;
+  char* buffer = static_cast<char*>(alloc_(buffer_, capacity));
+  if (!buffer) {
+    ESP_LOGE(tag, "Out of memory for %u bytes", (unsigned)capacity);
+    return false;
+  }
+  memmove(buffer + capacity - tail, buffer + gapEnd_, tail);
+  buffer_   = buffer;
+  gapEnd_   = capacity - tail;
+  capacity_ = capacity;
+  return true;
+}
+
+bool TextDocument::reserveLines_(size_t count) {
+  if (count <= lineCap_) return true;
+  size_t capacity = max(lineCap_, minLines);
+  while (capacity < count) capacity *= 2;
+  Span* lines = static_cast<Span*>(alloc_(lines_, capacity * sizeof(Span)));
+  if (!lines) {
+    ESP_LOGE(tag, "Out of memory for %u lines", (unsigned)capacity);
+    return false;
+  }
+  lines_   = lines;
+  lineCap_ = capacity;
+  return true;
+}
+
+void TextDocument::moveGap_(size_t pos) {
+  if (pos < gapStart_) {
+    const size_t n = gapStart_ - pos;
+    memmove(buffer_ + gapEnd_ - n, buffer_ + pos, n);
+    gapStart_ -= n;
+    gapEnd_   -= n;
+  }
+  else if (pos > gapStart_) {
+    const size_t n = pos - gapStart_;
+    memmove(buffer_ + gapStart_, buffer_ + gapEnd_, n);
+    gapStart_ += n;
+    gapEnd_   += n;
+  }
+}
+
+void* TextDocument::alloc_(void* old, size_t bytes) {
+  if (psramFound()) {
+    void* p = heap_caps_realloc(old, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p) return p;
+  }
+  return realloc(old, bytes);
+}
@@ -5,6 +5,7 @@
 
 class Adafruit_MPR121;   
 class PocketmageEink;
+class TextDocument;
 
 // ===================== CAPACATIVE TOUCH CLASS =====================
 class PocketmageTOUCH {
@@ -12,7 +13,7 @@ public:
   explicit PocketmageTOUCH(Adafruit_MPR121 &cap) : cap_(cap) {}
 
   // Wire up external buffers/state used to read from globals
-  void setAllLines(std::vector<String>* allLines)                                           {allLines_ = allLines;}
+  void setAllLines(TextDocument* allLines)                                                  {allLines_ = allLines;}
   void setEink(PocketmageEink* eink)                                                               { eink_ = eink;}                // reference to pocketmage eink object
   void setEink(PocketmageEink& eink)                                                              { eink_ = &eink;}                // overloaded reference to pocketmage eink object
   void setNewLineAdded(volatile bool* newLineAdded)                                { newLineAdded_ = newLineAdded;}
@@ -28,7 +29,7 @@ public:
 private:
   Adafruit_MPR121      &cap_;                          // class reference to hardware touch object
   PocketmageEink*      eink_               = nullptr;
-  std::vector<String>* allLines_           = nullptr;
+  TextDocument*        allLines_           = nullptr;
   volatile bool*       newLineAdded_       = nullptr;
   volatile long int*   dynamicScroll_      = nullptr;
   volatile long int*   prev_dynamicScroll_ = nullptr;
@@ -1,5 +1,6 @@
 #include <pocketmage_touch.h>
 #include <pocketmage_eink.h> 
+#include <pocketmage_text.h>
 #include <Adafruit_MPR121.h>
 #include <config.h> // for TOUCH_TIMEOUT_MS
 
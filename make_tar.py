@@ -26,15 +26,24 @@ def create_tar(source, target, env):
 
     # --- Add binary assets under assets/... ---
     binary_assets_src = os.path.join(project_dir, "images/output/05_binary")
-    for folder in os.listdir(binary_assets_src):
-        folder_path = os.path.join(binary_assets_src, folder)
-        if os.path.isdir(folder_path):
-            # Include folder contents recursively, mapped to assets/<folder>
-            cmd += [
-                "-C", binary_assets_src,
-                "--transform", f"s,^{folder},assets/{folder},",
-                folder
-            ]
+    atlas_path = os.path.join(binary_assets_src, "tarot", "cards.atlas")
+    if os.path.exists(atlas_path):
+        # Packed atlas replaces the per-card .bin files
+        cmd += [
+            "-C", binary_assets_src,
+            "--transform", "s,^tarot,assets/tarot,",
+            "tarot/cards.atlas"
+        ]
+    else:
+        for folder in os.listdir(binary_assets_src):
+            folder_path = os.path.join(binary_assets_src, folder)
+            if os.path.isdir(folder_path):
+                # Include folder contents recursively, mapped to assets/<folder>
+                cmd += [
+                    "-C", binary_assets_src,
+                    "--transform", f"s,^{folder},assets/{folder},",
+                    folder
+                ]
 
     subprocess.run(cmd, check=True)
     print(f"Created TAR in project root: {tar_path}")
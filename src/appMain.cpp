@@ -2,94 +2,118 @@
 
 #include <pocketmage.h>
 #include <vector>
+#include <tarot.h>
+#include <tarot_cache.h>
+#include <tarot_deck.h>
+#include <tarot_spread.h>
 
-#define TOTAL_CARDS 22
-
-static std::vector<int> totalDrawnCards; // Keeps track of indices already drawn
+static TarotDeck deck;        // Shuffled deck, persisted to NVS
+static TarotCache cardCache;  // Card bitmaps kept in RAM between draws
+static TarotSpreads spreads;  // Built-in and SD spread layouts
+static EinkDisplayList splashList; // Splash screen, built once in setup()
+static EinkDisplayList spreadList; // Current spread, paged frame buffer only
 
 static constexpr const char *TAG = "TAROT";
 static volatile bool alreadyDrawnThisEinkPage = true;
 static volatile bool didRenderWelcomeMessage = false;
-const char *majorArcana[] = {
-    "The Fool", "The Magician", "The High Priestess", "The Empress", "The Emperor",
-    "The Hierophant", "The Lovers", "The Chariot", "Strength", "The Hermit",
-    "Wheel of Fortune", "Justice", "The Hanged Man", "Death", "Temperance",
-    "The Devil", "The Tower", "The Star", "The Moon", "The Sun",
-    "Judgement", "The World"};
+static volatile bool reshuffleRequested = false;
 
 int x = 0;
 bool firstRun = true;
 char inchar;
 String cardName;
 String cardNamesThisSpread;
-static volatile int CARDS_PER_PAGE = 3;
+static volatile uint8_t currentSpread = 1; // index into spreads
+static int shownSpread = -1;               // spread in the frame buffer, -1 for the splash
 
 int selectedCard = -1;
 bool tarotLoaded = false;
 
-static int pageCardIdx[3];
+static TarotDeck::Card pageCards[TAROT_SPREAD_MAX_SLOTS];
 
-bool drawTarotToBuffer(int idx, int nCardSpread, int drawnCards)
+// One card of spreadList, drawn band by band when the frame buffer is paged
+struct CardDraw
 {
-  char path[32];
-  snprintf(path, sizeof(path), "/assets/tarot/%d/ar%02d.bin", nCardSpread, idx);
-
-  int CARD_W;
-  int CARD_H;
-
-  int cardX;
-  int cardY;
+  const TarotSpread *spread;
+  uint8_t slot;
+};
+static CardDraw cardDraws[TAROT_SPREAD_MAX_SLOTS];
 
-  switch (nCardSpread)
-  {
-  case 3:
-  {
-    CARD_W = 88;
-    CARD_H = 153;
-    // center one should be centered horizontally, other 2 should be offset from the center
-    cardX = ((display.width() - CARD_W) / 2) + ((drawnCards - 1) * (CARD_W + 10)); // 10px horizontal padding
-    // centered vertically for 1 or 3 cards
-    cardY = (display.height() - CARD_H) / 2;
-    break;
-  }
-    // todo: fix jump to case error here to allow it
-  case 1:
-  default:
+bool drawTarotToBuffer(int idx, bool reversed, const TarotSlot &slot, const TarotPlacement &place)
+{
+  char path[32];
+  snprintf(path, sizeof(path), "card %d", idx);
+
+  // A card crossing an earlier one hides what is underneath it
+  if (place.overlaps)
+    EINK().clearRect(place.x, place.y, place.w, place.h);
+
+  const TarotSizeInfo &info = TAROT_SIZES[slot.size];
+  // reversed cards are drawn upside down on top of the slot rotation
+  const uint8_t turns = (slot.turns + (reversed ? 2 : 0)) & 3;
+  // a greyscale atlas has two bit-planes per row, dithered as it is drawn
+  const bool grey = cardCache.planes() > 1;
+  auto blit = [&](int bx, int by, const uint8_t *rows, uint16_t h)
   {
-    CARD_W = 128;
-    CARD_H = 218;
-    // centered horizontally and vertically
-    cardX = (display.width() - CARD_W) / 2;
-    cardY = (display.height() - CARD_H) / 2;
-    break;
-  }
+    if (grey)
+      EINK().blitDitheredBitmap(bx, by, rows, info.w, h, turns);
+    else
+      EINK().blitBitmap(bx, by, rows, info.w, h, turns);
   };
-
-  const int BYTES = CARD_W * CARD_H / 8;
-  uint8_t tarotImage[BYTES];
-  static volatile bool sdActive = true;
-  // OLED().setSD(&sdActive);
-  if (!SD().readBinaryFile(path, tarotImage, BYTES))
+  const uint8_t *tarotImage = cardCache.acquire(idx, slot.size);
+  if (!tarotImage)
   {
+    // No cache memory, stream straight into the frame buffer in row chunks
+    const bool streamed = cardCache.readRows(idx, slot.size, [&](uint16_t y, const uint8_t *rows, uint16_t count)
+                                             {
+                                               // where this band of source rows lands once rotated
+                                               int bandX = place.x;
+                                               int bandY = place.y;
+                                               switch (turns)
+                                               {
+                                               case 0: bandY += y; break;
+                                               case 1: bandX += info.h - y - count; break;
+                                               case 2: bandY += info.h - y - count; break;
+                                               case 3: bandX += y; break;
+                                               }
+                                               blit(bandX, bandY, rows, count);
+                                             });
+    if (streamed)
+      return true;
+
     ESP_LOGI(TAG, "ERR: Failed to read %s\n", path);
 
     OLED().oledWord("SD Read Error %s", path);
     return false;
   }
-  sdActive = false;
-
-  // display.setRotation(3);
-  // display.setFullWindow();
-  // display.setTextColor(GxEPD_BLACK);
 
-  // display.drawRect(cardX, cardY, CARD_W, CARD_H, GxEPD_BLACK);
-  display.drawBitmap(cardX, cardY, tarotImage, CARD_W, CARD_H, GxEPD_BLACK, GxEPD_WHITE);
-  String msg = String(idx) + " - " + cardName;
-  // OLED().oledWord(msg);
+  blit(place.x, place.y, tarotImage, info.h);
+  cardCache.release();
 
   return true;
 }
 
+void drawCardCall(void *context)
+{
+  const CardDraw &draw = *static_cast<CardDraw *>(context);
+  drawTarotToBuffer(pageCards[draw.slot].index, pageCards[draw.slot].reversed,
+                    draw.spread->slots[draw.slot], draw.spread->placements[draw.slot]);
+}
+
+// Decode the next 1-card and 3-card spreads while the panel refreshes so the
+// next keypress only has to blit from RAM
+void prefetchNextSpreads()
+{
+  TarotCache::PrefetchItem items[TAROT_PREFETCH_MAX];
+  uint8_t n = 0;
+  TarotDeck::Card next;
+  if (deck.peek(0, next))
+    items[n++] = {next.index, TAROT_SIZE_1};
+  for (uint8_t i = 0; i < 3 && n < TAROT_PREFETCH_MAX && deck.peek(i, next); i++)
+    items[n++] = {next.index, TAROT_SIZE_3};
+  cardCache.prefetch(items, n);
+}
+
 // ADD PROCESS/KEYBOARD APP SCRIPTS HERE
 void processKB()
 {
@@ -99,19 +123,30 @@ void processKB()
   if (inchar == 21)
   {
     // right arrow - 3 cards
-    CARDS_PER_PAGE = 3;
+    currentSpread = spreads.findByCount(3);
     alreadyDrawnThisEinkPage = false;
   }
   else if (inchar == 20)
   {
     // SEL button - 1 card
-    CARDS_PER_PAGE = 1;
+    currentSpread = spreads.findByCount(1);
+    alreadyDrawnThisEinkPage = false;
+  }
+  else if (inchar == 9)
+  {
+    // TAB - next spread layout
+    currentSpread = (currentSpread + 1) % spreads.count();
+    OLED().oledWord(spreads.get(currentSpread).name, true);
+  }
+  else if (inchar == 13)
+  {
+    // Enter - draw the selected spread
     alreadyDrawnThisEinkPage = false;
   }
   else if (inchar == 19)
   {
-    // reshuffle deck
-    totalDrawnCards.clear();
+    // reshuffle deck, done on the eink task so it never races a draw
+    reshuffleRequested = true;
     OLED().oledWord("Shuffled", true);
     didRenderWelcomeMessage = false;
   }
@@ -120,58 +155,72 @@ void processKB()
     // Return to pocketMage OS
     // EINK().setFullRefreshAfter(FULL_REFRESH_AFTER);
 
+    // don't reset the panel mid-waveform
+    EINK().beginFrame();
     rebootToPocketMage();
   }
 
   delay(10);
 }
+// Lays the splash out once; text is measured from the font tables so
+// nothing here touches the display
+void buildTarotSplash(int16_t screenW, int16_t screenH)
+{
+  const GFXfont *font = EINK().getCurrentFont();
+  int16_t x1, y1, w, h;
+  splashList.clear();
+  splashList.fillRect(0, 0, screenW, screenH, GxEPD_WHITE);
+
+  // Title
+  EinkDisplayList::textBounds(font, 2, "TAROT", 0, 0, x1, y1, w, h);
+  splashList.text((screenW - w) / 2, 50, "TAROT", font, 2, GxEPD_BLACK);
+
+  // Subtitle
+  const char *subtitle = cardCache.cardCount() == TAROT_MAX_CARDS ? "Full Deck" : "Major Arcana";
+  EinkDisplayList::textBounds(font, 1, subtitle, 0, 0, x1, y1, w, h);
+  splashList.text((screenW - w) / 2, 85, subtitle, font, 1, GxEPD_BLACK);
+
+  // Divider line
+  splashList.line(40, 100, screenW - 40, 100, GxEPD_BLACK);
+
+  // Instructions
+  splashList.text(30, 115, "O  = draw 1 card", font, 1, GxEPD_BLACK);
+  splashList.text(30, 130, ">  = draw 3 cards", font, 1, GxEPD_BLACK);
+  splashList.text(30, 145, "TAB = choose spread, ENTER = draw it", font, 1, GxEPD_BLACK);
+  splashList.text(30, 160, "<  = reshuffle deck", font, 1, GxEPD_BLACK);
+  splashList.text(30, 185, "Any key = exit", font, 1, GxEPD_BLACK);
+
+  if (!splashList.ok())
+    ESP_LOGW(TAG, "Splash display list overflowed");
+}
+
 void showTarotSplash()
 {
+  EINK().beginFrame();
   display.setRotation(3);
   display.setFullWindow();
-  display.setTextColor(GxEPD_BLACK);
 
-  display.firstPage();
-  do
+  shownSpread = -1;
+  if (EINK().paged())
   {
-    display.fillScreen(GxEPD_WHITE);
-
-    // Title
-    display.setTextSize(2);
-    int16_t x1, y1;
-    uint16_t w, h;
-    display.getTextBounds("TAROT", 0, 0, &x1, &y1, &w, &h);
-    display.setCursor((display.width() - w) / 2, 50);
-    display.print("TAROT");
-
-    // Subtitle
-    display.setTextSize(1);
-    const char *subtitle = "Major Arcana";
-    display.getTextBounds(subtitle, 0, 0, &x1, &y1, &w, &h);
-    display.setCursor((display.width() - w) / 2, 85);
-    display.print(subtitle);
-
-    // Divider line
-    display.drawLine(40, 100, display.width() - 40, 100, GxEPD_BLACK);
-
-    // Instructions
-    display.setCursor(30, 130);
-    display.print("O  = draw 1 card");
-
-    display.setCursor(30, 145);
-    display.print(">  = draw 3 cards");
-
-    display.setCursor(30, 160);
-    display.print("<  = reshuffle deck");
-
-    display.setCursor(30, 185);
-    display.print("Any key = exit");
+    EINK().renderPaged(splashList);
+    return;
+  }
 
-  } while (display.nextPage());
+  // every command is a frame item, so a splash shown again unchanged (e.g.
+  // a second reshuffle) costs no refresh
+  EINK().drawList(splashList);
+  EINK().refreshAsync(0);
 }
 
 void applicationEinkHandler()
 {
+  if (reshuffleRequested)
+  {
+    reshuffleRequested = false;
+    deck.shuffle(cardCache.cardCount());
+    deck.save();
+  }
   if (!didRenderWelcomeMessage)
   {
     // todo: eink greeting
@@ -179,6 +228,8 @@ void applicationEinkHandler()
     if (firstRun)
     {
       OLED().oledWord("", false, true);
+      // Fill the card cache while the user reads the splash screen
+      cardCache.startWarmTask();
       firstRun = false;
     }
     // OLED().oledWord("o to draw 1, > to draw 3, < to shuffle, any key to exit", false);
@@ -189,56 +240,89 @@ void applicationEinkHandler()
     alreadyDrawnThisEinkPage = true;
     int cardsDrawnThisPage = 0;
     cardNamesThisSpread = "";
+    // a newer spread supersedes whatever is left of the last refresh
+    EINK().beginFrame();
     display.setRotation(3);
     display.setFullWindow();
     display.setTextColor(GxEPD_BLACK);
 
-    OLED().oledWord(
-        CARDS_PER_PAGE == 3 ? "Drawing 3 cards..." : "Drawing a card...");
+    const uint8_t spreadIdx = currentSpread; // the key task may change it meanwhile
+    const TarotSpread &spread = spreads.get(spreadIdx);
+    OLED().oledWord(String("Drawing ") + spread.name + "...");
 
-    for (int drawnCards = 0; drawnCards < CARDS_PER_PAGE; drawnCards++)
+    if (deck.remaining() < spread.count)
     {
-      static const int MAJOR_ARCANA_COUNT = sizeof(majorArcana) / sizeof(majorArcana[0]);
-      // Pick a random card at app start and when user draws another
-      static const int TAROT_COUNT = sizeof(majorArcana) / sizeof(majorArcana[0]);
-      if (totalDrawnCards.size() >= TOTAL_CARDS)
-      {
-        ESP_LOGI(TAG, "Listing directory %s\r\n", dirname);
-        OLED().oledWord("End of deck reached!", true);
-        return;
-      }
-
-      int idx;
-      do
-      {
-        idx = esp_random() % TOTAL_CARDS;
-      } while (std::find(totalDrawnCards.begin(), totalDrawnCards.end(), idx) != totalDrawnCards.end());
-      totalDrawnCards.push_back(idx); // Mark this card as drawn so no duplicates
+      ESP_LOGI(TAG, "End of deck, %d cards left\r\n", deck.remaining());
+      OLED().oledWord("End of deck reached!", true);
+      return;
+    }
 
-      pageCardIdx[drawnCards] = idx;
+    for (int drawnCards = 0; drawnCards < spread.count; drawnCards++)
+    {
+      deck.draw(pageCards[drawnCards]);
 
-      cardName = majorArcana[idx];
+      TarotCardInfo info;
+      if (cardCache.cardInfo(pageCards[drawnCards].index, info))
+        cardName = info.name;
+      else
+        cardName = String(pageCards[drawnCards].index);
+      if (pageCards[drawnCards].reversed)
+        cardName += " (R)";
 
       ESP_LOGI(TAG, "cardname: %s\r\n", cardName);
       // track names to render to oled
       cardNamesThisSpread.concat(cardName + " ");
     }
+    deck.save();
 
-    // display.firstPage();
-    // do
-    // {
-    display.fillScreen(GxEPD_WHITE);
-    // draw cards evenly across the page, n cards in a spread
-    for (int drawnCards = 0; drawnCards < CARDS_PER_PAGE; drawnCards++)
+    if (EINK().paged())
+    {
+      // no retained frame: the spread is replayed once per buffer band
+      spreadList.clear();
+      spreadList.fillRect(0, 0, display.width(), display.height(), GxEPD_WHITE);
+      for (int i = 0; i < spread.count; i++)
+      {
+        const TarotPlacement &place = spread.placements[i];
+        cardDraws[i] = {&spread, (uint8_t)i};
+        spreadList.call(place.x, place.y, place.w, place.h, drawCardCall, &cardDraws[i]);
+      }
+      shownSpread = spreadIdx;
+      EINK().renderPaged(spreadList, 2);
+      // after the bands: prefetching first would evict the cards being replayed
+      prefetchNextSpreads();
+      OLED().oledWord(cardNamesThisSpread);
+      return;
+    }
+
+    if (shownSpread < 0)
+    {
+      display.fillScreen(GxEPD_WHITE);
+      EINK().markAllDirty();
+    }
+    else
+    {
+      // only the old card slots need clearing, so the refresh window shrinks
+      // to the cards when the layout stays the same
+      const TarotSpread &shown = spreads.get(shownSpread);
+      for (int i = 0; i < shown.count; i++)
+        EINK().clearRect(shown.placements[i].x, shown.placements[i].y, shown.placements[i].w, shown.placements[i].h);
+    }
+    shownSpread = spreadIdx;
+    // the whole spread goes into the frame buffer before a single refresh
+    for (int drawnCards = 0; drawnCards < spread.count; drawnCards++)
     {
-      drawTarotToBuffer(pageCardIdx[drawnCards], CARDS_PER_PAGE, drawnCards);
+      drawTarotToBuffer(pageCards[drawnCards].index, pageCards[drawnCards].reversed,
+                        spread.slots[drawnCards], spread.placements[drawnCards]);
     }
 
-    // } while (display.nextPage());
     // EINK().refresh();
     // EINK().forceSlowFullUpdate(true);
     // EINK().refresh();
-    EINK().multiPassRefresh(2);
+    ESP_LOGI(TAG, "card cache hits: %u misses: %u", (unsigned)cardCache.hits(), (unsigned)cardCache.misses());
+    ESP_LOGI(TAG, "refreshes skipped: %u bytes saved: %u", (unsigned)EINK().skippedRefreshes(), (unsigned)EINK().bytesSaved());
+    prefetchNextSpreads();
+    // returns straight away, the panel passes run on the eink worker
+    EINK().refreshAsync(2);
 
     OLED().oledWord(cardNamesThisSpread);
   } // end if
@@ -258,6 +342,13 @@ void applicationEinkHandler()
 void setup()
 {
   PocketMage_INIT();
+  if (!noSD)
+    cardCache.begin(&SD_MMC);
+  // pick up the reading where it was left, or start a fresh deck
+  spreads.begin(noSD ? nullptr : &SD_MMC, display.width(), display.height());
+  buildTarotSplash(display.width(), display.height());
+  if (!deck.load(cardCache.cardCount()))
+    reshuffleRequested = true;
 }
 
 void loop()
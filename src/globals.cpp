@@ -3,7 +3,7 @@
 
 // ===================== DISPLAY =====================
 // Main e-ink display object
-GxEPD2_BW<GxEPD2_310_GDEQ031T10, GxEPD2_310_GDEQ031T10::HEIGHT> display(GxEPD2_310_GDEQ031T10(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY));
+GxEPD2_BW<GxEPD2_310_GDEQ031T10, EINK_PAGE_HEIGHT> display(GxEPD2_310_GDEQ031T10(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY));
 // Fast full update flag for e-ink
 volatile bool GxEPD2_310_GDEQ031T10::useFastFullUpdate = true;
 // 256x32 SPI OLED display object
@@ -123,7 +123,7 @@ AppState CurrentAppState;             // Current app state
 
 // ===================== TXT APP =====================
 volatile bool newLineAdded = true;           // New line added in TXT
-std::vector<String> allLines;                // All lines in TXT
+TextDocument allLines;                       // TXT document and its display lines
 
 // ===================== TASKS APP =====================
 std::vector<std::vector<String>> tasks;      // Task list
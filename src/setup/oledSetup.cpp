@@ -17,9 +17,7 @@ constexpr int kBattIconCount = sizeof(batt_allArray) / sizeof(batt_allArray[0]);
 
 // e-ink text width wrapper to work with Eink display
 static uint16_t einkMeasureWidth(const String& s) {
-  int16_t x1, y1; uint16_t w, h;
-  display.getTextBounds(s, 0, 0, &x1, &y1, &w, &h);
-  return w;
+  return EINK().textWidth(s);
 }
 
 // Setup for Oled Class
@@ -35,6 +35,7 @@ void setupSD() {
     }
   }
   wireSD();
+  pm_sd.startWorker();
 
   setCpuFrequencyMhz(240);
   // Create folders and files if needed
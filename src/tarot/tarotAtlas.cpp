@@ -0,0 +1,191 @@
+// @knzet 2025
+#include <tarot_atlas.h>
+
+// ===================== main functions =====================
+bool TarotAtlas::begin(fs::FS* fileSys, const char* path) {
+  end();
+  if (!fileSys || !fileSys->exists(path)) return false;
+
+  file_ = fileSys->open(path, "r");
+  if (!file_ || file_.isDirectory()) {
+    ESP_LOGE(tag, "Failed to open atlas: %s", path);
+    return false;
+  }
+
+  uint8_t header[headerSize];
+  if (file_.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "TATL", 4) != 0) {
+    ESP_LOGE(tag, "Bad atlas header: %s", path);
+    file_.close();
+    return false;
+  }
+  const uint16_t fileVersion = header[4] | (header[5] << 8);
+  const uint8_t  sizeCount   = header[6];
+  const uint8_t  cardCount   = header[7];
+  const uint16_t fileRecord  = header[8 + 4 * TAROT_SIZE_COUNT] | (header[9 + 4 * TAROT_SIZE_COUNT] << 8);
+  const uint16_t planes      = fileVersion < 4 ? 1 : header[10 + 4 * TAROT_SIZE_COUNT] | (header[11 + 4 * TAROT_SIZE_COUNT] << 8);
+  if (fileVersion < 3 || fileVersion > version || sizeCount != TAROT_SIZE_COUNT || cardCount == 0 ||
+      cardCount > TAROT_MAX_CARDS || fileRecord != recordSize || planes < 1 || planes > 2) {
+    ESP_LOGE(tag, "Unsupported atlas v%u (%u sizes, %u cards)", fileVersion, sizeCount, cardCount);
+    file_.close();
+    return false;
+  }
+
+  for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+    const uint8_t* dims = header + 8 + 4 * s;
+    if ((dims[0] | (dims[1] << 8)) != TAROT_SIZES[s].w || (dims[2] | (dims[3] << 8)) != TAROT_SIZES[s].h) {
+      ESP_LOGE(tag, "Bad atlas size class %u", s);
+      file_.close();
+      return false;
+    }
+  }
+
+  cardCount_ = cardCount;
+  planes_    = planes;
+  open_ = true;
+  ESP_LOGI(tag, "Atlas opened: %s (%u plane%s)", path, planes_, planes_ > 1 ? "s" : "");
+  return true;
+}
+
+void TarotAtlas::end() {
+  if (open_) file_.close();
+  open_      = false;
+  cardCount_ = 0;
+  planes_    = 1;
+}
+
+bool TarotAtlas::info(uint8_t card, TarotCardInfo& out) {
+  if (!open_ || card >= cardCount_) return false;
+
+  uint8_t record[recordSize];
+  if (!file_.seek(headerSize + (uint32_t)card * recordSize) || file_.read(record, recordSize) != recordSize) {
+    ESP_LOGE(tag, "Failed to read record for card %u", card);
+    return false;
+  }
+
+  // Fields are NUL padded, terminate anyway in case the file is damaged
+  memcpy(out.code, record, TAROT_CODE_LEN);
+  memcpy(out.name, record + nameOffset, TAROT_NAME_LEN);
+  memcpy(out.keywords, record + nameOffset + TAROT_NAME_LEN, TAROT_KEYWORDS_LEN);
+  out.code[TAROT_CODE_LEN - 1]         = '\0';
+  out.name[TAROT_NAME_LEN - 1]         = '\0';
+  out.keywords[TAROT_KEYWORDS_LEN - 1] = '\0';
+  out.suit   = record[TAROT_CODE_LEN];
+  out.number = record[TAROT_CODE_LEN + 1];
+  return true;
+}
+
+bool TarotAtlas::read(uint8_t card, uint8_t size, uint8_t* buf, size_t len) {
+  if (len != tarotBytes(size, planes_)) return false;
+  Entry e;
+  if (!entry(card, size, e)) return false;
+
+  // Raw cards go straight into the caller's buffer
+  if (e.encoding == ENCODING_RAW) {
+    if (!file_.seek(e.offset)) {
+      ESP_LOGE(tag, "Seek failed for card %u", card);
+      return false;
+    }
+    return file_.read(buf, len) == len;
+  }
+
+  const uint16_t rowBytes = TAROT_SIZES[size].w / 8 * planes_;
+  return readRows(card, size, [&](uint16_t y, const uint8_t* rows, uint16_t count) {
+    memcpy(buf + (size_t)y * rowBytes, rows, (size_t)count * rowBytes);
+  });
+}
+
+bool TarotAtlas::readRows(uint8_t card, uint8_t size, const RowFn& fn) {
+  Entry e;
+  if (!entry(card, size, e)) return false;
+
+  const uint16_t w        = TAROT_SIZES[size].w;
+  const uint16_t h        = TAROT_SIZES[size].h;
+  const uint16_t rowBytes = w / 8 * planes_;
+  if (rowBytes * chunkRows > sizeof(rows_)) return false;
+  if (!file_.seek(e.offset)) {
+    ESP_LOGE(tag, "Seek failed for card %u", card);
+    return false;
+  }
+
+  // Raw rows are read in whole chunks and handed over without a copy
+  if (e.encoding == ENCODING_RAW) {
+    const uint16_t rowsPerRead = sizeof(in_) / rowBytes;
+    for (uint16_t y = 0; y < h; y += rowsPerRead) {
+      const uint16_t count = min((uint16_t)(h - y), rowsPerRead);
+      const size_t   n     = (size_t)count * rowBytes;
+      if (file_.read(in_, n) != n) return false;
+      fn(y, in_, count);
+    }
+    return true;
+  }
+
+  // Small read-through buffer so the SD is read in chunks, not byte by byte
+  uint32_t remaining = e.length;
+  size_t   inLen     = 0;
+  size_t   inPos     = 0;
+  auto next = [&](uint8_t& b) -> bool {
+    if (inPos == inLen) {
+      if (remaining == 0) return false;
+      const size_t n = min((uint32_t)sizeof(in_), remaining);
+      if (file_.read(in_, n) != n) return false;
+      remaining -= n;
+      inLen = n;
+      inPos = 0;
+    }
+    b = in_[inPos++];
+    return true;
+  };
+
+  // PackBits, runs never cross a row boundary
+  uint16_t chunkStart = 0;
+  uint16_t chunkCount = 0;
+  for (uint16_t y = 0; y < h; y++) {
+    uint8_t* row    = rows_ + chunkCount * rowBytes;
+    uint16_t filled = 0;
+    while (filled < rowBytes) {
+      uint8_t header;
+      if (!next(header)) return false;
+      if (header < 128) {
+        const uint16_t count = header + 1;
+        if (filled + count > rowBytes) return false;
+        for (uint16_t i = 0; i < count; i++) {
+          if (!next(row[filled++])) return false;
+        }
+      }
+      else if (header > 128) {
+        const uint16_t count = 257 - header;
+        uint8_t value;
+        if (filled + count > rowBytes || !next(value)) return false;
+        memset(row + filled, value, count);
+        filled += count;
+      }
+    }
+
+    if (++chunkCount == chunkRows || y == h - 1) {
+      fn(chunkStart, rows_, chunkCount);
+      chunkStart = y + 1;
+      chunkCount = 0;
+    }
+  }
+  return true;
+}
+
+// ===================== private functions =====================
+bool TarotAtlas::entry(uint8_t card, uint8_t size, Entry& out) {
+  if (!open_ || card >= cardCount_ || size >= TAROT_SIZE_COUNT) return false;
+
+  uint8_t raw[9];
+  const uint32_t pos = headerSize + (uint32_t)card * recordSize + entryOffset + entrySize * size;
+  if (!file_.seek(pos) || file_.read(raw, sizeof(raw)) != sizeof(raw)) {
+    ESP_LOGE(tag, "Failed to read entry for card %u", card);
+    return false;
+  }
+  out.offset   = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((uint32_t)raw[3] << 24);
+  out.length   = raw[4] | (raw[5] << 8) | (raw[6] << 16) | ((uint32_t)raw[7] << 24);
+  out.encoding = raw[8];
+  if (out.encoding > ENCODING_PACKBITS) {
+    ESP_LOGE(tag, "Bad atlas entry for card %u size %u", card, size);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,229 @@
+// @knzet 2025
+#include <tarot_cache.h>
+#include <tarot_card_table.h>
+#include <config.h>
+#include <esp_heap_caps.h>
+#include <pocketmage_perf.h>
+
+// ===================== main functions =====================
+bool TarotCache::begin(fs::FS* fileSys) {
+  fileSys_ = fileSys;
+  if (!lock_) lock_ = xSemaphoreCreateMutex();
+  if (!lock_) return false;
+
+  if (atlas_.begin(fileSys_)) {
+    count_  = atlas_.count();
+    planes_ = atlas_.planes();
+  }
+  else ESP_LOGW(tag, "No card atlas, using per-card files");
+
+  // One fixed slot per card and size class when PSRAM is available
+  size_t total = 0;
+  for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) total += tarotBytes(s, planes_) * count_;
+
+  if (psramFound()) {
+    store_ = (uint8_t*)heap_caps_malloc(total, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  if (store_) {
+    resident_ = true;
+    ESP_LOGI(tag, "Resident cache: %u bytes in PSRAM", (unsigned)total);
+    return true;
+  }
+
+  // Otherwise fall back to a small LRU sized for the largest card
+  const size_t slotBytes = tarotBytes(TAROT_SIZE_1, planes_);
+  for (Slot& slot : slots_) {
+    slot.data = (uint8_t*)malloc(slotBytes);
+    if (!slot.data) {
+      ESP_LOGE(tag, "Failed to allocate LRU slot");
+      return false;
+    }
+  }
+  ESP_LOGI(tag, "LRU cache: %d slots", TAROT_CACHE_LRU_SLOTS);
+  return true;
+}
+
+void TarotCache::warm() {
+  if (!resident_) return;
+
+  PerfGuard perf("Tarot warm");
+  for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+    for (uint8_t c = 0; c < count_; c++) {
+      xSemaphoreTake(lock_, portMAX_DELAY);
+      if (!loaded_[s][c]) loaded_[s][c] = load(c, s, residentSlot(c, s));
+      xSemaphoreGive(lock_);
+      // Let the eink task in between cards
+      vTaskDelay(1);
+    }
+  }
+  ESP_LOGI(tag, "Warm complete");
+}
+
+void TarotCache::startWarmTask() {
+  if (!resident_) return;
+  xTaskCreatePinnedToCore(
+    warmTask,            // Function name
+    "tarotCacheWarm",    // Task name
+    4096,                // Stack size
+    this,                // Parameters
+    1,                   // Priority
+    NULL,                // Task handle
+    1                    // Core ID
+  );
+}
+
+void TarotCache::prefetch(const PrefetchItem* items, uint8_t n) {
+  if (!lock_ || !items) return;
+  if (!prefetchTask_) {
+    xTaskCreatePinnedToCore(
+      prefetchTask,        // Function name
+      "tarotPrefetch",     // Task name
+      4096,                // Stack size
+      this,                // Parameters
+      1,                   // Priority
+      &prefetchTask_,      // Task handle
+      1                    // Core ID
+    );
+    if (!prefetchTask_) return;
+  }
+
+  taskENTER_CRITICAL(&pendingMux_);
+  pendingCount_ = min(n, (uint8_t)TAROT_PREFETCH_MAX);
+  memcpy(pending_, items, pendingCount_ * sizeof(PrefetchItem));
+  // What was drawn since the last call stays, the next draw starts a spread
+  pendingPin_ = spread_++;
+  taskEXIT_CRITICAL(&pendingMux_);
+  xTaskNotifyGive(prefetchTask_);
+}
+
+const uint8_t* TarotCache::acquire(uint8_t card, uint8_t size) {
+  if (card >= count_ || size >= TAROT_SIZE_COUNT || !lock_) return nullptr;
+  xSemaphoreTake(lock_, portMAX_DELAY);
+
+  const uint8_t* data = lookup(card, size, true);
+  if (!data) xSemaphoreGive(lock_);
+  return data;
+}
+
+void TarotCache::release() {
+  if (lock_) xSemaphoreGive(lock_);
+}
+
+bool TarotCache::readRows(uint8_t card, uint8_t size, const TarotAtlas::RowFn& fn) {
+  if (card >= count_ || size >= TAROT_SIZE_COUNT || !lock_) return false;
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  const bool ok = atlas_.readRows(card, size, fn);
+  xSemaphoreGive(lock_);
+  return ok;
+}
+
+bool TarotCache::cardInfo(uint8_t card, TarotCardInfo& out) {
+  if (card >= count_) return false;
+
+  if (atlas_.isOpen() && lock_) {
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool ok = atlas_.info(card, out);
+    xSemaphoreGive(lock_);
+    return ok;
+  }
+
+  const TarotCardDef& def = TAROT_CARD_TABLE[card];
+  strlcpy(out.code, def.code, sizeof(out.code));
+  strlcpy(out.name, def.name, sizeof(out.name));
+  strlcpy(out.keywords, def.keywords, sizeof(out.keywords));
+  out.suit   = def.suit;
+  out.number = def.number;
+  return true;
+}
+
+// ===================== private functions =====================
+bool TarotCache::load(uint8_t card, uint8_t size, uint8_t* dst) {
+  if (!fileSys_ || !dst) return false;
+  const size_t len = tarotBytes(size, planes_);
+  if (atlas_.isOpen()) return atlas_.read(card, size, dst, len);
+
+  char path[32];
+  snprintf(path, sizeof(path), "/assets/tarot/%d/%s.bin", TAROT_SIZES[size].folder, TAROT_CARD_TABLE[card].code);
+
+  File f = fileSys_->open(path, "r");
+  if (!f || f.isDirectory()) {
+    ESP_LOGE(tag, "Failed to open file: %s", path);
+    return false;
+  }
+  size_t n = f.read(dst, len);
+  f.close();
+  return n == len;
+}
+
+// Find or load a card, lock_ must be held
+uint8_t* TarotCache::lookup(uint8_t card, uint8_t size, bool count, uint32_t pinned) {
+  if (resident_) {
+    uint8_t* dst = residentSlot(card, size);
+    if (loaded_[size][card]) {
+      if (count) hits_++;
+      return dst;
+    }
+    if (count) misses_++;
+    loaded_[size][card] = load(card, size, dst);
+    return loaded_[size][card] ? dst : nullptr;
+  }
+
+  // LRU lookup, a prefetch only evicts slots outside the pinned spread
+  const uint32_t spread = pinned ? pinned : spread_;
+  Slot* victim = nullptr;
+  for (Slot& slot : slots_) {
+    if (slot.valid && slot.card == card && slot.size == size) {
+      if (count) hits_++;
+      slot.lastUse = ++useTick_;
+      slot.spread  = spread;
+      return slot.data;
+    }
+    if (pinned && slot.spread == pinned) continue;
+    if (!victim || !slot.valid || (victim->valid && slot.lastUse < victim->lastUse)) victim = &slot;
+  }
+  if (!victim) return nullptr;
+
+  if (count) misses_++;
+  victim->valid = load(card, size, victim->data);
+  if (!victim->valid) return nullptr;
+  victim->card    = card;
+  victim->size    = size;
+  victim->lastUse = ++useTick_;
+  victim->spread  = spread;
+  return victim->data;
+}
+
+uint8_t* TarotCache::residentSlot(uint8_t card, uint8_t size) {
+  size_t offset = 0;
+  for (uint8_t s = 0; s < size; s++) offset += tarotBytes(s, planes_) * count_;
+  return store_ + offset + tarotBytes(size, planes_) * card;
+}
+
+void TarotCache::warmTask(void* parameter) {
+  static_cast<TarotCache*>(parameter)->warm();
+  vTaskDelete(NULL);
+}
+
+void TarotCache::prefetchTask(void* parameter) {
+  TarotCache* cache = static_cast<TarotCache*>(parameter);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    PrefetchItem items[TAROT_PREFETCH_MAX];
+    taskENTER_CRITICAL(&cache->pendingMux_);
+    const uint8_t  n      = cache->pendingCount_;
+    const uint32_t pinned = cache->pendingPin_;
+    memcpy(items, cache->pending_, n * sizeof(PrefetchItem));
+    cache->pendingCount_ = 0;
+    taskEXIT_CRITICAL(&cache->pendingMux_);
+
+    for (uint8_t i = 0; i < n; i++) {
+      if (items[i].card >= cache->count_ || items[i].size >= TAROT_SIZE_COUNT) continue;
+      xSemaphoreTake(cache->lock_, portMAX_DELAY);
+      cache->lookup(items[i].card, items[i].size, false, pinned);
+      xSemaphoreGive(cache->lock_);
+      // Let a draw that needs the cache in between cards
+      vTaskDelay(1);
+    }
+  }
+}
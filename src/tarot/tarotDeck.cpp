@@ -0,0 +1,94 @@
+// @knzet 2025
+#include <tarot_deck.h>
+#include <Preferences.h>
+
+extern Preferences prefs;
+
+// ===================== main functions =====================
+void TarotDeck::shuffle(uint8_t count) {
+  count_ = min(count, (uint8_t)TAROT_MAX_CARDS);
+  for (uint8_t i = 0; i < count_; i++) order_[i] = i;
+
+  // Fisher-Yates, walking down from the last slot
+  for (uint8_t i = count_; i > 1; i--) {
+    const uint8_t j = uniform(i);
+    std::swap(order_[i - 1], order_[j]);
+  }
+
+  if (allowReversed_) {
+    // One random bit per card
+    uint32_t bits = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+      if ((i & 31) == 0) bits = esp_random();
+      if (bits & 1) order_[i] |= reversedFlag;
+      bits >>= 1;
+    }
+  }
+
+  top_ = 0;
+}
+
+bool TarotDeck::draw(Card& out) {
+  if (top_ >= count_) return false;
+  const uint8_t slot = order_[top_++];
+  out.index    = slot & ~reversedFlag;
+  out.reversed = slot & reversedFlag;
+  return true;
+}
+
+bool TarotDeck::peek(uint8_t n, Card& out) const {
+  if (n >= remaining()) return false;
+  const uint8_t slot = order_[top_ + n];
+  out.index    = slot & ~reversedFlag;
+  out.reversed = slot & reversedFlag;
+  return true;
+}
+
+bool TarotDeck::load(uint8_t count) {
+  if (count == 0 || count > TAROT_MAX_CARDS) return false;
+
+  prefs.begin(nvsNamespace, true); // Read-Only
+  const size_t len = prefs.getBytesLength("order");
+  const uint8_t top = prefs.getUChar("top", count + 1);
+  std::array<uint8_t, TAROT_MAX_CARDS> order;
+  if (len == count) prefs.getBytes("order", order.data(), count);
+  prefs.end();
+
+  // A deck saved for a different card set (e.g. before the atlas was
+  // installed) is dropped rather than mapped
+  if (len != count || top > count) return false;
+
+  // Only accept a real permutation, anything else is stale or corrupt
+  bool seen[TAROT_MAX_CARDS] = {};
+  for (uint8_t i = 0; i < count; i++) {
+    const uint8_t card = order[i] & ~reversedFlag;
+    if (card >= count || seen[card]) {
+      ESP_LOGW(tag, "Stored deck invalid, reshuffling");
+      return false;
+    }
+    seen[card] = true;
+  }
+
+  order_ = order;
+  count_ = count;
+  top_   = top;
+  return true;
+}
+
+void TarotDeck::save() const {
+  prefs.begin(nvsNamespace, false);
+  prefs.putBytes("order", order_.data(), count_);
+  prefs.putUChar("top", top_);
+  prefs.end();
+}
+
+uint32_t TarotDeck::uniform(uint32_t n) {
+  if (n < 2) return 0;
+  // Reject the top partial range so every residue is equally likely
+  const uint32_t threshold = (0u - n) % n;
+  uint32_t r;
+  do {
+    r = esp_random();
+  } while (r < threshold);
+  return r % n;
+}
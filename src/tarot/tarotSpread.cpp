@@ -0,0 +1,148 @@
+// @knzet 2025
+#include <tarot_spread.h>
+
+// ===================== built-in spreads =====================
+// Centres are for the 320x240 landscape screen
+static const TarotSpread BUILTIN_SPREADS[] = {
+  { "Single Card", 1, {
+    { 160, 120, TAROT_SIZE_1, 0, "Card" },
+  } },
+  { "Three Cards", 3, {
+    {  62, 120, TAROT_SIZE_3, 0, "Past" },
+    { 160, 120, TAROT_SIZE_3, 0, "Present" },
+    { 258, 120, TAROT_SIZE_3, 0, "Future" },
+  } },
+  { "Five Card Cross", 5, {
+    { 160, 120, TAROT_SIZE_S, 0, "Present" },
+    { 110, 120, TAROT_SIZE_S, 0, "Past" },
+    { 210, 120, TAROT_SIZE_S, 0, "Future" },
+    { 160,  46, TAROT_SIZE_S, 0, "Above" },
+    { 160, 194, TAROT_SIZE_S, 0, "Below" },
+  } },
+  { "Horseshoe", 7, {
+    {  28,  70, TAROT_SIZE_S, 0, "Past" },
+    {  72, 110, TAROT_SIZE_S, 0, "Present" },
+    { 116, 150, TAROT_SIZE_S, 0, "Hidden" },
+    { 160, 190, TAROT_SIZE_S, 0, "Obstacle" },
+    { 204, 150, TAROT_SIZE_S, 0, "Others" },
+    { 248, 110, TAROT_SIZE_S, 0, "Advice" },
+    { 292,  70, TAROT_SIZE_S, 0, "Outcome" },
+  } },
+  { "Celtic Cross", 10, {
+    { 100, 120, TAROT_SIZE_S, 0, "Present" },
+    { 100, 120, TAROT_SIZE_S, 1, "Challenge" },
+    { 100, 194, TAROT_SIZE_S, 0, "Foundation" },
+    {  40, 120, TAROT_SIZE_S, 0, "Past" },
+    { 100,  46, TAROT_SIZE_S, 0, "Crown" },
+    { 160, 120, TAROT_SIZE_S, 0, "Future" },
+    { 236, 162, TAROT_SIZE_S, 0, "Self" },
+    { 286, 162, TAROT_SIZE_S, 0, "Environment" },
+    { 236,  78, TAROT_SIZE_S, 0, "Hopes" },
+    { 286,  78, TAROT_SIZE_S, 0, "Outcome" },
+  } },
+};
+
+// ===================== main functions =====================
+void TarotSpreads::begin(fs::FS* fileSys, int16_t screenW, int16_t screenH) {
+  screenW_ = screenW;
+  screenH_ = screenH;
+  count_   = 0;
+
+  for (const TarotSpread& spread : BUILTIN_SPREADS) add(spread);
+
+  if (!fileSys || !fileSys->exists(TAROT_SPREAD_DIR)) return;
+  File dir = fileSys->open(TAROT_SPREAD_DIR);
+  if (!dir || !dir.isDirectory()) return;
+
+  File file = dir.openNextFile();
+  while (file && count_ < TAROT_MAX_SPREADS) {
+    TarotSpread spread;
+    if (!file.isDirectory() && String(file.name()).endsWith(".txt")) {
+      if (loadFile(file, spread) && add(spread)) ESP_LOGI(tag, "Loaded spread: %s", spread.name);
+      else ESP_LOGW(tag, "Skipping spread file: %s", file.name());
+    }
+    file.close();
+    file = dir.openNextFile();
+  }
+  dir.close();
+}
+
+uint8_t TarotSpreads::findByCount(uint8_t n) const {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (spreads_[i].count == n) return i;
+  }
+  return 0;
+}
+
+// ===================== private functions =====================
+bool TarotSpreads::add(const TarotSpread& spread) {
+  if (count_ >= TAROT_MAX_SPREADS) return false;
+  TarotSpread& dst = spreads_[count_];
+  dst = spread;
+  if (!place(dst)) {
+    ESP_LOGW(tag, "Spread does not fit the screen: %s", spread.name);
+    return false;
+  }
+  count_++;
+  return true;
+}
+
+bool TarotSpreads::loadFile(File& file, TarotSpread& out) {
+  out.count = 0;
+  strlcpy(out.name, file.name(), sizeof(out.name));
+
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0 || line[0] == '#') continue;
+
+    if (line.startsWith("name ")) {
+      strlcpy(out.name, line.c_str() + 5, sizeof(out.name));
+    }
+    else if (line.startsWith("card ")) {
+      if (out.count >= TAROT_SPREAD_MAX_SLOTS) return false;
+      int cx, cy, folder, turns, used = 0;
+      if (sscanf(line.c_str() + 5, "%d %d %d %d %n", &cx, &cy, &folder, &turns, &used) < 4) return false;
+
+      // Size is given by asset folder so files read like the SD layout
+      uint8_t size = TAROT_SIZE_COUNT;
+      for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+        if (TAROT_SIZES[s].folder == folder) size = s;
+      }
+      if (size == TAROT_SIZE_COUNT || turns < 0 || turns > 3) return false;
+
+      TarotSlot& slot = out.slots[out.count++];
+      slot.cx    = cx;
+      slot.cy    = cy;
+      slot.size  = size;
+      slot.turns = turns;
+      strlcpy(slot.label, line.c_str() + 5 + used, sizeof(slot.label));
+    }
+    else {
+      return false;
+    }
+  }
+  return out.count > 0;
+}
+
+bool TarotSpreads::place(TarotSpread& spread) const {
+  if (spread.count == 0 || spread.count > TAROT_SPREAD_MAX_SLOTS) return false;
+
+  for (uint8_t i = 0; i < spread.count; i++) {
+    const TarotSlot&  slot = spread.slots[i];
+    TarotPlacement&   p    = spread.placements[i];
+    const bool        side = slot.turns & 1;
+    p.w = side ? TAROT_SIZES[slot.size].h : TAROT_SIZES[slot.size].w;
+    p.h = side ? TAROT_SIZES[slot.size].w : TAROT_SIZES[slot.size].h;
+    p.x = slot.cx - p.w / 2;
+    p.y = slot.cy - p.h / 2;
+    if (p.x < 0 || p.y < 0 || p.x + p.w > screenW_ || p.y + p.h > screenH_) return false;
+
+    p.overlaps = false;
+    for (uint8_t j = 0; j < i; j++) {
+      const TarotPlacement& q = spread.placements[j];
+      if (p.x < q.x + q.w && q.x < p.x + p.w && p.y < q.y + q.h && q.y < p.y + p.h) p.overlaps = true;
+    }
+  }
+  return true;
+}
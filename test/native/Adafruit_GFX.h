@@ -0,0 +1,156 @@
+#pragma once
+// ===================== HOST ADAFRUIT GFX =====================
+// The part of Adafruit_GFX the display code uses: rotation, lines and rects
+// through drawPixel(), and text with GFX fonts drawn from their glyph
+// bitmaps the way the library does (cursor on the baseline, wrapping at
+// the right edge). The built-in font has no glyph table here, each of its
+// characters is drawn as a 5x7 outline in a 6x8 cell.
+#include <Arduino.h>
+#include <gfxfont.h>
+
+class Adafruit_GFX {
+public:
+  Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) {}
+  virtual ~Adafruit_GFX() {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t j = y; j < y + h; j++) {
+      for (int16_t i = x; i < x + w; i++) drawPixel(i, j, color);
+    }
+  }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w <= 0 || h <= 0) return;
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+  }
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    const bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) { std::swap(x0, y0); std::swap(x1, y1); }
+    if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+    const int16_t dx = x1 - x0, dy = abs(y1 - y0), ystep = y0 < y1 ? 1 : -1;
+    int16_t err = dx / 2;
+    for (; x0 <= x1; x0++) {
+      if (steep) drawPixel(y0, x0, color);
+      else       drawPixel(x0, y0, color);
+      err -= dy;
+      if (err < 0) { y0 += ystep; err += dx; }
+    }
+  }
+
+  void    setRotation(uint8_t r) {
+    rotation = r & 3;
+    _width   = (rotation & 1) ? HEIGHT : WIDTH;
+    _height  = (rotation & 1) ? WIDTH : HEIGHT;
+  }
+  uint8_t getRotation() const { return rotation; }
+  int16_t width()       const { return _width; }
+  int16_t height()      const { return _height; }
+
+  void    setCursor(int16_t x, int16_t y)        { cursor_x = x; cursor_y = y; }
+  int16_t getCursorX() const                     { return cursor_x; }
+  int16_t getCursorY() const                     { return cursor_y; }
+  void    setTextSize(uint8_t s)                 { textsize = s ? s : 1; }
+  void    setTextColor(uint16_t c)               { textcolor = c; }
+  void    setTextColor(uint16_t c, uint16_t)     { textcolor = c; }
+  void    setTextWrap(bool w)                    { wrap = w; }
+  // Like the library, switching between the built-in and a GFX font moves
+  // the cursor so text stays on the same line
+  void    setFont(const GFXfont* f) {
+    if (f && !gfxFont)      cursor_y += 6;
+    else if (!f && gfxFont) cursor_y -= 6;
+    gfxFont = f;
+  }
+
+  virtual size_t write(uint8_t c) {
+    if (!gfxFont) {
+      if (c == '\n') { cursor_x = 0; cursor_y += textsize * 8; return 1; }
+      if (c == '\r') return 1;
+      if (wrap && cursor_x + textsize * 6 > _width) { cursor_x = 0; cursor_y += textsize * 8; }
+      drawRect(cursor_x, cursor_y, 5 * textsize, 7 * textsize, textcolor);
+      cursor_x += textsize * 6;
+      return 1;
+    }
+    if (c == '\n') { cursor_x = 0; cursor_y += textsize * gfxFont->yAdvance; return 1; }
+    if (c == '\r' || c < gfxFont->first || c > gfxFont->last) return 1;
+    const GFXglyph& g = gfxFont->glyph[c - gfxFont->first];
+    if (g.width && g.height) {
+      if (wrap && cursor_x + textsize * (g.xOffset + g.width) > _width) {
+        cursor_x  = 0;
+        cursor_y += textsize * gfxFont->yAdvance;
+      }
+      drawGlyph_(g);
+    }
+    cursor_x += g.xAdvance * textsize;
+    return 1;
+  }
+  size_t write(const uint8_t* buf, size_t n) {
+    for (size_t i = 0; i < n; i++) write(buf[i]);
+    return n;
+  }
+  size_t print(const char* s)    { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t print(const String& s)  { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(char c)           { return write((uint8_t)c); }
+  size_t print(long v)           { return print(String(v)); }
+  size_t println(const char* s)  { return print(s) + write('\n'); }
+  size_t println(const String& s){ return print(s) + write('\n'); }
+
+  // Single-line bounds, no wrapping
+  void getTextBounds(const char* s, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+    if (!gfxFont) {
+      *x1 = x;
+      *y1 = y;
+      *w  = s ? strlen(s) * 6 * textsize : 0;
+      *h  = *w ? 8 * textsize : 0;
+      return;
+    }
+    int16_t minx = INT16_MAX, miny = INT16_MAX, maxx = INT16_MIN, maxy = INT16_MIN;
+    for (; s && *s; s++) {
+      const uint8_t c = *s;
+      if (c < gfxFont->first || c > gfxFont->last) continue;
+      const GFXglyph& g = gfxFont->glyph[c - gfxFont->first];
+      if (g.width && g.height) {
+        minx = min<int16_t>(minx, x + g.xOffset * textsize);
+        miny = min<int16_t>(miny, y + g.yOffset * textsize);
+        maxx = max<int16_t>(maxx, x + (g.xOffset + g.width) * textsize - 1);
+        maxy = max<int16_t>(maxy, y + (g.yOffset + g.height) * textsize - 1);
+      }
+      x += g.xAdvance * textsize;
+    }
+    *x1 = maxx >= minx ? minx : x;
+    *y1 = maxy >= miny ? miny : y;
+    *w  = maxx >= minx ? maxx - minx + 1 : 0;
+    *h  = maxy >= miny ? maxy - miny + 1 : 0;
+  }
+
+protected:
+  void drawGlyph_(const GFXglyph& g) {
+    const uint8_t* bits = gfxFont->bitmap + g.bitmapOffset;
+    uint16_t bit = 0;
+    for (uint8_t yy = 0; yy < g.height; yy++) {
+      for (uint8_t xx = 0; xx < g.width; xx++, bit++) {
+        if (!(bits[bit / 8] & (0x80 >> (bit & 7)))) continue;
+        const int16_t px = cursor_x + (g.xOffset + xx) * textsize;
+        const int16_t py = cursor_y + (g.yOffset + yy) * textsize;
+        if (textsize == 1) drawPixel(px, py, textcolor);
+        else               fillRect(px, py, textsize, textsize, textcolor);
+      }
+    }
+  }
+
+  const int16_t  WIDTH, HEIGHT;
+  int16_t        _width, _height;
+  int16_t        cursor_x  = 0;
+  int16_t        cursor_y  = 0;
+  uint16_t       textcolor = 0xFFFF;
+  uint8_t        textsize  = 1;
+  uint8_t        rotation  = 0;
+  bool           wrap      = true;
+  const GFXfont* gfxFont   = nullptr;
+};
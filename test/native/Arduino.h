@@ -0,0 +1,136 @@
+#pragma once
+// ===================== HOST ARDUINO =====================
+// Just enough of the ESP32 Arduino core for the pure-logic libraries to
+// build and run on the host ([env:native] in platformio.ini). Time is real
+// time; esp_random() is a seeded generator so a failing test can be rerun.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <esp_log.h>
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(addr)  (*(const uint8_t*)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_pointer(addr) ((void*)*(void* const*)(addr))
+
+typedef uint8_t byte;
+
+// ===================== STRING =====================
+class String {
+public:
+  String(const char* s = "") : s_(s ? s : "") {}
+  String(const char* s, size_t n) : s_(s, n) {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  template <typename T, typename = std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, char>::value>>
+  explicit String(T v) : s_(std::to_string(v)) {}
+
+  const char* c_str() const                           { return s_.c_str(); }
+  size_t      length() const                           { return s_.size(); }
+  bool        isEmpty() const                          { return s_.empty(); }
+  char        operator[](size_t i) const               { return i < s_.size() ? s_[i] : '\0'; }
+  char&       operator[](size_t i)                     { return s_[i]; }
+  char        charAt(size_t i) const                   { return (*this)[i]; }
+  bool        reserve(size_t n)                        { s_.reserve(n); return true; }
+
+  String& operator=(const char* s)                     { s_ = s ? s : ""; return *this; }
+  String& operator+=(const String& o)                  { s_ += o.s_; return *this; }
+  String& operator+=(const char* o)                    { s_ += o; return *this; }
+  String& operator+=(char c)                           { s_ += c; return *this; }
+  bool    concat(const String& o)                      { s_ += o.s_; return true; }
+  bool    concat(const char* o, size_t n)              { s_.append(o, n); return true; }
+
+  bool operator==(const String& o) const               { return s_ == o.s_; }
+  bool operator!=(const String& o) const               { return s_ != o.s_; }
+  bool operator==(const char* o) const                 { return s_ == o; }
+  bool operator!=(const char* o) const                 { return s_ != o; }
+  bool operator<(const String& o) const                { return s_ < o.s_; }
+  bool equals(const String& o) const                   { return s_ == o.s_; }
+  bool startsWith(const String& p) const               { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+
+  int indexOf(char c, size_t from = 0) const           { return found_(s_.find(c, from)); }
+  int indexOf(const String& s, size_t from = 0) const  { return found_(s_.find(s.s_, from)); }
+  int lastIndexOf(char c) const                        { return found_(s_.rfind(c)); }
+  String substring(size_t from) const                  { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(size_t from, size_t to) const {
+    if (from > to) std::swap(from, to);
+    return from < s_.size() ? String(s_.substr(from, to - from)) : String();
+  }
+  long toInt() const                                   { return strtol(s_.c_str(), nullptr, 10); }
+  void trim() {
+    const size_t a = s_.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s_.clear(); return; }
+    s_ = s_.substr(a, s_.find_last_not_of(" \t\r\n") - a + 1);
+  }
+
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b)   { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b)   { String r(a); r += b; return r; }
+  friend String operator+(const String& a, char b)          { String r(a); r += b; return r; }
+
+private:
+  static int found_(size_t pos)                        { return pos == std::string::npos ? -1 : (int)pos; }
+  std::string s_;
+};
+
+// glibc only has it from 2.38
+inline size_t pm_strlcpy(char* dst, const char* src, size_t n) {
+  const size_t len = strlen(src);
+  if (n) {
+    const size_t copy = len < n - 1 ? len : n - 1;
+    memcpy(dst, src, copy);
+    dst[copy] = '\0';
+  }
+  return len;
+}
+#define strlcpy pm_strlcpy
+
+// ===================== TIME =====================
+inline std::chrono::steady_clock::time_point hostStart() {
+  static const auto start = std::chrono::steady_clock::now();
+  return start;
+}
+inline unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStart()).count();
+}
+inline unsigned long millis() { return micros() / 1000; }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() { std::this_thread::yield(); }
+
+// ===================== CHIP =====================
+// Tests flip these to take the no-PSRAM paths
+inline std::atomic<bool>     hostPsram{true};
+inline std::atomic<uint32_t> hostCpuMhz{240};
+
+inline bool     psramFound()                      { return hostPsram; }
+inline bool     setCpuFrequencyMhz(uint32_t mhz)  { hostCpuMhz = mhz; return true; }
+inline uint32_t getCpuFrequencyMhz()              { return hostCpuMhz; }
+
+inline std::mutex&   hostRandomLock() { static std::mutex m; return m; }
+inline std::mt19937& hostRandom()     { static std::mt19937 r(12345); return r; }
+inline void     hostRandomSeed(uint32_t seed) { std::lock_guard<std::mutex> l(hostRandomLock()); hostRandom().seed(seed); }
+inline uint32_t esp_random()                  { std::lock_guard<std::mutex> l(hostRandomLock()); return hostRandom()(); }
+
+// The ESP32 core pulls these in for every sketch
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
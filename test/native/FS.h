@@ -0,0 +1,360 @@
+#pragma once
+// ===================== HOST FILE SYSTEM =====================
+// fs::FS and File backed by RAM, with the Arduino-ESP32 semantics the
+// libraries rely on: "r" fails on a missing file, "w" truncates, "a" always
+// writes at the end, "r+" reads and writes in place, rename() fails onto an
+// existing path, and copies of a File share one handle.
+//
+// The file system counts what reaches the "card" (opens, reads, writes and
+// their bytes, seeks) so tests can check how much I/O an operation costs,
+// and can cut writes short to simulate a torn write or a full card.
+// Every call is locked, so the SD worker thread and the test can share it.
+#include <Arduino.h>
+#include <stdarg.h>
+#include <map>
+#include <memory>
+#include <set>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FS;
+
+struct FileImpl {
+  FS*                          fs        = nullptr;
+  std::shared_ptr<std::string> data;
+  std::string                  path;
+  size_t                       pos       = 0;
+  bool                         canRead   = false;
+  bool                         canWrite  = false;
+  bool                         append    = false;
+  bool                         directory = false;
+  bool                         open      = false;
+
+  void close();
+  // The last copy of a File closes it, like VFSFileImpl
+  ~FileImpl() { close(); }
+};
+
+class File {
+public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> impl) : p_(std::move(impl)) {}
+
+  explicit operator bool() const { return p_ && p_->open; }
+
+  size_t write(const uint8_t* buf, size_t size);
+  size_t write(uint8_t c)                              { return write(&c, 1); }
+  size_t read(uint8_t* buf, size_t size);
+  int    read()                                        { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+  int    peek();
+  int    available();
+  bool   seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const                              { return *this ? p_->pos : 0; }
+  size_t size() const;
+  void   flush()                                       {}
+  void   close();
+  bool   isDirectory() const                           { return *this && p_->directory; }
+  const char* path() const                             { return p_ ? p_->path.c_str() : ""; }
+  const char* name() const;
+  File   openNextFile(const char* mode = FILE_READ)    { (void)mode; return File(); }
+
+  size_t print(const char* s)                          { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s)                        { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t println(const char* s = "")                   { return print(s) + print("\r\n"); }
+  size_t println(const String& s)                      { return print(s) + print("\r\n"); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  String readStringUntil(char terminator);
+  String readString();
+
+private:
+  std::shared_ptr<FileImpl> p_;
+};
+
+class FS {
+public:
+  struct Stats {
+    uint32_t opens;             // successful open() calls
+    uint32_t reads;             // read() calls that reached the card
+    uint32_t writes;            // write() calls
+    uint32_t seeks;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint32_t removes;
+    uint32_t renames;
+    uint32_t removedWhileOpen;  // remove() or rename() of a file someone had open
+  };
+
+  File open(const char* path, const char* mode = FILE_READ, bool create = false);
+  File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+  bool exists(const char* path);
+  bool exists(const String& path)                                   { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path)                                   { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to)                 { return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path)                                    { return mkdir(path.c_str()); }
+  bool rmdir(const char* path)                                      { std::lock_guard<std::recursive_mutex> l(lock_); return dirs_.erase(path) > 0; }
+
+  // ---- host side ----
+  // Contents of a file, "" if there is none
+  std::string contents(const char* path);
+  // Create or replace a file without counting it as I/O
+  void        put(const char* path, const std::string& data);
+  void        clear();
+  size_t      fileCount()                                           { std::lock_guard<std::recursive_mutex> l(lock_); return files_.size(); }
+  // Handles open on path right now
+  int         openHandles(const char* path);
+
+  Stats       stats()                                               { std::lock_guard<std::recursive_mutex> l(lock_); return stats_; }
+  void        resetStats()                                          { std::lock_guard<std::recursive_mutex> l(lock_); stats_ = {}; }
+  // Bytes the card still takes; a write past it is cut short, as on a
+  // full card or a power cut mid-write. SIZE_MAX for no limit.
+  void        setWriteBudget(size_t bytes)                          { std::lock_guard<std::recursive_mutex> l(lock_); writeBudget_ = bytes; }
+
+private:
+  friend class File;
+  friend struct FileImpl;
+
+  std::recursive_mutex                                         lock_;
+  std::map<std::string, std::shared_ptr<std::string>>         files_;
+  std::set<std::string>                                        dirs_ = { "/" };
+  std::map<const std::string*, int>                            open_;   // handles per file data
+  Stats                                                        stats_       = {};
+  size_t                                                       writeBudget_ = SIZE_MAX;
+};
+
+// ===================== FILE =====================
+inline size_t File::write(const uint8_t* buf, size_t size) {
+  if (!*this || !p_->canWrite) return 0;
+  std::lock_guard<std::recursive_mutex> l(p_->fs->lock_);
+  FS& fs = *p_->fs;
+  size = min(size, fs.writeBudget_);
+  if (fs.writeBudget_ != SIZE_MAX) fs.writeBudget_ -= size;
+  std::string& data = *p_->data;
+  if (p_->append) p_->pos = data.size();
+  if (p_->pos > data.size()) data.resize(p_->pos, '\0');
+  data.replace(p_->pos, min(size, data.size() - p_->pos), (const char*)buf, size);
+  p_->pos += size;
+  fs.stats_.writes++;
+  fs.stats_.bytesWritten += size;
+  return size;
+}
+
+inline size_t File::read(uint8_t* buf, size_t size) {
+  if (!*this || !p_->canRead) return 0;
+  std::lock_guard<std::recursive_mutex> l(p_->fs->lock_);
+  const std::string& data = *p_->data;
+  const size_t n = p_->pos < data.size() ? min(size, data.size() - p_->pos) : 0;
+  if (n) memcpy(buf, data.data() + p_->pos, n);
+  p_->pos += n;
+  p_->fs->stats_.reads++;
+  p_->fs->stats_.bytesRead += n;
+  return n;
+}
+
+inline int File::peek() {
+  if (!*this || !p_->canRead) return -1;
+  std::lock_guard<std::recursive_mutex> l(p_->fs->lock_);
+  return p_->pos < p_->data->size() ? (uint8_t)(*p_->data)[p_->pos] : -1;
+}
+
+inline int File::available() {
+  if (!*this) return 0;
+  std::lock_guard<std::recursive_mutex> l(p_->fs->lock_);
+  return p_->pos < p_->data->size() ? (int)(p_->data->size() - p_->pos) : 0;
+}
+
+inline bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!*this || p_->directory) return false;
+  std::lock_guard<std::recursive_mutex> l(p_->fs->lock_);
+  if (mode == SeekCur) pos += p_->pos;
+  if (mode == SeekEnd) pos += p_->data->size();
+  p_->pos = pos;
+  p_->fs->stats_.seeks++;
+  return true;
+}
+
+inline size_t File::size() const {
+  if (!*this || p_->directory) return 0;
+  std::lock_guard<std::recursive_mutex> l(p_->fs->lock_);
+  return p_->data->size();
+}
+
+inline void FileImpl::close() {
+  if (!open) return;
+  std::lock_guard<std::recursive_mutex> l(fs->lock_);
+  auto it = data ? fs->open_.find(data.get()) : fs->open_.end();
+  if (it != fs->open_.end() && --it->second == 0) fs->open_.erase(it);
+  open = false;
+}
+
+inline void File::close() {
+  if (p_) p_->close();
+  p_.reset();
+}
+
+inline const char* File::name() const {
+  if (!p_) return "";
+  const size_t slash = p_->path.rfind('/');
+  return p_->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+inline size_t File::printf(const char* format, ...) {
+  char    small[128];
+  va_list args;
+  va_start(args, format);
+  const int len = vsnprintf(small, sizeof(small), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(small)) return write((const uint8_t*)small, len);
+
+  std::string big(len + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&big[0], big.size(), format, args);
+  va_end(args);
+  return write((const uint8_t*)big.data(), len);
+}
+
+inline String File::readStringUntil(char terminator) {
+  std::string out;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) out += (char)c;
+  return String(out);
+}
+
+inline String File::readString() {
+  std::string out;
+  int c;
+  while ((c = read()) >= 0) out += (char)c;
+  return String(out);
+}
+
+// ===================== FS =====================
+inline File FS::open(const char* path, const char* mode, bool create) {
+  (void)create;
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  auto impl = std::make_shared<FileImpl>();
+  impl->fs   = this;
+  impl->path = path;
+
+  if (dirs_.count(path)) {
+    if (mode[0] != 'r') return File();
+    impl->directory = true;
+    impl->open      = true;
+    stats_.opens++;
+    return File(impl);
+  }
+
+  auto it = files_.find(path);
+  const bool plus = strchr(mode, '+') != nullptr;
+  switch (mode[0]) {
+    case 'r':
+      if (it == files_.end()) return File();
+      impl->data     = it->second;
+      impl->canRead  = true;
+      impl->canWrite = plus;
+      break;
+    case 'w':
+      if (it == files_.end()) it = files_.emplace(path, std::make_shared<std::string>()).first;
+      it->second->clear();
+      impl->data     = it->second;
+      impl->canWrite = true;
+      impl->canRead  = plus;
+      break;
+    case 'a':
+      if (it == files_.end()) it = files_.emplace(path, std::make_shared<std::string>()).first;
+      impl->data     = it->second;
+      impl->canWrite = true;
+      impl->canRead  = plus;
+      impl->append   = true;
+      impl->pos      = impl->data->size();
+      break;
+    default:
+      return File();
+  }
+  impl->open = true;
+  open_[impl->data.get()]++;
+  stats_.opens++;
+  return File(impl);
+}
+
+inline bool FS::exists(const char* path) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  return files_.count(path) || dirs_.count(path);
+}
+
+inline bool FS::remove(const char* path) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  auto it = files_.find(path);
+  if (it == files_.end()) return false;
+  if (open_.count(it->second.get())) stats_.removedWhileOpen++;
+  files_.erase(it);
+  stats_.removes++;
+  return true;
+}
+
+inline bool FS::rename(const char* from, const char* to) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  auto it = files_.find(from);
+  if (it == files_.end() || files_.count(to) || dirs_.count(to)) return false;
+  if (open_.count(it->second.get())) stats_.removedWhileOpen++;
+  auto data = it->second;
+  files_.erase(it);
+  files_.emplace(to, data);
+  stats_.renames++;
+  return true;
+}
+
+inline bool FS::mkdir(const char* path) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  if (files_.count(path)) return false;
+  dirs_.insert(path);
+  return true;
+}
+
+inline std::string FS::contents(const char* path) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  auto it = files_.find(path);
+  return it == files_.end() ? std::string() : *it->second;
+}
+
+inline void FS::put(const char* path, const std::string& data) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  auto it = files_.find(path);
+  // In place, like a write through another program: open handles see it
+  if (it != files_.end()) *it->second = data;
+  else files_.emplace(path, std::make_shared<std::string>(data));
+}
+
+inline void FS::clear() {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  files_.clear();
+  dirs_ = { "/" };
+  open_.clear();
+  stats_       = {};
+  writeBudget_ = SIZE_MAX;
+}
+
+inline int FS::openHandles(const char* path) {
+  std::lock_guard<std::recursive_mutex> l(lock_);
+  auto it = files_.find(path);
+  if (it == files_.end()) return 0;
+  auto open = open_.find(it->second.get());
+  return open == open_.end() ? 0 : open->second;
+}
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
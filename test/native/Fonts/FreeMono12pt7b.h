@@ -0,0 +1,4 @@
+#pragma once
+#include "hostfont.h"
+
+HOST_GFX_FONT(FreeMono12pt7b, 14, 14, true, 24)
@@ -0,0 +1,4 @@
+#pragma once
+#include "hostfont.h"
+
+HOST_GFX_FONT(FreeMonoBold9pt7b, 11, 11, true, 18)
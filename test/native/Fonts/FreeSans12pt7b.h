@@ -0,0 +1,4 @@
+#pragma once
+#include "hostfont.h"
+
+HOST_GFX_FONT(FreeSans12pt7b, 17, 12, false, 29)
@@ -0,0 +1,4 @@
+#pragma once
+#include "hostfont.h"
+
+HOST_GFX_FONT(FreeSans9pt7b, 12, 9, false, 22)
@@ -0,0 +1,4 @@
+#pragma once
+#include "hostfont.h"
+
+HOST_GFX_FONT(FreeSerif12pt7b, 16, 11, false, 29)
@@ -0,0 +1,41 @@
+#pragma once
+// ===================== HOST GFX FONTS =====================
+// Stand-ins for the Adafruit GFX fonts the display code includes. Each is
+// a real GFXfont covering ' '..'~' with roughly the original's advances and
+// line height; glyphs are a shared pattern, so text draws real pixels and
+// measures like the original without shipping the font tables twice.
+// Proportional fonts vary the advance by character.
+#include <Adafruit_GFX.h>
+
+inline const uint8_t hostFontBitmap[64] = {
+  0x7E, 0xC3, 0x99, 0xA5, 0xA5, 0x99, 0xC3, 0x7E, 0x3C, 0x66, 0xDB, 0xBD,
+  0xBD, 0xDB, 0x66, 0x3C, 0x7E, 0xC3, 0x99, 0xA5, 0xA5, 0x99, 0xC3, 0x7E,
+  0x3C, 0x66, 0xDB, 0xBD, 0xBD, 0xDB, 0x66, 0x3C, 0x7E, 0xC3, 0x99, 0xA5,
+  0xA5, 0x99, 0xC3, 0x7E, 0x3C, 0x66, 0xDB, 0xBD, 0xBD, 0xDB, 0x66, 0x3C,
+  0x7E, 0xC3, 0x99, 0xA5, 0xA5, 0x99, 0xC3, 0x7E, 0x3C, 0x66, 0xDB, 0xBD,
+  0xBD, 0xDB, 0x66, 0x3C,
+};
+
+template <uint8_t Height, uint8_t Advance, bool Mono>
+struct HostFontGlyphs {
+  GFXglyph glyph['~' - ' ' + 1];
+
+  constexpr HostFontGlyphs() : glyph() {
+    for (int c = ' '; c <= '~'; c++) {
+      const uint8_t advance = Mono ? Advance : (uint8_t)(Advance - 2 + c % 5);
+      const bool    descends = c == 'g' || c == 'j' || c == 'p' || c == 'q' || c == 'y';
+      GFXglyph& g = glyph[c - ' '];
+      g.bitmapOffset = (uint16_t)(c % 8);
+      g.width        = c == ' ' ? 0 : (uint8_t)(advance - 1);
+      g.height       = c == ' ' ? 0 : Height;
+      g.xAdvance     = advance;
+      g.xOffset      = 0;
+      g.yOffset      = (int8_t)(descends ? 3 - Height : -Height);
+    }
+  }
+};
+
+#define HOST_GFX_FONT(name, height, advance, mono, yAdvance)                              \
+  inline const HostFontGlyphs<height, advance, mono> name##Glyphs;                        \
+  inline const GFXfont name = { (uint8_t*)hostFontBitmap, (GFXglyph*)name##Glyphs.glyph,  \
+                                ' ', '~', yAdvance };
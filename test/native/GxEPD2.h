@@ -0,0 +1,7 @@
+#pragma once
+// ===================== HOST GXEPD2 =====================
+// Colors from GxEPD2.h; the fake panel itself is in GxEPD2_BW.h
+#define GxEPD_BLACK     0x0000
+#define GxEPD_WHITE     0xFFFF
+#define GxEPD_DARKGREY  0x7BEF
+#define GxEPD_LIGHTGREY 0xC618
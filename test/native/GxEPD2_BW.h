@@ -0,0 +1,347 @@
+#pragma once
+// ===================== HOST GXEPD2_BW =====================
+// A fake GDEQ031T10 behind the GxEPD2_BW interface. The frame buffer,
+// rotation, partial windows and paging follow GxEPD2 (bit set = white,
+// buffer rows are panel rows, a partial window is byte aligned on the panel
+// x axis, a fast-partial panel runs each page loop twice). What the library
+// would send over SPI lands in a copy of the controller RAM, and a refresh
+// copies that to the "screen" and then holds BUSY high for the time
+// configured on the panel, calling the busy callback meanwhile just like
+// GxEPD2's _waitWhileBusy(). The second write of a fast-partial panel goes
+// to the controller's previous-frame RAM, which the next partial refresh is
+// diffed against. Every transfer, refresh and power call is logged so tests
+// can check what reached the panel.
+//
+// The page height is a template argument on the device. hostSetPageHeight()
+// lowers it at run time so one build can render with several band heights.
+#include <Adafruit_GFX.h>
+#include <GxEPD2.h>
+#include <memory>
+#include <vector>
+
+// What reached the panel, in order
+struct GxEPD2_HostOp {
+  enum Kind : uint8_t { WRITE, WRITE_AGAIN, REFRESH_SLOW, REFRESH_FAST, REFRESH_PARTIAL, POWER_OFF, HIBERNATE };
+  Kind    kind;
+  int16_t x, y, w, h;   // panel coordinates, writes and REFRESH_PARTIAL only
+};
+
+class GxEPD2_310_GDEQ031T10 {
+public:
+  static constexpr uint16_t WIDTH  = 240;
+  static constexpr uint16_t HEIGHT = 320;
+  static constexpr bool hasFastPartialUpdate = true;
+  // From the GxEPD2 fork the app builds with, selects the fast waveform
+  // for full refreshes
+  static inline bool useFastFullUpdate = false;
+
+  struct Host {
+    std::mutex                 lock;
+    std::vector<uint8_t>       ram    = std::vector<uint8_t>(WIDTH / 8 * HEIGHT, 0xFF);
+    std::vector<uint8_t>       screen = std::vector<uint8_t>(WIDTH / 8 * HEIGHT, 0xFF);
+    std::vector<uint8_t>       previous = std::vector<uint8_t>(WIDTH / 8 * HEIGHT, 0xFF);
+    std::vector<GxEPD2_HostOp> log;
+    uint32_t bytesWritten  = 0;
+    uint32_t busyCallbacks = 0;
+    // BUSY time per refresh kind, and the SPI rate, 0 = instant
+    uint32_t busySlowMicros    = 0;
+    uint32_t busyFastMicros    = 0;
+    uint32_t busyPartialMicros = 0;
+    float    bytesPerMicro     = 0;
+  };
+
+  GxEPD2_310_GDEQ031T10(int16_t cs, int16_t dc, int16_t rst, int16_t busy) : host(std::make_shared<Host>()) {
+    (void)cs; (void)dc; (void)rst; (void)busy;
+  }
+
+  void setBusyCallback(void (*callback)(const void*), const void* parameter = 0) {
+    busyCallback_  = callback;
+    busyParameter_ = parameter;
+  }
+
+  // Rows y..y+h of a buffer `stride` pixels wide, columns x..x+w, to RAM
+  // at (dx, dy)
+  void writeImagePart(const uint8_t* buffer, int16_t stride, int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy) {
+    write_(host->ram, GxEPD2_HostOp::WRITE, buffer, stride, x, y, w, h, dx, dy);
+  }
+  // The same into the previous-frame RAM, after a refresh
+  void writeImagePartAgain(const uint8_t* buffer, int16_t stride, int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy) {
+    write_(host->previous, GxEPD2_HostOp::WRITE_AGAIN, buffer, stride, x, y, w, h, dx, dy);
+  }
+  void refresh(bool partial) {
+    const GxEPD2_HostOp::Kind kind = partial ? GxEPD2_HostOp::REFRESH_PARTIAL
+                                   : useFastFullUpdate ? GxEPD2_HostOp::REFRESH_FAST : GxEPD2_HostOp::REFRESH_SLOW;
+    refresh_(kind, 0, 0, WIDTH, HEIGHT);
+  }
+  void refresh(int16_t x, int16_t y, int16_t w, int16_t h) { refresh_(GxEPD2_HostOp::REFRESH_PARTIAL, x, y, w, h); }
+  void powerOff()  { log_(GxEPD2_HostOp::POWER_OFF); }
+  void hibernate() { log_(GxEPD2_HostOp::HIBERNATE); }
+
+  // ===================== host side =====================
+  std::shared_ptr<Host> host;
+
+  std::vector<GxEPD2_HostOp> ops() const {
+    std::lock_guard<std::mutex> l(host->lock);
+    return host->log;
+  }
+  void clearOps() {
+    std::lock_guard<std::mutex> l(host->lock);
+    host->log.clear();
+    host->bytesWritten  = 0;
+    host->busyCallbacks = 0;
+  }
+  size_t count(GxEPD2_HostOp::Kind kind) const {
+    std::lock_guard<std::mutex> l(host->lock);
+    size_t n = 0;
+    for (const GxEPD2_HostOp& op : host->log) n += op.kind == kind;
+    return n;
+  }
+  std::vector<uint8_t> screen() const {
+    std::lock_guard<std::mutex> l(host->lock);
+    return host->screen;
+  }
+  std::vector<uint8_t> previous() const {
+    std::lock_guard<std::mutex> l(host->lock);
+    return host->previous;
+  }
+  // Panel coordinates
+  bool black(int16_t x, int16_t y) const {
+    std::lock_guard<std::mutex> l(host->lock);
+    return !(host->screen[(size_t)y * (WIDTH / 8) + x / 8] & (0x80 >> (x & 7)));
+  }
+
+private:
+  void write_(std::vector<uint8_t>& ram, GxEPD2_HostOp::Kind kind, const uint8_t* buffer, int16_t stride,
+              int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy) {
+    {
+      std::lock_guard<std::mutex> l(host->lock);
+      for (int16_t j = 0; j < h; j++) {
+        for (int16_t i = 0; i < w; i++) {
+          const size_t src = (size_t)(y + j) * (stride / 8) + (x + i) / 8;
+          const bool   white = buffer[src] & (0x80 >> ((x + i) & 7));
+          setRam_(ram, dx + i, dy + j, white);
+        }
+      }
+      host->log.push_back({ kind, dx, dy, w, h });
+      host->bytesWritten += (uint32_t)((w + 7) / 8) * h;
+    }
+    transfer_((uint32_t)((w + 7) / 8) * h);
+  }
+  static void setRam_(std::vector<uint8_t>& ram, int16_t x, int16_t y, bool white) {
+    if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return;
+    uint8_t& b = ram[(size_t)y * (WIDTH / 8) + x / 8];
+    if (white) b |= 0x80 >> (x & 7);
+    else       b &= ~(0x80 >> (x & 7));
+  }
+  void log_(GxEPD2_HostOp::Kind kind, int16_t x = 0, int16_t y = 0, int16_t w = 0, int16_t h = 0) {
+    std::lock_guard<std::mutex> l(host->lock);
+    host->log.push_back({ kind, x, y, w, h });
+  }
+  void transfer_(uint32_t bytes) {
+    const float rate = host->bytesPerMicro;
+    if (rate > 0) std::this_thread::sleep_for(std::chrono::microseconds((uint32_t)(bytes / rate)));
+  }
+  void refresh_(GxEPD2_HostOp::Kind kind, int16_t x, int16_t y, int16_t w, int16_t h) {
+    uint32_t busy;
+    {
+      std::lock_guard<std::mutex> l(host->lock);
+      for (int16_t j = max<int16_t>(y, 0); j < min<int16_t>(y + h, HEIGHT); j++) {
+        for (int16_t i = max<int16_t>(x, 0); i < min<int16_t>(x + w, WIDTH); i++) {
+          const size_t at = (size_t)j * (WIDTH / 8) + i / 8;
+          const uint8_t mask = 0x80 >> (i & 7);
+          host->screen[at] = (host->screen[at] & ~mask) | (host->ram[at] & mask);
+        }
+      }
+      host->log.push_back({ kind, x, y, w, h });
+      busy = kind == GxEPD2_HostOp::REFRESH_SLOW ? host->busySlowMicros
+           : kind == GxEPD2_HostOp::REFRESH_FAST ? host->busyFastMicros : host->busyPartialMicros;
+    }
+    waitWhileBusy_(busy);
+  }
+  void waitWhileBusy_(uint32_t us) {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < until) {
+      if (busyCallback_) {
+        { std::lock_guard<std::mutex> l(host->lock); host->busyCallbacks++; }
+        busyCallback_(busyParameter_);
+      }
+      else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+  }
+
+  void      (*busyCallback_)(const void*) = nullptr;
+  const void* busyParameter_              = nullptr;
+};
+
+template <typename GxEPD2_Type, const uint16_t page_height>
+class GxEPD2_BW : public Adafruit_GFX {
+public:
+  GxEPD2_Type epd2;
+
+  GxEPD2_BW(GxEPD2_Type epd2_instance) : Adafruit_GFX(GxEPD2_Type::WIDTH, GxEPD2_Type::HEIGHT), epd2(epd2_instance) {
+    hostSetPageHeight(page_height);
+    setFullWindow();
+    fillScreen(GxEPD_WHITE);
+  }
+
+  void init(uint32_t = 0, bool = true, uint16_t = 10, bool = false) {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || x >= width() || y < 0 || y >= height()) return;
+    switch (getRotation()) {
+      case 1: std::swap(x, y); x = WIDTH - x - 1; break;
+      case 2: x = WIDTH - x - 1; y = HEIGHT - y - 1; break;
+      case 3: std::swap(x, y); y = HEIGHT - y - 1; break;
+    }
+    if (partial_) {
+      if (x < pwX_ || x >= pwX_ + pwW_ || y < pwY_ || y >= pwY_ + pwH_) return;
+      x -= pwX_;
+      y -= pwY_;
+    }
+    y -= page_ * pageHeight_;
+    if (y < 0 || y >= pageHeight_) return;
+    uint8_t& b = buffer_[(size_t)x / 8 + (size_t)y * (pwW_ / 8)];
+    if (color) b |= 0x80 >> (x & 7);
+    else       b &= ~(0x80 >> (x & 7));
+  }
+  void fillScreen(uint16_t color) override {
+    memset(buffer_, color == GxEPD_BLACK ? 0x00 : 0xFF, sizeof(buffer_));
+  }
+
+  void setFullWindow() {
+    partial_ = false;
+    pwX_ = pwY_ = 0;
+    pwW_ = WIDTH;
+    pwH_ = HEIGHT;
+  }
+  void setPartialWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+    rotate_(x, y, w, h);
+    partial_ = true;
+    pwX_ = min<int16_t>(x, WIDTH);
+    pwY_ = min<int16_t>(y, HEIGHT);
+    pwW_ = min<int16_t>(w, WIDTH - pwX_);
+    pwH_ = min<int16_t>(h, HEIGHT - pwY_);
+    pwW_ += pwX_ % 8;
+    if (pwW_ % 8) pwW_ += 8 - pwW_ % 8;
+    pwX_ -= pwX_ % 8;
+  }
+
+  void display(bool partial_update_mode = false) {
+    const int16_t rows = min<int16_t>(HEIGHT, pageHeight_);
+    epd2.writeImagePart(buffer_, WIDTH, 0, 0, WIDTH, rows, 0, 0);
+    epd2.refresh(partial_update_mode);
+    if (GxEPD2_Type::hasFastPartialUpdate) epd2.writeImagePartAgain(buffer_, WIDTH, 0, 0, WIDTH, rows, 0, 0);
+    if (!partial_update_mode) epd2.powerOff();
+  }
+  void displayWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+    x = min<int16_t>(x, width());
+    y = min<int16_t>(y, height());
+    w = min<int16_t>(w, width() - x);
+    h = min<int16_t>(h, height() - y);
+    rotate_(x, y, w, h);
+    // Only rows the buffer holds, paged buffers aren't meant for this
+    const int16_t rows = max<int16_t>(0, min<int16_t>(h, pageHeight_ - y));
+    epd2.writeImagePart(buffer_, WIDTH, x, y, w, rows, x, y);
+    epd2.refresh(x, y, w, h);
+    if (GxEPD2_Type::hasFastPartialUpdate) epd2.writeImagePartAgain(buffer_, WIDTH, x, y, w, rows, x, y);
+  }
+
+  void firstPage() {
+    fillScreen(GxEPD_WHITE);
+    page_        = 0;
+    secondPhase_ = false;
+  }
+  bool nextPage() {
+    if (pages_ == 1) {
+      if (partial_) {
+        epd2.writeImagePart(buffer_, pwW_, 0, 0, pwW_, pwH_, pwX_, pwY_);
+        epd2.refresh(pwX_, pwY_, pwW_, pwH_);
+        if (GxEPD2_Type::hasFastPartialUpdate) epd2.writeImagePartAgain(buffer_, pwW_, 0, 0, pwW_, pwH_, pwX_, pwY_);
+      }
+      else {
+        display(false);
+      }
+      return false;
+    }
+    const int16_t pageY = page_ * pageHeight_;
+    if (partial_) {
+      const int16_t pageEnd = page_ < pages_ - 1 ? pageY + pageHeight_ : HEIGHT;
+      const int16_t dy0 = pwY_ + pageY;
+      const int16_t dy1 = min<int16_t>(pwY_ + pwH_, pwY_ + pageEnd);
+      if (dy1 > dy0) {
+        if (!secondPhase_) epd2.writeImagePart(buffer_, pwW_, 0, 0, pwW_, dy1 - dy0, pwX_, dy0);
+        else               epd2.writeImagePartAgain(buffer_, pwW_, 0, 0, pwW_, dy1 - dy0, pwX_, dy0);
+      }
+      else {
+        page_ = pages_ - 1;
+      }
+      if (++page_ == pages_) {
+        page_ = 0;
+        if (!secondPhase_) {
+          epd2.refresh(pwX_, pwY_, pwW_, pwH_);
+          if (GxEPD2_Type::hasFastPartialUpdate) {
+            // Same content again into the controller's previous-frame RAM
+            secondPhase_ = true;
+            fillScreen(GxEPD_WHITE);
+            return true;
+          }
+        }
+        return false;
+      }
+    }
+    else {
+      const int16_t rows = min<int16_t>(pageHeight_, HEIGHT - pageY);
+      if (!secondPhase_) epd2.writeImagePart(buffer_, WIDTH, 0, 0, WIDTH, rows, 0, pageY);
+      else               epd2.writeImagePartAgain(buffer_, WIDTH, 0, 0, WIDTH, rows, 0, pageY);
+      if (++page_ == pages_) {
+        page_ = 0;
+        if (GxEPD2_Type::hasFastPartialUpdate && !secondPhase_) {
+          epd2.refresh(false);
+          secondPhase_ = true;
+          fillScreen(GxEPD_WHITE);
+          return true;
+        }
+        if (!GxEPD2_Type::hasFastPartialUpdate) epd2.refresh(false);
+        epd2.powerOff();
+        return false;
+      }
+    }
+    fillScreen(GxEPD_WHITE);
+    return true;
+  }
+
+  void powerOff()  { epd2.powerOff(); }
+  void hibernate() { epd2.hibernate(); }
+
+  uint16_t pageHeight() const { return pageHeight_; }
+  uint16_t pages()      const { return pages_; }
+
+  // ===================== host side =====================
+  void hostSetPageHeight(uint16_t rows) {
+    pageHeight_ = max<uint16_t>(1, min<uint16_t>(rows, page_height));
+    pages_      = (HEIGHT + pageHeight_ - 1) / pageHeight_;
+    page_       = 0;
+  }
+  // Frame buffer a build with this page height would allocate
+  size_t bufferBytes() const { return (size_t)WIDTH / 8 * pageHeight_; }
+
+private:
+  // Screen rect to panel rect
+  void rotate_(int16_t& x, int16_t& y, int16_t& w, int16_t& h) {
+    switch (getRotation()) {
+      case 1: std::swap(x, y); std::swap(w, h); x = WIDTH - x - w; break;
+      case 2: x = WIDTH - x - w; y = HEIGHT - y - h; break;
+      case 3: std::swap(x, y); std::swap(w, h); y = HEIGHT - y - h; break;
+    }
+  }
+
+  uint8_t  buffer_[GxEPD2_Type::WIDTH / 8 * page_height];
+  uint16_t pageHeight_  = page_height;
+  uint16_t pages_       = 1;
+  int16_t  page_        = 0;
+  bool     secondPhase_ = false;
+  bool     partial_     = false;
+  int16_t  pwX_ = 0, pwY_ = 0, pwW_ = GxEPD2_Type::WIDTH, pwH_ = GxEPD2_Type::HEIGHT;
+};
@@ -0,0 +1,79 @@
+#pragma once
+// ===================== HOST PREFERENCES =====================
+// NVS as an in-memory map of namespaces, shared by every Preferences
+// object like the real partition. hostReset() wipes it between tests.
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+class Preferences {
+public:
+  using Blob = std::vector<uint8_t>;
+
+  bool begin(const char* name, bool readOnly = false) {
+    ns_       = name;
+    readOnly_ = readOnly;
+    open_     = true;
+    return true;
+  }
+  void end()                                                   { open_ = false; }
+
+  bool   isKey(const char* key)                                { return open_ && space_().count(key); }
+  bool   remove(const char* key)                               { return writable_() && space_().erase(key) > 0; }
+  bool   clear()                                               { if (!writable_()) return false; space_().clear(); return true; }
+
+  size_t putBytes(const char* key, const void* value, size_t len) {
+    if (!writable_()) return 0;
+    const uint8_t* p = static_cast<const uint8_t*>(value);
+    space_()[key] = Blob(p, p + len);
+    return len;
+  }
+  size_t getBytesLength(const char* key) {
+    const Blob* b = find_(key);
+    return b ? b->size() : 0;
+  }
+  size_t getBytes(const char* key, void* buf, size_t maxLen) {
+    const Blob* b = find_(key);
+    if (!b || b->size() > maxLen) return 0;
+    memcpy(buf, b->data(), b->size());
+    return b->size();
+  }
+
+  size_t   putUChar(const char* key, uint8_t value)            { return putBytes(key, &value, sizeof(value)); }
+  uint8_t  getUChar(const char* key, uint8_t fallback = 0)     { return get_(key, fallback); }
+  size_t   putBool(const char* key, bool value)                { return putUChar(key, value); }
+  bool     getBool(const char* key, bool fallback = false)     { return getUChar(key, fallback); }
+  size_t   putInt(const char* key, int32_t value)              { return putBytes(key, &value, sizeof(value)); }
+  int32_t  getInt(const char* key, int32_t fallback = 0)       { return get_(key, fallback); }
+  size_t   putUInt(const char* key, uint32_t value)            { return putBytes(key, &value, sizeof(value)); }
+  uint32_t getUInt(const char* key, uint32_t fallback = 0)     { return get_(key, fallback); }
+
+  static void hostReset()                                      { store_().clear(); }
+
+private:
+  using Space = std::map<std::string, Blob>;
+
+  static std::map<std::string, Space>& store_() {
+    static std::map<std::string, Space> store;
+    return store;
+  }
+  Space&      space_()                                         { return store_()[ns_]; }
+  bool        writable_() const                                { return open_ && !readOnly_; }
+  const Blob* find_(const char* key) {
+    if (!open_) return nullptr;
+    auto it = space_().find(key);
+    return it == space_().end() ? nullptr : &it->second;
+  }
+  template <typename T>
+  T get_(const char* key, T fallback) {
+    const Blob* b = find_(key);
+    if (!b || b->size() != sizeof(T)) return fallback;
+    T value;
+    memcpy(&value, b->data(), sizeof(T));
+    return value;
+  }
+
+  std::string ns_;
+  bool        readOnly_ = false;
+  bool        open_     = false;
+};
@@ -0,0 +1,19 @@
+#pragma once
+// ===================== HOST HEAP CAPS =====================
+// One heap on the host; hostPsram (Arduino.h) decides whether SPIRAM
+// requests succeed.
+#include <Arduino.h>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+  if ((caps & MALLOC_CAP_SPIRAM) && !psramFound()) return nullptr;
+  return malloc(size);
+}
+inline void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+  if ((caps & MALLOC_CAP_SPIRAM) && !psramFound()) return nullptr;
+  return realloc(ptr, size);
+}
+inline void heap_caps_free(void* ptr) { free(ptr); }
@@ -0,0 +1,56 @@
+#pragma once
+// ===================== HOST FREERTOS =====================
+// The FreeRTOS calls the libraries make, on std::thread. Tasks are detached
+// threads with a notification counter, semaphores and queues are a mutex
+// plus a condition variable. Priorities and cores are ignored, so a test
+// can't rely on the worker preempting the caller, only on blocking calls.
+//
+// One tick is a millisecond of real time by default. Tests with many
+// refresh passes shorten it through hostTickMicros.
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+
+#define pdFALSE            0
+#define pdTRUE             1
+#define pdPASS             pdTRUE
+#define pdFAIL             pdFALSE
+#define portMAX_DELAY      ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+
+inline std::atomic<uint32_t> hostTickMicros{1000};
+
+namespace hostrtos {
+// Waits on cv until ready() holds, at most ticks (portMAX_DELAY: forever)
+template <typename Pred>
+bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Pred ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::microseconds((uint64_t)ticks * hostTickMicros), ready);
+}
+}  // namespace hostrtos
+
+// ===================== CRITICAL SECTIONS =====================
+// A recursive lock stands in for the spinlock, it only has to exclude
+struct portMUX_TYPE {
+  std::recursive_mutex lock;
+};
+#define portMUX_INITIALIZER_UNLOCKED portMUX_TYPE{}
+#define taskENTER_CRITICAL(mux)      (mux)->lock.lock()
+#define taskEXIT_CRITICAL(mux)       (mux)->lock.unlock()
+#define portENTER_CRITICAL(mux)      taskENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)       taskEXIT_CRITICAL(mux)
@@ -0,0 +1,49 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+
+// ===================== QUEUES =====================
+// Items are copied in and out by value, like FreeRTOS
+struct HostQueue {
+  std::mutex                        lock;
+  std::condition_variable           cv;
+  std::deque<std::vector<uint8_t>>  items;
+  UBaseType_t                       depth    = 0;
+  UBaseType_t                       itemSize = 0;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t depth, UBaseType_t itemSize) {
+  QueueHandle_t q = new HostQueue();
+  q->depth    = depth;
+  q->itemSize = itemSize;
+  return q;
+}
+inline void vQueueDelete(QueueHandle_t q) { delete q; }
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+  {
+    std::unique_lock<std::mutex> l(q->lock);
+    if (!hostrtos::waitFor(q->cv, l, ticks, [q] { return q->items.size() < q->depth; })) return pdFALSE;
+    const uint8_t* p = static_cast<const uint8_t*>(item);
+    q->items.emplace_back(p, p + q->itemSize);
+  }
+  q->cv.notify_all();
+  return pdTRUE;
+}
+#define xQueueSendToBack xQueueSend
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks) {
+  {
+    std::unique_lock<std::mutex> l(q->lock);
+    if (!hostrtos::waitFor(q->cv, l, ticks, [q] { return !q->items.empty(); })) return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+  }
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> l(q->lock);
+  return (UBaseType_t)q->items.size();
+}
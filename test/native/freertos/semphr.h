@@ -0,0 +1,48 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <new>
+
+// ===================== SEMAPHORES =====================
+// Counting semaphore; a mutex is one that starts full. Unlike FreeRTOS a
+// mutex has no owner or priority inheritance.
+struct HostSemaphore {
+  std::mutex              lock;
+  std::condition_variable cv;
+  UBaseType_t             count = 0;
+  UBaseType_t             max   = 1;
+};
+typedef HostSemaphore* SemaphoreHandle_t;
+
+struct StaticSemaphore_t {
+  alignas(HostSemaphore) unsigned char storage[sizeof(HostSemaphore)];
+};
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+  SemaphoreHandle_t s = new HostSemaphore();
+  s->max   = max;
+  s->count = initial;
+  return s;
+}
+inline SemaphoreHandle_t xSemaphoreCreateBinary()                          { return xSemaphoreCreateCounting(1, 0); }
+inline SemaphoreHandle_t xSemaphoreCreateMutex()                           { return xSemaphoreCreateCounting(1, 1); }
+inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer) {
+  return new (buffer->storage) HostSemaphore();
+}
+inline void vSemaphoreDelete(SemaphoreHandle_t s)                          { delete s; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  std::unique_lock<std::mutex> l(s->lock);
+  if (!hostrtos::waitFor(s->cv, l, ticks, [s] { return s->count > 0; })) return pdFALSE;
+  s->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  {
+    std::lock_guard<std::mutex> l(s->lock);
+    if (s->count >= s->max) return pdFALSE;
+    s->count++;
+  }
+  s->cv.notify_one();
+  return pdTRUE;
+}
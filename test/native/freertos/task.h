@@ -0,0 +1,88 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+
+// ===================== TASKS =====================
+// A task is a detached thread. vTaskDelete(NULL) unwinds the task function
+// back to the thread entry; deleting another task is not supported.
+struct HostTask {
+  std::mutex              lock;
+  std::condition_variable cv;
+  uint32_t                notified = 0;
+  const char*             name     = "";
+};
+typedef HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+namespace hostrtos {
+struct TaskExit {};
+
+inline TaskHandle_t& currentTask() {
+  thread_local TaskHandle_t task = nullptr;
+  return task;
+}
+// Threads the shim didn't start (the test's main thread) get a task lazily,
+// so they can take notifications too
+inline TaskHandle_t selfTask() {
+  TaskHandle_t& task = currentTask();
+  if (!task) task = new HostTask();
+  return task;
+}
+}  // namespace hostrtos
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* parameter,
+                                          UBaseType_t priority, TaskHandle_t* created, BaseType_t coreId) {
+  (void)stackDepth;
+  (void)priority;
+  (void)coreId;
+  // Never freed: a detached thread may still be waiting on it at exit
+  TaskHandle_t task = new HostTask();
+  task->name = name;
+  // The handle is out before the task runs, as the task may compare it
+  if (created) *created = task;
+  std::thread([fn, parameter, task] {
+    hostrtos::currentTask() = task;
+    try {
+      fn(parameter);
+    } catch (const hostrtos::TaskExit&) {
+    }
+  }).detach();
+  return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* parameter,
+                              UBaseType_t priority, TaskHandle_t* created) {
+  return xTaskCreatePinnedToCore(fn, name, stackDepth, parameter, priority, created, 0);
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+  if (!task || task == hostrtos::currentTask()) throw hostrtos::TaskExit();
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)ticks * hostTickMicros));
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostrtos::selfTask(); }
+inline TickType_t   xTaskGetTickCount() {
+  static const auto start = std::chrono::steady_clock::now();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  return (TickType_t)(elapsed.count() / hostTickMicros);
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> l(task->lock);
+    task->notified++;
+  }
+  task->cv.notify_all();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  TaskHandle_t task = hostrtos::selfTask();
+  std::unique_lock<std::mutex> l(task->lock);
+  if (!hostrtos::waitFor(task->cv, l, ticks, [task] { return task->notified > 0; })) return 0;
+  const uint32_t value = task->notified;
+  task->notified = clearOnExit ? 0 : value - 1;
+  return value;
+}
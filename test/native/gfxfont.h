@@ -0,0 +1,21 @@
+#pragma once
+// ===================== HOST GFX FONT =====================
+// The Adafruit GFX font structs, same layout as the library's gfxfont.h
+#include <stdint.h>
+
+typedef struct {
+  uint16_t bitmapOffset; // offset into GFXfont->bitmap
+  uint8_t  width;        // bitmap size in pixels
+  uint8_t  height;
+  uint8_t  xAdvance;     // distance to advance the cursor
+  int8_t   xOffset;      // from the cursor to the upper left corner
+  int8_t   yOffset;
+} GFXglyph;
+
+typedef struct {
+  uint8_t*  bitmap;      // glyph bitmaps, concatenated
+  GFXglyph* glyph;       // glyph array
+  uint16_t  first;       // ASCII extents
+  uint16_t  last;
+  uint8_t   yAdvance;    // newline distance
+} GFXfont;
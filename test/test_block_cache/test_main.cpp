@@ -0,0 +1,309 @@
+// Host tests for BlockCache (lib/pocketmage_sd/src/pocketmage_blockcache.cpp)
+// on a RAM fs::FS: hits, LRU eviction, sequential read-ahead and how far it
+// goes per cache size, two paths with the same FNV-1a hash, and
+// invalidation. The benchmark replays a trace of the reads an app session
+// makes and prints card traffic with and without the cache.
+// Run with: pio test -e native -f test_block_cache [-v]
+#include <unity.h>
+#include <FS.h>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <config.h>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_sd/src/pocketmage_blockcache.cpp>
+#include <lib/pocketmage_sd/src/pocketmage_handlecache.cpp>
+
+static fs::FS sd;
+
+static constexpr size_t blockSize = 512;
+
+// ===================== helpers =====================
+static std::string fileBytes(size_t length, uint8_t seed) {
+  std::string data(length, '\0');
+  for (size_t i = 0; i < length; i++) data[i] = (char)(i * 31 + seed + (i >> 9));
+  return data;
+}
+
+static std::string read(BlockCache& cache, const char* path, size_t offset, size_t len) {
+  std::string out(len, '\0');
+  out.resize(cache.read(sd, path, offset, (uint8_t*)&out[0], len));
+  return out;
+}
+
+// Two paths with the same FNV-1a hash, found by a birthday search
+static std::pair<std::string, std::string> collidingPaths() {
+  std::unordered_map<uint32_t, std::string> seen;
+  for (uint32_t i = 0;; i++) {
+    const std::string path = "/assets/" + std::to_string(i) + ".bin";
+    uint32_t h = 2166136261u;
+    for (char c : path) h = (h ^ (uint8_t)c) * 16777619u;
+    auto it = seen.emplace(h, path);
+    if (!it.second) return { it.first->second, path };
+  }
+}
+
+void setUp() {
+  sd.clear();
+  sd.mkdir("/assets");
+  hostPsram = true;
+}
+
+void tearDown() {}
+
+// ===================== tests =====================
+void test_repeated_reads_hit() {
+  const std::string data = fileBytes(3000, 1);
+  sd.put("/assets/a.bin", data);
+  BlockCache cache;
+  TEST_ASSERT_TRUE(cache.begin(4, blockSize));
+  TEST_ASSERT_EQUAL(4, cache.blockCount());
+
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 100, 700) == data.substr(100, 700));
+  TEST_ASSERT_EQUAL_UINT32(2, cache.stats().misses);
+  sd.resetStats();
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 600, 300) == data.substr(600, 300));
+  TEST_ASSERT_EQUAL_UINT32(1, cache.stats().hits);
+  TEST_ASSERT_EQUAL_UINT32(0, sd.stats().opens);
+
+  // Short at the end of the file, nothing past it
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 2900, 500) == data.substr(2900));
+  TEST_ASSERT_EQUAL(0, read(cache, "/assets/a.bin", 3000, 10).size());
+  TEST_ASSERT_EQUAL(0, read(cache, "/assets/none.bin", 0, 10).size());
+  TEST_ASSERT_EQUAL_UINT32(700 + 300 + 100, (uint32_t)cache.stats().bytesRead);
+}
+
+void test_least_recently_used_block_goes_first() {
+  sd.put("/assets/a.bin", fileBytes(8 * blockSize, 2));
+  BlockCache cache;
+  cache.begin(4, blockSize);
+  // Blocks 0, 2, 4, 6 fill the cache, not in sequence so nothing reads ahead
+  for (size_t index : { 0, 2, 4, 6 }) read(cache, "/assets/a.bin", index * blockSize, 1);
+  read(cache, "/assets/a.bin", 0, 1);                  // 0 is fresh again
+  read(cache, "/assets/a.bin", 7 * blockSize + 1, 1);  // evicts 2
+
+  cache.resetStats();
+  read(cache, "/assets/a.bin", 0, 1);
+  read(cache, "/assets/a.bin", 6 * blockSize + 3, 1);
+  TEST_ASSERT_EQUAL_UINT32(2, cache.stats().hits);
+  read(cache, "/assets/a.bin", 2 * blockSize + 5, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, cache.stats().misses);
+}
+
+void test_sequential_reads_fetch_ahead() {
+  const std::string data = fileBytes(40 * blockSize + 100, 3);
+  sd.put("/assets/note.txt", data);
+  BlockCache cache;
+  cache.begin(8, blockSize);
+
+  std::string got;
+  const size_t chunk = 200;
+  for (size_t offset = 0; offset < data.size(); offset += chunk) got += read(cache, "/assets/note.txt", offset, chunk);
+  TEST_ASSERT_TRUE(got == data);
+
+  const BlockCache::Stats& stats = cache.stats();
+  // Only the first blocks are read on demand, the rest were already there
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, stats.misses);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(38, stats.readAhead);
+  TEST_ASSERT_EQUAL_UINT32(data.size(), (uint32_t)stats.cardBytes);
+  TEST_ASSERT_TRUE(stats.hitRatio() > 0.95f);
+
+  // A jump breaks the streak: no read-ahead for a lone random read
+  cache.clear();
+  cache.resetStats();
+  read(cache, "/assets/note.txt", 10 * blockSize, 10);
+  read(cache, "/assets/note.txt", 30 * blockSize, 10);
+  TEST_ASSERT_EQUAL_UINT32(0, cache.stats().readAhead);
+}
+
+void test_read_ahead_scales_with_the_cache() {
+  const std::string data = fileBytes(12 * blockSize, 4);
+  sd.put("/assets/note.txt", data);
+  for (size_t blocks : { 4, 8, 16, 64 }) {
+    BlockCache cache;
+    cache.begin(blocks, blockSize);
+    TEST_ASSERT_EQUAL(blocks < 8 ? 0 : blocks < 16 ? 1 : 2, cache.readAhead());
+
+    // A small cache reads only what is asked for, even for a sequential reader
+    for (size_t offset = 0; offset < data.size(); offset += 200) read(cache, "/assets/note.txt", offset, 200);
+    if (blocks < 8) TEST_ASSERT_EQUAL_UINT32(0, cache.stats().readAhead);
+    else            TEST_ASSERT_GREATER_THAN_UINT32(0, cache.stats().readAhead);
+    TEST_ASSERT_EQUAL_UINT32(data.size(), (uint32_t)cache.stats().cardBytes);
+  }
+}
+
+void test_paths_sharing_a_hash_keep_their_own_bytes() {
+  const std::pair<std::string, std::string> paths = collidingPaths();
+  TEST_ASSERT_TRUE(paths.first != paths.second);
+  const std::string a = fileBytes(blockSize, 4), b = fileBytes(blockSize, 5);
+  sd.put(paths.first.c_str(), a);
+  sd.put(paths.second.c_str(), b);
+
+  BlockCache cache;
+  cache.begin(4, blockSize);
+  TEST_ASSERT_TRUE(read(cache, paths.first.c_str(), 0, blockSize) == a);
+  TEST_ASSERT_TRUE(read(cache, paths.second.c_str(), 0, blockSize) == b);
+  TEST_ASSERT_TRUE(read(cache, paths.first.c_str(), 0, blockSize) == a);
+  TEST_ASSERT_EQUAL_UINT32(2, cache.stats().misses);
+
+  // Invalidating one leaves the other cached
+  cache.invalidate(paths.second.c_str());
+  cache.resetStats();
+  read(cache, paths.first.c_str(), 0, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, cache.stats().hits);
+}
+
+void test_invalidate_drops_stale_blocks() {
+  sd.put("/assets/a.bin", "first version");
+  BlockCache cache;
+  cache.begin(4, blockSize);
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 0, 64) == "first version");
+
+  // Written behind the cache's back: still the old bytes until invalidated
+  sd.put("/assets/a.bin", "second one");
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 0, 64) == "first version");
+  cache.invalidate("/assets/a.bin");
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 0, 64) == "second one");
+
+  sd.put("/assets/a.bin", "third");
+  cache.clear();
+  TEST_ASSERT_TRUE(read(cache, "/assets/a.bin", 0, 64) == "third");
+}
+
+void test_uncached_reads_go_straight_to_the_card() {
+  const std::string data = fileBytes(2000, 6);
+  sd.put("/assets/a.bin", data);
+  const std::string longPath = "/assets/" + std::string(100, 'l') + ".bin";
+  sd.put(longPath.c_str(), data);
+
+  // No blocks at all
+  BlockCache none;
+  none.begin(0, blockSize);
+  TEST_ASSERT_EQUAL(0, none.blockCount());
+  TEST_ASSERT_TRUE(read(none, "/assets/a.bin", 10, 1000) == data.substr(10, 1000));
+  none.invalidate("/assets/a.bin");
+  none.clear();
+
+  // A path too long to key a block
+  BlockCache cache;
+  cache.begin(4, blockSize);
+  TEST_ASSERT_TRUE(read(cache, longPath.c_str(), 10, 1000) == data.substr(10, 1000));
+  TEST_ASSERT_EQUAL_UINT32(0, cache.stats().misses + cache.stats().hits);
+}
+
+void test_misses_borrow_cached_handles() {
+  sd.put("/assets/a.bin", fileBytes(8 * blockSize, 7));
+  HandleCache handles;
+  TEST_ASSERT_TRUE(handles.begin());
+  BlockCache cache;
+  cache.setHandles(&handles);
+  cache.begin(4, blockSize);
+
+  sd.resetStats();
+  for (size_t index : { 0, 3, 6, 1 }) read(cache, "/assets/a.bin", index * blockSize, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, sd.stats().opens);
+  TEST_ASSERT_EQUAL_UINT32(3, handles.hits());
+  handles.closeAll();
+  TEST_ASSERT_EQUAL(0, sd.openHandles("/assets/a.bin"));
+}
+
+// ===================== benchmark =====================
+// A session's reads: a 60 KB note paged through in 512 B screens (and
+// paged back now and then), tarot cards of 2-8 KB drawn at random with
+// some repeats, and a small icon sheet read between them
+struct TraceRead {
+  std::string path;
+  size_t      offset;
+  size_t      len;
+};
+
+static std::vector<TraceRead> sessionTrace() {
+  std::mt19937 rng(24);
+  std::vector<TraceRead> trace;
+  size_t noteOffset = 0;
+  for (int step = 0; step < 600; step++) {
+    const uint32_t r = rng() % 10;
+    if (r < 5) {
+      if (rng() % 8 == 0 && noteOffset >= 2048) noteOffset -= 2048;
+      trace.push_back({ "/notes/journal.txt", noteOffset, 512 });
+      noteOffset = (noteOffset + 512) % (60 * 1024);
+    }
+    else if (r < 8) {
+      const int card = rng() % 8 < 5 ? rng() % 6 : rng() % 22;
+      trace.push_back({ "/assets/tarot/" + std::to_string(card) + ".bin", 0, 2048 + (size_t)(card % 4) * 2048 });
+    }
+    else {
+      trace.push_back({ "/assets/icons.bin", (rng() % 16) * 128, 128 });
+    }
+  }
+  return trace;
+}
+
+void test_benchmark_session_trace() {
+  sd.mkdir("/notes");
+  sd.put("/notes/journal.txt", fileBytes(60 * 1024, 8));
+  sd.put("/assets/icons.bin", fileBytes(2048, 9));
+  for (int card = 0; card < 22; card++) {
+    sd.put(("/assets/tarot/" + std::to_string(card) + ".bin").c_str(), fileBytes(2048 + (card % 4) * 2048, card));
+  }
+  const std::vector<TraceRead> trace = sessionTrace();
+
+  TEST_MESSAGE("blocks x size    hit ratio  card reads  card KB  requested KB  host us");
+  uint32_t uncachedReads = 0;
+  for (size_t blocks : { (size_t)0, (size_t)4, (size_t)8, (size_t)SD_CACHE_BLOCKS, (size_t)64 }) {
+    HandleCache handles;
+    handles.begin();
+    BlockCache cache;
+    cache.setHandles(&handles);
+    cache.begin(blocks, SD_CACHE_BLOCK_SIZE);
+
+    sd.resetStats();
+    uint8_t buf[8 * 1024];
+    const unsigned long start = micros();
+    for (const TraceRead& r : trace) {
+      const size_t n = cache.read(sd, r.path.c_str(), r.offset, buf, r.len);
+      TEST_ASSERT_EQUAL(r.len, n);
+    }
+    const uint32_t us = micros() - start;
+    handles.closeAll();
+
+    uint64_t requested = 0;
+    for (const TraceRead& r : trace) requested += r.len;
+    const fs::FS::Stats card = sd.stats();
+    if (blocks == 0) uncachedReads = card.reads;
+    // Too small to read ahead: fewer card reads, and only the whole-block
+    // rounding of small reads on top of what was asked for
+    if (blocks == 4) {
+      TEST_ASSERT_EQUAL_UINT32(0, cache.stats().readAhead);
+      TEST_ASSERT_LESS_THAN_UINT32(uncachedReads, card.reads);
+      TEST_ASSERT_LESS_THAN_UINT32(requested * 11 / 10, (uint32_t)card.bytesRead);
+    }
+    if (blocks == SD_CACHE_BLOCKS) {
+      TEST_ASSERT_TRUE(cache.stats().hitRatio() > 0.6f);
+      TEST_ASSERT_LESS_THAN_UINT32(requested, (uint32_t)card.bytesRead);
+      TEST_ASSERT_LESS_THAN_UINT32(trace.size() * 2 / 3, card.reads);
+    }
+
+    char line[112];
+    snprintf(line, sizeof(line), "%6u x %4u  %9.2f  %10u  %7u  %12u  %7u", (unsigned)blocks,
+             (unsigned)SD_CACHE_BLOCK_SIZE, cache.stats().hitRatio(), (unsigned)card.reads,
+             (unsigned)(card.bytesRead / 1024), (unsigned)(requested / 1024), (unsigned)us);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_repeated_reads_hit);
+  RUN_TEST(test_least_recently_used_block_goes_first);
+  RUN_TEST(test_sequential_reads_fetch_ahead);
+  RUN_TEST(test_read_ahead_scales_with_the_cache);
+  RUN_TEST(test_paths_sharing_a_hash_keep_their_own_bytes);
+  RUN_TEST(test_invalidate_drops_stale_blocks);
+  RUN_TEST(test_uncached_reads_go_straight_to_the_card);
+  RUN_TEST(test_misses_borrow_cached_handles);
+  RUN_TEST(test_benchmark_session_trace);
+  return UNITY_END();
+}
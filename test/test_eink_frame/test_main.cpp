@@ -0,0 +1,289 @@
+// Host tests for the ghosting scheduler (GhostScheduler) with synthetic
+// update sequences, and for PocketmageEink's frame diff: items drawn the
+// same as last frame cost no panel time, changes go out as byte aligned
+// partial windows, and the scheduler only asks for a slow full refresh once
+// a region has actually been updated enough.
+// Run with: pio test -e native -f test_eink_frame
+#include <unity.h>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_eink/src/pocketmage_eink.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_ghost.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_displaylist.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_fontmetrics.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_textwrap.cpp>
+#include <lib/pocketmage_text/src/pocketmage_text.cpp>
+
+using Op = GxEPD2_HostOp;
+
+static DisplayT display(GxEPD2_310_GDEQ031T10(0, 0, 0, 0));
+
+static constexpr int16_t screenW    = 320;
+static constexpr int16_t screenH    = 240;
+static constexpr int32_t frameBytes = screenW * screenH / 8;
+
+// ===================== helpers =====================
+// A fresh driver each test; never freed, its refresh task holds it
+static PocketmageEink* newEink() {
+  PocketmageEink* eink = new PocketmageEink(display);
+  display.setFullWindow();
+  display.fillScreen(GxEPD_WHITE);
+  display.epd2.clearOps();
+  return eink;
+}
+
+// Pushes the frame and waits until the panel is done with it
+static void push(PocketmageEink& eink) {
+  TEST_ASSERT_TRUE(eink.refreshAsync(0));
+  const unsigned long start = millis();
+  while (eink.refreshState() != REFRESH_IDLE && millis() - start < 2000) delay(1);
+  TEST_ASSERT_EQUAL(REFRESH_IDLE, eink.refreshState());
+  TEST_ASSERT_TRUE(eink.beginFrame());
+}
+
+// 16x16 bitmap with `ink` black pixels, different content per seed
+static const uint8_t* glyph(uint8_t seed, uint16_t ink = 64) {
+  static uint8_t rows[4][32];
+  uint8_t* r = rows[seed & 3];
+  memset(r, 0, 32);
+  for (uint16_t i = 0; i < ink && i < 256; i++) {
+    const uint16_t bit = (i * 37 + seed * 11) & 255;
+    r[bit / 8] |= 0x80 >> (bit & 7);
+  }
+  return r;
+}
+
+static size_t fullRefreshes() {
+  return display.epd2.count(Op::REFRESH_SLOW) + display.epd2.count(Op::REFRESH_FAST);
+}
+
+void setUp() {
+  hostTickMicros = 10;
+  GxEPD2_310_GDEQ031T10::Host& host = *display.epd2.host;
+  host.busySlowMicros = host.busyFastMicros = host.busyPartialMicros = 0;
+  host.bytesPerMicro  = 0;
+  display.setRotation(3);
+}
+
+void tearDown() {
+  hostTickMicros = 1000;
+}
+
+// ===================== ghost scheduler =====================
+void test_ghost_unknown_updates_keep_the_old_cadence() {
+  GhostScheduler ghost;
+  ghost.begin(screenW, screenH);
+  ghost.setUpdatesBeforeFull(FULL_REFRESH_AFTER);
+  TEST_ASSERT_EQUAL(8, ghost.cols());
+  TEST_ASSERT_EQUAL(6, ghost.rows());
+
+  for (int i = 1; i < FULL_REFRESH_AFTER; i++) {
+    ghost.addUpdate(0, 0, screenW, screenH, GhostScheduler::unknownFlips);
+    TEST_ASSERT_FALSE(ghost.needsFull());
+  }
+  ghost.addUpdate(0, 0, screenW, screenH, GhostScheduler::unknownFlips);
+  TEST_ASSERT_TRUE(ghost.needsFull());
+
+  ghost.fullDone();
+  TEST_ASSERT_FALSE(ghost.needsFull());
+  TEST_ASSERT_EQUAL_UINT16(0, ghost.maxScore());
+}
+
+void test_ghost_static_screen_stays_fast() {
+  GhostScheduler ghost;
+  ghost.begin(screenW, screenH);
+  ghost.setUpdatesBeforeFull(FULL_REFRESH_AFTER);
+
+  // A clock ticking inside one tile, a few pixels flipped each time
+  int updates = 0;
+  while (!ghost.needsFull() && updates < 1000) {
+    ghost.beginUpdate();
+    ghost.addInk(44, 44, 16, 16, 20, true);
+    ghost.addInk(44, 44, 16, 16, 20);
+    ghost.endUpdate();
+    updates++;
+  }
+  TEST_ASSERT_GREATER_THAN(2 * FULL_REFRESH_AFTER, updates);
+  // Only that tile ever built up
+  TEST_ASSERT_EQUAL_UINT16(ghost.maxScore(), ghost.tileScore(1, 1));
+  TEST_ASSERT_EQUAL_UINT16(0, ghost.tileScore(0, 0));
+  TEST_ASSERT_EQUAL_UINT16(0, ghost.tileScore(7, 5));
+}
+
+void test_ghost_flipping_a_whole_tile_costs_most() {
+  GhostScheduler white, black, same;
+  for (GhostScheduler* g : { &white, &black, &same }) g->begin(screenW, screenH);
+  const int32_t tile = GhostScheduler::tileSize * GhostScheduler::tileSize;
+
+  // Nothing flipped: only the fixed cost
+  white.addUpdate(0, 0, 40, 40, 0);
+  TEST_ASSERT_EQUAL_UINT16(GhostScheduler::updateCost, white.tileScore(0, 0));
+  // Every pixel flipped
+  black.addUpdate(0, 0, 40, 40, tile);
+  TEST_ASSERT_EQUAL_UINT16(GhostScheduler::updateCost + GhostScheduler::flipCost, black.tileScore(0, 0));
+  // All black erased and all black drawn again flips nothing
+  same.beginUpdate();
+  same.addInk(0, 0, 40, 40, tile, true);
+  same.addInk(0, 0, 40, 40, tile);
+  same.endUpdate();
+  TEST_ASSERT_EQUAL_UINT16(GhostScheduler::updateCost, same.tileScore(0, 0));
+}
+
+void test_ghost_limit_scales_with_updates_before_full() {
+  GhostScheduler ghost;
+  ghost.begin(screenW, screenH);
+  ghost.setUpdatesBeforeFull(10);
+  for (int i = 0; i < 9; i++) ghost.addUpdate(0, 0, screenW, screenH, GhostScheduler::unknownFlips);
+  TEST_ASSERT_FALSE(ghost.needsFull());
+  ghost.addUpdate(0, 0, screenW, screenH, GhostScheduler::unknownFlips);
+  TEST_ASSERT_TRUE(ghost.needsFull());
+}
+
+// ===================== frame diff =====================
+void test_unchanged_frame_is_skipped() {
+  PocketmageEink* eink = newEink();
+  eink->clearRect(40, 40, 16, 16);
+  eink->blitBitmap(40, 40, glyph(0), 16, 16);
+  push(*eink);
+  TEST_ASSERT_EQUAL(1, fullRefreshes());
+
+  // Cleared and redrawn the same: nothing reaches the panel
+  display.epd2.clearOps();
+  const uint32_t saved = eink->bytesSaved();
+  eink->clearRect(40, 40, 16, 16);
+  eink->blitBitmap(40, 40, glyph(0), 16, 16);
+  TEST_ASSERT_TRUE(eink->refreshAsync(0));
+  TEST_ASSERT_EQUAL(REFRESH_IDLE, eink->refreshState());
+  TEST_ASSERT_EQUAL_UINT32(1, eink->skippedRefreshes());
+  TEST_ASSERT_EQUAL_UINT32(saved + frameBytes, eink->bytesSaved());
+  TEST_ASSERT_EQUAL(0, display.epd2.ops().size());
+}
+
+void test_small_change_goes_out_as_an_aligned_window() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(40, 40, glyph(0), 16, 16);
+  eink->blitBitmap(200, 100, glyph(1), 16, 16);
+  push(*eink);
+
+  display.epd2.clearOps();
+  eink->blitBitmap(40, 40, glyph(0), 16, 16);
+  eink->clearRect(200, 100, 16, 16);
+  eink->blitBitmap(200, 100, glyph(2), 16, 16);
+  push(*eink);
+
+  TEST_ASSERT_EQUAL(0, fullRefreshes());
+  TEST_ASSERT_EQUAL(1, display.epd2.count(Op::REFRESH_PARTIAL));
+  Op window = {};
+  for (const Op& op : display.epd2.ops()) if (op.kind == Op::REFRESH_PARTIAL) window = op;
+  // Screen (200, 100, 16, 16) is panel (100, 104, 16, 16) at rotation 3;
+  // the window is byte aligned along the panel x axis
+  TEST_ASSERT_EQUAL(0, window.x % 8);
+  TEST_ASSERT_EQUAL(0, window.w % 8);
+  TEST_ASSERT_LESS_OR_EQUAL(100, window.x);
+  TEST_ASSERT_GREATER_OR_EQUAL(116, window.x + window.w);
+  TEST_ASSERT_EQUAL(104, window.y);
+  TEST_ASSERT_EQUAL(16, window.h);
+  TEST_ASSERT_LESS_THAN_UINT32(frameBytes / 50, display.epd2.host->bytesWritten);
+  TEST_ASSERT_GREATER_THAN_UINT32(frameBytes - frameBytes / 50, eink->bytesSaved());
+
+  // The new glyph is on the screen, the rest of the panel untouched
+  DisplayT reference(GxEPD2_310_GDEQ031T10(0, 0, 0, 0));
+  reference.setRotation(3);
+  reference.fillScreen(GxEPD_WHITE);
+  PocketmageEink ref(reference);
+  ref.blitBitmap(40, 40, glyph(0), 16, 16);
+  ref.blitBitmap(200, 100, glyph(2), 16, 16);
+  reference.display(false);
+  TEST_ASSERT_TRUE(reference.epd2.screen() == display.epd2.screen());
+}
+
+void test_moved_item_refreshes_both_places() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(80, 80, glyph(0), 16, 16);
+  push(*eink);
+
+  display.epd2.clearOps();
+  eink->clearRect(80, 80, 16, 16);
+  eink->blitBitmap(96, 80, glyph(0), 16, 16);
+  push(*eink);
+  Op window = {};
+  for (const Op& op : display.epd2.ops()) if (op.kind == Op::REFRESH_PARTIAL) window = op;
+  // Screen x 80..112 is panel y 208..240
+  TEST_ASSERT_LESS_OR_EQUAL(208, window.y);
+  TEST_ASSERT_GREATER_OR_EQUAL(240, window.y + window.h);
+}
+
+void test_tracked_items_are_diffed_by_key() {
+  PocketmageEink* eink = newEink();
+  auto drawLabel = [&](const char* text) {
+    display.setFont(nullptr);
+    display.setTextColor(GxEPD_BLACK);
+    display.setCursor(10, 200);
+    display.print(text);
+    eink->trackItem(10, 200, 60, 8, PocketmageEink::hashBytes(text, strlen(text)));
+  };
+  drawLabel("12:00");
+  push(*eink);
+
+  display.epd2.clearOps();
+  eink->clearRect(10, 200, 60, 8);
+  drawLabel("12:00");
+  TEST_ASSERT_TRUE(eink->refreshAsync(0));
+  TEST_ASSERT_EQUAL_UINT32(1, eink->skippedRefreshes());
+
+  eink->clearRect(10, 200, 60, 8);
+  drawLabel("12:01");
+  push(*eink);
+  TEST_ASSERT_EQUAL_UINT32(1, eink->skippedRefreshes());
+  TEST_ASSERT_EQUAL(1, display.epd2.count(Op::REFRESH_PARTIAL));
+}
+
+void test_untracked_refreshes_go_slow_after_the_old_count() {
+  PocketmageEink* eink = newEink();
+  int firstSlow = 0;
+  for (int frame = 1; frame <= 2 * FULL_REFRESH_AFTER && !firstSlow; frame++) {
+    display.epd2.clearOps();
+    eink->markAllDirty();
+    push(*eink);
+    if (display.epd2.count(Op::REFRESH_SLOW)) firstSlow = frame;
+  }
+  TEST_ASSERT_EQUAL(FULL_REFRESH_AFTER + 1, firstSlow);
+}
+
+void test_small_updates_put_the_slow_refresh_off() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(0, 0, glyph(0), 16, 16);
+  push(*eink);
+
+  // A few pixels of a clock change every frame, the rest stays
+  int fast = 0;
+  for (int frame = 0; frame < 50; frame++) {
+    display.epd2.clearOps();
+    eink->clearRect(160, 120, 16, 16);
+    eink->blitBitmap(160, 120, glyph(frame & 1 ? 1 : 3, 6), 16, 16);
+    push(*eink);
+    if (display.epd2.count(Op::REFRESH_SLOW)) break;
+    fast++;
+  }
+  TEST_ASSERT_GREATER_THAN(2 * FULL_REFRESH_AFTER, fast);
+  TEST_ASSERT_EQUAL_UINT32(0, eink->skippedRefreshes());
+
+  char line[96];
+  snprintf(line, sizeof(line), "fast updates before a slow full: %d (fixed counter: %d)", fast, FULL_REFRESH_AFTER);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ghost_unknown_updates_keep_the_old_cadence);
+  RUN_TEST(test_ghost_static_screen_stays_fast);
+  RUN_TEST(test_ghost_flipping_a_whole_tile_costs_most);
+  RUN_TEST(test_ghost_limit_scales_with_updates_before_full);
+  RUN_TEST(test_unchanged_frame_is_skipped);
+  RUN_TEST(test_small_change_goes_out_as_an_aligned_window);
+  RUN_TEST(test_moved_item_refreshes_both_places);
+  RUN_TEST(test_tracked_items_are_diffed_by_key);
+  RUN_TEST(test_untracked_refreshes_go_slow_after_the_old_count);
+  RUN_TEST(test_small_updates_put_the_slow_refresh_off);
+  return UNITY_END();
+}
@@ -0,0 +1,219 @@
+// Host tests and a benchmark for PocketmageEink::renderPaged() on the fake
+// panel: every band height must put the same pixels on the screen as a
+// whole-frame buffer, and call() boxes must only be replayed for the bands
+// they touch. The benchmark prints render time against frame buffer size
+// per band height.
+// Run with: pio test -e native -f test_eink_paged [-v]
+#include <unity.h>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_eink/src/pocketmage_eink.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_ghost.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_displaylist.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_fontmetrics.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_textwrap.cpp>
+#include <lib/pocketmage_text/src/pocketmage_text.cpp>
+
+using Op = GxEPD2_HostOp;
+
+static DisplayT display(GxEPD2_310_GDEQ031T10(0, 0, 0, 0));
+
+static const uint16_t bandHeights[] = { 320, 160, 80, 64, 40, 20, 8 };
+
+// ===================== helpers =====================
+struct Card {
+  PocketmageEink* eink;
+  int16_t         x, y;
+  uint32_t        calls;
+};
+
+static const uint8_t* cardRows() {
+  static uint8_t rows[64 / 8 * 96];
+  for (size_t i = 0; i < sizeof(rows); i++) rows[i] = (uint8_t)(i * 29 + (i >> 3));
+  return rows;
+}
+
+static const uint8_t* greyRows() {
+  static uint8_t rows[32 / 8 * 2 * 32];
+  for (size_t i = 0; i < sizeof(rows); i++) rows[i] = (uint8_t)(i * 53 + 7);
+  return rows;
+}
+
+// Stands in for a card streamed from SD, blitted from inside a call()
+static void drawCard(void* context) {
+  Card* card = static_cast<Card*>(context);
+  card->calls++;
+  card->eink->blitBitmap(card->x, card->y, cardRows(), 64, 96);
+}
+
+// A spread: frame, rules, text, a 1-bpp and a 2-bit bitmap, and a card call
+static void buildSpread(EinkDisplayList& list, Card& card) {
+  list.clear();
+  list.drawRect(4, 4, 312, 232, GxEPD_BLACK);
+  list.fillRect(10, 200, 300, 2, GxEPD_BLACK);
+  list.line(10, 10, 309, 190, GxEPD_BLACK);
+  list.text(20, 30, "The Tower", &FreeSans9pt7b, 1, GxEPD_BLACK);
+  list.text(20, 226, "reversed: upheaval", &FreeMonoBold9pt7b, 1, GxEPD_BLACK);
+  list.bitmap(220, 40, cardRows(), 64, 96, 1);
+  list.ditheredBitmap(150, 150, greyRows(), 32, 32);
+  list.call(card.x, card.y, 64, 96, drawCard, &card);
+  TEST_ASSERT_TRUE(list.ok());
+}
+
+struct Render {
+  std::vector<uint8_t> screen;
+  uint32_t             cardCalls;
+  uint32_t             micros;
+};
+
+static Render render(uint16_t bandHeight, int passes) {
+  display.hostSetPageHeight(bandHeight);
+  display.epd2.clearOps();
+  PocketmageEink eink(display);
+  Card card = { &eink, 120, 60, 0 };
+  EinkDisplayList list;
+  buildSpread(list, card);
+
+  const unsigned long start = micros();
+  eink.renderPaged(list, passes);
+  return { display.epd2.screen(), card.calls, (uint32_t)(micros() - start) };
+}
+
+// Bands a screen x range touches at rotation 3, where panel rows run
+// right to left across the screen
+static uint16_t bandsTouched(int16_t x, int16_t w, uint16_t bandHeight) {
+  const int16_t first = (GxEPD2_310_GDEQ031T10::HEIGHT - x - w) / bandHeight;
+  const int16_t last  = (GxEPD2_310_GDEQ031T10::HEIGHT - x - 1) / bandHeight;
+  return last - first + 1;
+}
+
+void setUp() {
+  hostTickMicros = 1;
+  GxEPD2_310_GDEQ031T10::Host& host = *display.epd2.host;
+  host.busySlowMicros = host.busyFastMicros = host.busyPartialMicros = 0;
+  host.bytesPerMicro  = 0;
+  display.setRotation(3);
+}
+
+void tearDown() {
+  hostTickMicros = 1000;
+  display.hostSetPageHeight(GxEPD2_310_GDEQ031T10::HEIGHT);
+}
+
+// ===================== tests =====================
+void test_every_band_height_matches_the_full_frame() {
+  for (int passes : { 0, 2 }) {
+    const Render full = render(GxEPD2_310_GDEQ031T10::HEIGHT, passes);
+    // The spread actually drew something
+    size_t black = 0;
+    for (uint8_t b : full.screen) black += 8 - __builtin_popcount(b);
+    TEST_ASSERT_GREATER_THAN(2000, black);
+
+    for (uint16_t band : bandHeights) {
+      const Render paged = render(band, passes);
+      char what[48];
+      snprintf(what, sizeof(what), "band %u, %d passes", band, passes);
+      TEST_ASSERT_EQUAL_MEMORY_MESSAGE(full.screen.data(), paged.screen.data(), full.screen.size(), what);
+    }
+  }
+}
+
+// A fast-partial panel writes each frame twice, the second time into the
+// RAM the next partial refresh is diffed against. Every band has to be
+// drawn again for that, or the panel diffs against a blank frame.
+void test_previous_frame_ram_matches_the_screen() {
+  for (uint16_t band : bandHeights) {
+    for (int passes : { 0, 2 }) {
+      const Render r = render(band, passes);
+      char what[48];
+      snprintf(what, sizeof(what), "band %u, %d passes", band, passes);
+      TEST_ASSERT_EQUAL_MEMORY_MESSAGE(r.screen.data(), display.epd2.previous().data(), r.screen.size(), what);
+    }
+  }
+}
+
+void test_grey_levels_are_dithered_in_one_pass() {
+  // 32x32 blocks of white, light grey, dark grey and black
+  static uint8_t rows[4][32 / 8 * 2 * 32];
+  for (uint8_t level = 0; level < 4; level++) {
+    for (int j = 0; j < 32; j++) {
+      memset(rows[level] + j * 8,     (level & 2) ? 0xFF : 0, 4);
+      memset(rows[level] + j * 8 + 4, (level & 1) ? 0xFF : 0, 4);
+    }
+  }
+  std::vector<uint8_t> screens[2];
+  for (int passes : { 0, 2 }) {
+    display.hostSetPageHeight(40);
+    PocketmageEink eink(display);
+    EinkDisplayList list;
+    for (uint8_t level = 0; level < 4; level++) list.ditheredBitmap(16 + 40 * level, 100, rows[level], 32, 32);
+    eink.renderPaged(list, passes);
+    screens[passes / 2] = display.epd2.screen();
+  }
+  // 0 + 1/4 + 3/4 + all of 1024 pixels, not light and dark grey as black
+  size_t black = 0;
+  for (uint8_t b : screens[0]) black += 8 - __builtin_popcount(b);
+  TEST_ASSERT_EQUAL_UINT32(256 + 768 + 1024, (uint32_t)black);
+  // Later passes only deepen the same pixels
+  TEST_ASSERT_EQUAL_MEMORY(screens[0].data(), screens[1].data(), screens[0].size());
+}
+
+void test_calls_replay_only_for_the_bands_they_touch() {
+  for (uint16_t band : bandHeights) {
+    const uint16_t pages = (GxEPD2_310_GDEQ031T10::HEIGHT + band - 1) / band;
+    // A fast-partial panel runs each paged loop twice
+    const uint32_t phases = pages > 1 ? 2 : 1;
+    for (int passes : { 0, 2 }) {
+      const Render r = render(band, passes);
+      TEST_ASSERT_EQUAL_UINT32(bandsTouched(120, 64, band) * phases * (passes + 1), r.cardCalls);
+    }
+  }
+}
+
+void test_paged_render_writes_every_row_once_per_pass() {
+  display.hostSetPageHeight(40);
+  display.epd2.clearOps();
+  PocketmageEink eink(display);
+  Card card = { &eink, 120, 60, 0 };
+  EinkDisplayList list;
+  buildSpread(list, card);
+  eink.renderPaged(list, 1);
+
+  uint32_t rows = 0;
+  for (const Op& op : display.epd2.ops()) if (op.kind == Op::WRITE) rows += op.h;
+  TEST_ASSERT_EQUAL_UINT32(2 * GxEPD2_310_GDEQ031T10::HEIGHT, rows);
+  TEST_ASSERT_EQUAL(1, display.epd2.count(Op::REFRESH_FAST) + display.epd2.count(Op::REFRESH_SLOW));
+  TEST_ASSERT_EQUAL(1, display.epd2.count(Op::REFRESH_PARTIAL));
+  TEST_ASSERT_EQUAL(Op::HIBERNATE, display.epd2.ops().back().kind);
+}
+
+// ===================== benchmark =====================
+void test_benchmark_band_height() {
+  const int passes = 2;
+  TEST_MESSAGE("band  pages  buffer B  saved B  card replays  render us (host, 3 passes)");
+  const size_t fullBuffer = GxEPD2_310_GDEQ031T10::WIDTH / 8 * GxEPD2_310_GDEQ031T10::HEIGHT;
+  for (uint16_t band : bandHeights) {
+    // Best of a few runs
+    Render best = render(band, passes);
+    for (int i = 0; i < 4; i++) {
+      const Render r = render(band, passes);
+      if (r.micros < best.micros) best = r;
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "%4u  %5u  %8u  %7u  %12u  %8u", band, display.pages(),
+             (unsigned)display.bufferBytes(), (unsigned)(fullBuffer - display.bufferBytes()),
+             (unsigned)best.cardCalls, (unsigned)best.micros);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_band_height_matches_the_full_frame);
+  RUN_TEST(test_previous_frame_ram_matches_the_screen);
+  RUN_TEST(test_grey_levels_are_dithered_in_one_pass);
+  RUN_TEST(test_calls_replay_only_for_the_bands_they_touch);
+  RUN_TEST(test_paged_render_writes_every_row_once_per_pass);
+  RUN_TEST(test_benchmark_band_height);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// Host tests for PocketmageEink's async refresh state machine, on the fake
+// GDEQ031T10 from test/native/GxEPD2_BW.h: the panel holds BUSY for a set
+// time per waveform and calls the busy callback meanwhile, so the worker
+// moves through the same states it does on the device.
+// Run with: pio test -e native -f test_eink_refresh
+#include <unity.h>
+#include <vector>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_eink/src/pocketmage_eink.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_ghost.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_displaylist.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_fontmetrics.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_textwrap.cpp>
+#include <lib/pocketmage_text/src/pocketmage_text.cpp>
+
+using Op = GxEPD2_HostOp;
+
+static DisplayT display(GxEPD2_310_GDEQ031T10(0, 0, 0, 0));
+
+// One tick is 100 us, so a 250 tick settle between passes takes 25 ms
+static constexpr uint32_t tickMicros   = 100;
+static constexpr uint32_t busySlow     = 40000;
+static constexpr uint32_t busyFast     = 20000;
+static constexpr uint32_t busyPartial  = 10000;
+
+// ===================== helpers =====================
+// A fresh driver each test; never freed, its refresh task holds it
+static PocketmageEink* newEink() {
+  PocketmageEink* eink = new PocketmageEink(display);
+  display.setFullWindow();
+  display.fillScreen(GxEPD_WHITE);
+  display.epd2.clearOps();
+  return eink;
+}
+
+static const uint8_t* checker() {
+  static uint8_t rows[32 * 4];
+  for (size_t i = 0; i < sizeof(rows); i++) rows[i] = (i / 4) & 1 ? 0xAA : 0x55;
+  return rows;
+}
+
+// Every state the refresh passes through, polled until it is idle again
+static std::vector<RefreshState> trace(PocketmageEink& eink, uint8_t* maxPass = nullptr) {
+  std::vector<RefreshState> seen;
+  const unsigned long start = millis();
+  while (millis() - start < 2000) {
+    const RefreshState state = eink.refreshState();
+    if (maxPass && eink.refreshPass() > *maxPass) *maxPass = eink.refreshPass();
+    if (seen.empty() || seen.back() != state) seen.push_back(state);
+    if (state == REFRESH_IDLE) break;
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  return seen;
+}
+
+static int firstIndex(const std::vector<RefreshState>& seen, RefreshState state) {
+  for (size_t i = 0; i < seen.size(); i++) if (seen[i] == state) return (int)i;
+  return -1;
+}
+
+static int indexOf(const std::vector<Op>& ops, Op::Kind kind, int from = 0) {
+  for (size_t i = from; i < ops.size(); i++) if (ops[i].kind == kind) return (int)i;
+  return -1;
+}
+
+static size_t refreshes(const GxEPD2_310_GDEQ031T10& panel) {
+  return panel.count(Op::REFRESH_SLOW) + panel.count(Op::REFRESH_FAST) + panel.count(Op::REFRESH_PARTIAL);
+}
+
+void setUp() {
+  hostTickMicros = tickMicros;
+  GxEPD2_310_GDEQ031T10::Host& host = *display.epd2.host;
+  host.busySlowMicros    = busySlow;
+  host.busyFastMicros    = busyFast;
+  host.busyPartialMicros = busyPartial;
+  host.bytesPerMicro     = 2.0f;
+  display.setRotation(3);
+}
+
+void tearDown() {
+  hostTickMicros = 1000;
+}
+
+// ===================== tests =====================
+void test_refresh_async_returns_before_the_panel_is_done() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(10, 10, checker(), 32, 32);
+
+  const unsigned long start = micros();
+  TEST_ASSERT_TRUE(eink->refreshAsync(0));
+  TEST_ASSERT_LESS_THAN_UINT32(busyFast, micros() - start);
+  TEST_ASSERT_NOT_EQUAL(REFRESH_IDLE, eink->refreshState());
+
+  TEST_ASSERT_TRUE(eink->beginFrame());
+  TEST_ASSERT_EQUAL(REFRESH_IDLE, eink->refreshState());
+  // The frame is kept for the next partial window: power off, no hibernate
+  const std::vector<Op> ops = display.epd2.ops();
+  TEST_ASSERT_EQUAL(1, refreshes(display.epd2));
+  TEST_ASSERT_EQUAL(Op::POWER_OFF, ops.back().kind);
+  TEST_ASSERT_EQUAL(-1, indexOf(ops, Op::HIBERNATE));
+  // Pixels reached the screen, rotation 3 puts screen (10, 10) at panel (10, 309)
+  TEST_ASSERT_TRUE(display.epd2.black(10, 309) || display.epd2.black(11, 309));
+}
+
+void test_states_run_transfer_busy_settle_idle() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(0, 0, checker(), 32, 32);
+  TEST_ASSERT_TRUE(eink->refreshAsync(1));
+
+  uint8_t maxPass = 0;
+  const std::vector<RefreshState> seen = trace(*eink, &maxPass);
+  const int transferring = firstIndex(seen, REFRESH_TRANSFERRING);
+  const int busy         = firstIndex(seen, REFRESH_WAITING_BUSY);
+  const int settling     = firstIndex(seen, REFRESH_SETTLING);
+  TEST_ASSERT_EQUAL(0, transferring);
+  TEST_ASSERT_GREATER_THAN(transferring, busy);
+  TEST_ASSERT_GREATER_THAN(busy, settling);
+  TEST_ASSERT_EQUAL(REFRESH_IDLE, seen.back());
+  TEST_ASSERT_EQUAL(1, maxPass);
+  TEST_ASSERT_EQUAL(0, eink->refreshPass());
+
+  // BUSY was waited out through the callback, not GxEPD2's delay(1) spin
+  TEST_ASSERT_GREATER_THAN_UINT32(0, display.epd2.host->busyCallbacks);
+  TEST_ASSERT_TRUE(eink->beginFrame());
+}
+
+void test_passes_follow_the_full_update_with_partials() {
+  PocketmageEink* eink = newEink();
+  // A whole-screen change takes a full update
+  eink->blitBitmap(0, 0, checker(), 32, 32);
+  eink->markAllDirty();
+  TEST_ASSERT_TRUE(eink->refreshAsync(2));
+  // Wait it out first, beginFrame() would cancel the partial passes
+  TEST_ASSERT_TRUE(trace(*eink).back() == REFRESH_IDLE);
+  TEST_ASSERT_TRUE(eink->beginFrame());
+
+  TEST_ASSERT_EQUAL(1, display.epd2.count(Op::REFRESH_SLOW) + display.epd2.count(Op::REFRESH_FAST));
+  TEST_ASSERT_EQUAL(2, display.epd2.count(Op::REFRESH_PARTIAL));
+  TEST_ASSERT_EQUAL(0, eink->coalescedRefreshes());
+}
+
+void test_begin_frame_cancels_the_remaining_passes() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(0, 0, checker(), 32, 32);
+  const unsigned long start = micros();
+  TEST_ASSERT_TRUE(eink->refreshAsync(3));
+
+  while (eink->refreshState() != REFRESH_WAITING_BUSY && micros() - start < 1000000) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  TEST_ASSERT_TRUE(eink->beginFrame());
+  // The pass in flight completes, the other three never start
+  TEST_ASSERT_EQUAL(1, eink->coalescedRefreshes());
+  TEST_ASSERT_EQUAL(1, refreshes(display.epd2));
+  TEST_ASSERT_LESS_THAN_UINT32(busyFast + 3 * (busyPartial + 250 * tickMicros), micros() - start);
+
+  // The next refresh runs all its passes again
+  eink->blitBitmap(100, 100, checker(), 32, 32);
+  display.epd2.clearOps();
+  TEST_ASSERT_TRUE(eink->refreshAsync(1));
+  TEST_ASSERT_TRUE(trace(*eink).back() == REFRESH_IDLE);
+  TEST_ASSERT_TRUE(eink->beginFrame());
+  TEST_ASSERT_EQUAL(2, refreshes(display.epd2));
+  TEST_ASSERT_EQUAL(1, eink->coalescedRefreshes());
+}
+
+void test_begin_frame_times_out_while_a_pass_is_in_flight() {
+  PocketmageEink* eink = newEink();
+  display.epd2.host->busyFastMicros = 100000;
+  eink->blitBitmap(0, 0, checker(), 32, 32);
+  TEST_ASSERT_TRUE(eink->refreshAsync(0));
+
+  TEST_ASSERT_FALSE(eink->beginFrame(1));
+  TEST_ASSERT_TRUE(eink->beginFrame());
+  TEST_ASSERT_EQUAL(1, refreshes(display.epd2));
+}
+
+void test_blocking_refresh_waits_for_the_async_one() {
+  PocketmageEink* eink = newEink();
+  eink->blitBitmap(0, 0, checker(), 32, 32);
+  TEST_ASSERT_TRUE(eink->refreshAsync(0));
+  // Takes the frame buffer only once the worker has let go of it
+  eink->multiPassRefresh(0);
+
+  const std::vector<Op> ops = display.epd2.ops();
+  const int asyncDone = indexOf(ops, Op::POWER_OFF);
+  int blocking = -1;
+  for (size_t i = asyncDone + 1; i < ops.size() && blocking < 0; i++) {
+    if (ops[i].kind == Op::REFRESH_SLOW || ops[i].kind == Op::REFRESH_FAST) blocking = (int)i;
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(0, asyncDone);
+  TEST_ASSERT_GREATER_THAN(asyncDone, blocking);
+  TEST_ASSERT_EQUAL(Op::HIBERNATE, ops.back().kind);
+  TEST_ASSERT_EQUAL(REFRESH_IDLE, eink->refreshState());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_refresh_async_returns_before_the_panel_is_done);
+  RUN_TEST(test_states_run_transfer_busy_settle_idle);
+  RUN_TEST(test_passes_follow_the_full_update_with_partials);
+  RUN_TEST(test_begin_frame_cancels_the_remaining_passes);
+  RUN_TEST(test_begin_frame_times_out_while_a_pass_is_in_flight);
+  RUN_TEST(test_blocking_refresh_waits_for_the_async_one);
+  return UNITY_END();
+}
@@ -0,0 +1,134 @@
+// Host tests for HandleCache (lib/pocketmage_sd/src/pocketmage_handlecache.cpp)
+// on a RAM fs::FS, which counts removes and renames of a file that still
+// has a handle open: hits and LRU reuse, invalidation, and a journal
+// compaction behind the SD worker's cached handles.
+// Run with: pio test -e native -f test_handle_cache
+#include <unity.h>
+#include <FS.h>
+#include <string>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_sd/src/pocketmage_handlecache.cpp>
+#include <lib/pocketmage_sd/src/pocketmage_blockcache.cpp>
+#include <lib/pocketmage_sd/src/pocketmage_sdworker.cpp>
+#include <lib/pocketmage_perf/src/pocketmage_perf.cpp>
+#include <lib/pocketmage_text/src/pocketmage_text.cpp>
+#include <lib/pocketmage_text/src/pocketmage_journal.cpp>
+
+bool SAVE_POWER = false;
+
+static fs::FS sd;
+
+// ===================== helpers =====================
+static size_t sizeOf(HandleCache& handles, const char* path) {
+  File* f = handles.acquire(sd, path);
+  const size_t size = f ? f->size() : 0;
+  handles.release();
+  return size;
+}
+
+void setUp() {
+  sd.clear();
+  for (int i = 0; i < 6; i++) sd.put(("/f" + std::to_string(i)).c_str(), std::string(i + 1, 'x'));
+}
+
+void tearDown() {}
+
+// ===================== tests =====================
+void test_nothing_is_handed_out_before_begin() {
+  HandleCache handles;
+  TEST_ASSERT_FALSE(handles.ready());
+  TEST_ASSERT_NULL(handles.acquire(sd, "/f0"));
+  handles.release();
+  TEST_ASSERT_TRUE(handles.begin());
+  TEST_ASSERT_TRUE(handles.ready());
+  TEST_ASSERT_EQUAL(1, sizeOf(handles, "/f0"));
+  handles.closeAll();
+}
+
+void test_hot_paths_stay_open() {
+  HandleCache handles;
+  handles.begin();
+  sd.resetStats();
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL(i + 1, sizeOf(handles, ("/f" + std::to_string(i)).c_str()));
+  }
+  TEST_ASSERT_EQUAL_UINT32(4, sd.stats().opens);
+  TEST_ASSERT_EQUAL_UINT32(4, handles.opens());
+  TEST_ASSERT_EQUAL_UINT32(36, handles.hits());
+
+  // A fifth path reuses the least recently used slot
+  sizeOf(handles, "/f1");
+  sizeOf(handles, "/f4");
+  TEST_ASSERT_EQUAL(0, sd.openHandles("/f0"));
+  TEST_ASSERT_EQUAL(1, sd.openHandles("/f1"));
+  TEST_ASSERT_EQUAL(1, sd.openHandles("/f4"));
+
+  // Missing files and directories aren't kept
+  sd.mkdir("/dir");
+  TEST_ASSERT_EQUAL(0, sizeOf(handles, "/none"));
+  TEST_ASSERT_EQUAL(0, sizeOf(handles, "/dir"));
+  TEST_ASSERT_EQUAL(0, sd.openHandles("/dir"));
+
+  handles.closeAll();
+  for (int i = 0; i < 6; i++) TEST_ASSERT_EQUAL(0, sd.openHandles(("/f" + std::to_string(i)).c_str()));
+}
+
+void test_invalidate_closes_before_a_rename() {
+  HandleCache handles;
+  handles.begin();
+  sizeOf(handles, "/f2");
+  sizeOf(handles, "/f3");
+  handles.invalidate("/f2");
+  TEST_ASSERT_EQUAL(0, sd.openHandles("/f2"));
+  TEST_ASSERT_EQUAL(1, sd.openHandles("/f3"));
+
+  sd.resetStats();
+  TEST_ASSERT_TRUE(sd.rename("/f2", "/g2"));
+  TEST_ASSERT_EQUAL_UINT32(0, sd.stats().removedWhileOpen);
+
+  // Not invalidated: the card sees the file pulled out from under a handle
+  sd.remove("/f3");
+  TEST_ASSERT_EQUAL_UINT32(1, sd.stats().removedWhileOpen);
+  handles.closeAll();
+}
+
+void test_journal_compaction_after_invalidate() {
+  SdWorker* worker = new SdWorker();  // never freed, its task holds it
+  TEST_ASSERT_TRUE(worker->begin(&sd));
+  sd.put("/note.txt", std::string(30000, 'n'));
+
+  // The note was read (and its size checked) through the worker
+  SdWorker::Request stat = SdWorker::Request::stat("/note.txt");
+  TEST_ASSERT_TRUE(worker->run(stat));
+  TEST_ASSERT_EQUAL(1, sd.openHandles("/note.txt"));
+
+  TextJournal  journal;
+  TextDocument doc;
+  worker->invalidate("/note.txt");
+  TEST_ASSERT_TRUE(journal.load(sd, "/note.txt", doc));
+  std::string edit(20000, 'e');
+  doc.insert(10, edit.data(), edit.size());
+  TEST_ASSERT_TRUE(worker->run(stat));
+  TEST_ASSERT_EQUAL(1, sd.openHandles("/note.txt"));
+
+  // Big enough to compact: the file is removed and replaced
+  sd.resetStats();
+  worker->invalidate("/note.txt");
+  TEST_ASSERT_TRUE(journal.save(sd, "/note.txt", doc));
+  TEST_ASSERT_EQUAL_UINT32(1, sd.stats().renames);
+  TEST_ASSERT_EQUAL_UINT32(0, sd.stats().removedWhileOpen);
+
+  TEST_ASSERT_TRUE(worker->run(stat));
+  TEST_ASSERT_EQUAL(50000, stat.result);
+  worker->closeHandles();
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_is_handed_out_before_begin);
+  RUN_TEST(test_hot_paths_stay_open);
+  RUN_TEST(test_invalidate_closes_before_a_rename);
+  RUN_TEST(test_journal_compaction_after_invalidate);
+  return UNITY_END();
+}
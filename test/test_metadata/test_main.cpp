@@ -0,0 +1,300 @@
+// Host tests for MetadataIndex (lib/pocketmage_sd/src/pocketmage_metadata.cpp)
+// on a RAM fs::FS: record I/O per update stays flat as the table grows,
+// freed slots keep probe chains intact, the SDMMC_META.txt round trip with
+// PocketMage OS (lines it removed included), and rebuilding a bad index.
+// Run with: pio test -e native -f test_metadata [-v]
+#include <unity.h>
+#include <FS.h>
+#include <string>
+#include <vector>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_sd/src/pocketmage_metadata.cpp>
+
+static fs::FS sd;
+
+static const char* indexPath  = "/sys/SDMMC_META.idx";
+static const char* legacyPath = "/sys/SDMMC_META.txt";
+
+// ===================== helpers =====================
+static String notePath(int i) {
+  char path[32];
+  snprintf(path, sizeof(path), "/notes/note%04d.txt", i);
+  return String(path);
+}
+
+static void putNotes(MetadataIndex& index, int from, int to) {
+  for (int i = from; i < to; i++) {
+    TEST_ASSERT_TRUE(index.put(notePath(i), "20260101-0900", i * 10, i));
+  }
+}
+
+static void checkNotes(MetadataIndex& index, int from, int to) {
+  MetadataIndex::Entry entry;
+  for (int i = from; i < to; i++) {
+    TEST_ASSERT_TRUE(index.get(notePath(i), entry));
+    TEST_ASSERT_EQUAL_STRING(notePath(i).c_str(), entry.path);
+    TEST_ASSERT_EQUAL_UINT32(i * 10, entry.bytes);
+    TEST_ASSERT_EQUAL_UINT32(i, entry.chars);
+  }
+}
+
+// Paths whose probe chains start at the same slot of a 64 slot table
+static std::vector<String> collidingPaths(size_t count) {
+  std::vector<String> paths;
+  uint32_t start = UINT32_MAX;
+  for (int i = 0; paths.size() < count; i++) {
+    const String path = "/c/" + String(i);
+    uint32_t h = 2166136261u;
+    for (const char* p = path.c_str(); *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+    if (start == UINT32_MAX) start = h % 64;
+    if (h % 64 == start) paths.push_back(path);
+  }
+  return paths;
+}
+
+void setUp() {
+  sd.clear();
+  sd.mkdir("/sys");
+}
+
+void tearDown() {}
+
+// ===================== tests =====================
+void test_put_get_remove_rename() {
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath));
+  TEST_ASSERT_EQUAL(0, index.size());
+
+  TEST_ASSERT_TRUE(index.put("/notes/a.txt", "20260101-0900", 120, 100));
+  TEST_ASSERT_TRUE(index.put("/notes/a.txt", "20260102-1000", 130, 110));
+  TEST_ASSERT_EQUAL(1, index.size());
+  MetadataIndex::Entry entry;
+  TEST_ASSERT_TRUE(index.get("/notes/a.txt", entry));
+  TEST_ASSERT_EQUAL_STRING("20260102-1000", entry.timestamp);
+  TEST_ASSERT_EQUAL_UINT32(130, entry.bytes);
+
+  TEST_ASSERT_TRUE(index.rename("/notes/a.txt", "/journal/a.txt"));
+  TEST_ASSERT_FALSE(index.get("/notes/a.txt", entry));
+  TEST_ASSERT_TRUE(index.get("/journal/a.txt", entry));
+  TEST_ASSERT_EQUAL_UINT32(110, entry.chars);
+  TEST_ASSERT_EQUAL(1, index.size());
+
+  TEST_ASSERT_TRUE(index.remove("/journal/a.txt"));
+  TEST_ASSERT_TRUE(index.remove("/journal/a.txt"));
+  TEST_ASSERT_FALSE(index.get("/journal/a.txt", entry));
+  TEST_ASSERT_EQUAL(0, index.size());
+
+  // Longer than a record holds
+  TEST_ASSERT_FALSE(index.put(String("/") + String(std::string(120, 'x').c_str()), "20260101-0900", 1, 1));
+  index.end();
+  TEST_ASSERT_FALSE(index.put("/notes/b.txt", "20260101-0900", 1, 1));
+}
+
+void test_entries_survive_growth_and_reopening() {
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath));
+  putNotes(index, 0, 1000);
+  TEST_ASSERT_EQUAL(1000, index.size());
+  checkNotes(index, 0, 1000);
+  // 64 slots doubled until 1000 entries fit under 3/4 full
+  TEST_ASSERT_EQUAL(128 + 2048 * 128, sd.contents(indexPath).size());
+  TEST_ASSERT_FALSE(sd.exists("/sys/SDMMC_META.idx.tmp"));
+
+  index.end();
+  MetadataIndex reopened;
+  TEST_ASSERT_TRUE(reopened.begin(sd, indexPath));
+  TEST_ASSERT_EQUAL(1000, reopened.size());
+  checkNotes(reopened, 0, 1000);
+}
+
+void test_update_io_stays_flat_as_the_table_grows() {
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath));
+  int entries = 0;
+  for (int target : { 40, 400, 4000 }) {
+    putNotes(index, entries, target);
+    entries = target;
+
+    // Saving a note that is already indexed
+    const MetadataIndex::Stats before = index.stats();
+    sd.resetStats();
+    for (int i = 0; i < entries; i++) index.put(notePath(i), "20260301-1200", i * 10, i);
+    const uint32_t reads  = index.stats().reads - before.reads;
+    const uint32_t writes = index.stats().writes - before.writes;
+    TEST_ASSERT_EQUAL_UINT32(entries, writes);
+    TEST_ASSERT_EQUAL_UINT32(entries * sizeof(MetadataIndex::Entry), (uint32_t)sd.stats().bytesWritten);
+    // A short probe chain at most 3/4 full, whatever the entry count
+    TEST_ASSERT_LESS_THAN_UINT32(3 * entries, reads);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%4d entries: %.2f records read, 1 written per update (%u B)", entries,
+             (double)reads / entries, (unsigned)sizeof(MetadataIndex::Entry));
+    TEST_MESSAGE(line);
+  }
+}
+
+void test_freed_slots_keep_probe_chains_intact() {
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath));
+  const std::vector<String> paths = collidingPaths(4);
+  for (const String& path : paths) TEST_ASSERT_TRUE(index.put(path, "20260101-0900", 1, 1));
+
+  // Removing one from the middle of the chain hides none behind it
+  TEST_ASSERT_TRUE(index.remove(paths[1]));
+  MetadataIndex::Entry entry;
+  TEST_ASSERT_TRUE(index.get(paths[2], entry));
+  TEST_ASSERT_TRUE(index.get(paths[3], entry));
+
+  // Updating one behind the freed slot doesn't duplicate it there
+  TEST_ASSERT_TRUE(index.put(paths[3], "20260202-0900", 2, 2));
+  TEST_ASSERT_EQUAL(3, index.size());
+  TEST_ASSERT_TRUE(index.remove(paths[3]));
+  TEST_ASSERT_FALSE(index.get(paths[3], entry));
+
+  // A new entry takes the freed slot
+  const size_t before = sd.contents(indexPath).size();
+  TEST_ASSERT_TRUE(index.put(paths[1], "20260303-0900", 3, 3));
+  TEST_ASSERT_EQUAL(before, sd.contents(indexPath).size());
+  TEST_ASSERT_EQUAL(3, index.size());
+}
+
+void test_text_file_round_trip() {
+  sd.put(legacyPath,
+         "/notes/a.txt|20250101-0800|120 Bytes|100 Char\n"
+         "/notes/b.txt|20250102-0900|64 Bytes|60 Char\r\n"
+         "a line PocketMage OS would never write\n");
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(2, index.size());
+  MetadataIndex::Entry entry;
+  TEST_ASSERT_TRUE(index.get("/notes/b.txt", entry));
+  TEST_ASSERT_EQUAL_STRING("20250102-0900", entry.timestamp);
+  TEST_ASSERT_EQUAL_UINT32(64, entry.bytes);
+  TEST_ASSERT_EQUAL_UINT32(60, entry.chars);
+
+  // Imported only: nothing to export
+  const std::string imported = sd.contents(legacyPath);
+  TEST_ASSERT_TRUE(index.exportText());
+  TEST_ASSERT_TRUE(sd.contents(legacyPath) == imported);
+
+  TEST_ASSERT_TRUE(index.put("/notes/c.txt", "20260101-0900", 5, 4));
+  TEST_ASSERT_TRUE(index.remove("/notes/a.txt"));
+  TEST_ASSERT_TRUE(index.exportText());
+  const std::string text = sd.contents(legacyPath);
+  TEST_ASSERT_TRUE(text.find("/notes/c.txt|20260101-0900|5 Bytes|4 Char\n") != std::string::npos);
+  TEST_ASSERT_TRUE(text.find("/notes/b.txt|20250102-0900|64 Bytes|60 Char\n") != std::string::npos);
+  TEST_ASSERT_TRUE(text.find("/notes/a.txt") == std::string::npos);
+  TEST_ASSERT_FALSE(sd.exists("/sys/SDMMC_META.txt.tmp"));
+
+  // Its own export isn't imported straight back
+  index.end();
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL_UINT32(0, index.stats().writes);
+  TEST_ASSERT_EQUAL(2, index.size());
+
+  // PocketMage OS added a line since
+  index.end();
+  sd.put(legacyPath, text + "/notes/d.txt|20260505-0500|9 Bytes|8 Char\n");
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(3, index.size());
+  TEST_ASSERT_TRUE(index.get("/notes/d.txt", entry));
+  TEST_ASSERT_EQUAL_UINT32(9, entry.bytes);
+}
+
+void test_lines_removed_from_the_text_file_are_dropped() {
+  sd.put(legacyPath,
+         "/notes/a.txt|20250101-0800|120 Bytes|100 Char\n"
+         "/notes/b.txt|20250102-0900|64 Bytes|60 Char\n"
+         "/notes/c.txt|20250103-1000|32 Bytes|30 Char\n");
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(3, index.size());
+  index.end();
+
+  // PocketMage OS deleted b.txt and dropped its line
+  sd.put(legacyPath,
+         "/notes/a.txt|20250101-0800|120 Bytes|100 Char\n"
+         "/notes/c.txt|20250103-1000|32 Bytes|30 Char\n");
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(2, index.size());
+  MetadataIndex::Entry entry;
+  TEST_ASSERT_FALSE(index.get("/notes/b.txt", entry));
+  TEST_ASSERT_TRUE(index.get("/notes/c.txt", entry));
+
+  // And the next export doesn't bring it back
+  TEST_ASSERT_TRUE(index.put("/notes/d.txt", "20260101-0900", 5, 4));
+  TEST_ASSERT_TRUE(index.exportText());
+  const std::string text = sd.contents(legacyPath);
+  TEST_ASSERT_TRUE(text.find("/notes/b.txt") == std::string::npos);
+  TEST_ASSERT_TRUE(text.find("/notes/a.txt") != std::string::npos);
+  TEST_ASSERT_TRUE(text.find("/notes/d.txt") != std::string::npos);
+  index.end();
+
+  // Power cut while clearing for the next import: it runs again
+  sd.put(legacyPath, "/notes/a.txt|20250101-0800|120 Bytes|100 Char\n");
+  sd.setWriteBudget(sizeof(MetadataIndex::Entry) * 5);
+  index.begin(sd, indexPath, legacyPath);
+  index.end();
+  sd.setWriteBudget(SIZE_MAX);
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(1, index.size());
+  TEST_ASSERT_TRUE(index.get("/notes/a.txt", entry));
+  TEST_ASSERT_FALSE(index.get("/notes/d.txt", entry));
+}
+
+void test_bad_index_is_rebuilt_from_the_text_file() {
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  putNotes(index, 0, 30);
+  TEST_ASSERT_TRUE(index.exportText());
+  index.end();
+
+  // Torn: the header promises more slots than the file holds
+  const std::string full = sd.contents(indexPath);
+  sd.put(indexPath, full.substr(0, full.size() / 2));
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(30, index.size());
+  checkNotes(index, 0, 30);
+  index.end();
+
+  // Foreign: not an index at all
+  sd.put(indexPath, std::string(4096, 'z'));
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(30, index.size());
+  checkNotes(index, 0, 30);
+  index.end();
+
+  // Without a text file it starts empty rather than failing
+  sd.remove(legacyPath);
+  sd.put(indexPath, "META");
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath, legacyPath));
+  TEST_ASSERT_EQUAL(0, index.size());
+}
+
+void test_interrupted_rebuild_is_recovered() {
+  MetadataIndex index;
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath));
+  putNotes(index, 0, 10);
+  index.end();
+
+  // Power cut after the old index was removed, before the rename
+  sd.rename(indexPath, "/sys/SDMMC_META.idx.tmp");
+  TEST_ASSERT_TRUE(index.begin(sd, indexPath));
+  TEST_ASSERT_FALSE(sd.exists("/sys/SDMMC_META.idx.tmp"));
+  TEST_ASSERT_EQUAL(10, index.size());
+  checkNotes(index, 0, 10);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_put_get_remove_rename);
+  RUN_TEST(test_entries_survive_growth_and_reopening);
+  RUN_TEST(test_update_io_stays_flat_as_the_table_grows);
+  RUN_TEST(test_freed_slots_keep_probe_chains_intact);
+  RUN_TEST(test_text_file_round_trip);
+  RUN_TEST(test_lines_removed_from_the_text_file_are_dropped);
+  RUN_TEST(test_bad_index_is_rebuilt_from_the_text_file);
+  RUN_TEST(test_interrupted_rebuild_is_recovered);
+  return UNITY_END();
+}
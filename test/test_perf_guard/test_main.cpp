@@ -0,0 +1,135 @@
+// Host tests for PerfGuard (lib/pocketmage_perf/src/pocketmage_perf.cpp):
+// nested guards switch the clock once, and an outermost run that starts in
+// one task and ends in another is timed and labelled from its first guard.
+// The last test prints the clock switches and busy time of a run of saves.
+// Run with: pio test -e native -f test_perf_guard [-v]
+// Before numbers: PLATFORMIO_BUILD_FLAGS=-DPERF_GUARD_PER_CALL=1 pio test ...
+#include <unity.h>
+#include <atomic>
+#include <thread>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_perf/src/pocketmage_perf.cpp>
+
+bool SAVE_POWER = true;
+
+// ===================== helpers =====================
+static PerfGuard::Stats since(const PerfGuard::Stats& before) {
+  const PerfGuard::Stats& now = PerfGuard::stats();
+  return { now.operations - before.operations, now.nested - before.nested,
+           now.switches - before.switches, now.busyMicros - before.busyMicros };
+}
+
+static void spin(unsigned long us) {
+  const unsigned long start = micros();
+  while (micros() - start < us) yield();
+}
+
+void setUp() {
+  SAVE_POWER = true;
+  setCpuFrequencyMhz(POWER_SAVE_FREQ);
+}
+
+void tearDown() {}
+
+// ===================== tests =====================
+void test_nested_guards_switch_once() {
+  if (PERF_GUARD_PER_CALL) TEST_IGNORE_MESSAGE("per-call build");
+  const PerfGuard::Stats before = PerfGuard::stats();
+  {
+    PerfGuard save("saveFile");
+    TEST_ASSERT_EQUAL_UINT32(240, getCpuFrequencyMhz());
+    for (int i = 0; i < 3; i++) {
+      PerfGuard write("SD write");
+      TEST_ASSERT_EQUAL_UINT32(2, PerfGuard::depth());
+    }
+    TEST_ASSERT_EQUAL_UINT32(240, getCpuFrequencyMhz());
+  }
+  TEST_ASSERT_EQUAL_UINT32(POWER_SAVE_FREQ, getCpuFrequencyMhz());
+  TEST_ASSERT_EQUAL_UINT32(0, PerfGuard::depth());
+
+  const PerfGuard::Stats run = since(before);
+  TEST_ASSERT_EQUAL_UINT32(1, run.operations);
+  TEST_ASSERT_EQUAL_UINT32(3, run.nested);
+  TEST_ASSERT_EQUAL_UINT32(2, run.switches);
+}
+
+void test_clock_stays_up_without_save_power() {
+  if (PERF_GUARD_PER_CALL) TEST_IGNORE_MESSAGE("per-call build");
+  SAVE_POWER = false;
+  const PerfGuard::Stats before = PerfGuard::stats();
+  { PerfGuard read("SD read"); }
+  { PerfGuard read("SD read"); }
+  TEST_ASSERT_EQUAL_UINT32(240, getCpuFrequencyMhz());
+  TEST_ASSERT_EQUAL_UINT32(1, since(before).switches);
+}
+
+void test_run_spanning_two_tasks_is_timed_from_the_first_guard() {
+  if (PERF_GUARD_PER_CALL) TEST_IGNORE_MESSAGE("per-call build");
+  const PerfGuard::Stats before = PerfGuard::stats();
+  std::atomic<int> step{0};
+  uint32_t depthAfter = 0, clockAfter = 0;
+  const unsigned long start = micros();
+
+  // The loop task opens the run, the worker task joins in and outlasts it
+  std::thread loop([&] {
+    PerfGuard save("saveFile");
+    step = 1;
+    while (step != 2) yield();
+    spin(20000);
+  });
+  std::thread worker([&] {
+    while (step != 1) yield();
+    PerfGuard write("SD worker");
+    step = 2;
+    loop.join();
+    depthAfter = PerfGuard::depth();
+    clockAfter = getCpuFrequencyMhz();
+    spin(20000);
+  });
+  worker.join();
+
+  // The first guard is gone, the run isn't over
+  TEST_ASSERT_EQUAL_UINT32(1, depthAfter);
+  TEST_ASSERT_EQUAL_UINT32(240, clockAfter);
+
+  const PerfGuard::Stats run = since(before);
+  TEST_ASSERT_EQUAL_UINT32(1, run.operations);
+  TEST_ASSERT_EQUAL_UINT32(1, run.nested);
+  TEST_ASSERT_EQUAL_UINT32(2, run.switches);
+  // Both spins, from the loop's guard, not from a start the worker never set
+  TEST_ASSERT_TRUE(run.busyMicros >= 40000);
+  TEST_ASSERT_TRUE(run.busyMicros <= micros() - start);
+  TEST_ASSERT_EQUAL_UINT32(POWER_SAVE_FREQ, getCpuFrequencyMhz());
+}
+
+// ===================== benchmark =====================
+// 20 saves, each a saveFile guard around the document, journal and metadata
+// writes, 1 ms of work apiece
+void test_benchmark_switches_per_save() {
+  const PerfGuard::Stats before = PerfGuard::stats();
+  for (int i = 0; i < 20; i++) {
+    PerfGuard save("saveFile");
+    for (int j = 0; j < 3; j++) {
+      PerfGuard write("SD write");
+      spin(1000);
+    }
+  }
+  const PerfGuard::Stats run = since(before);
+
+  char line[128];
+  snprintf(line, sizeof(line), "20 saves: %lu clock switches, %lu ms busy (PERF_GUARD_PER_CALL=%d)",
+           (unsigned long)run.switches, (unsigned long)(run.busyMicros / 1000), PERF_GUARD_PER_CALL);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL_UINT32(20, run.operations);
+  if (!PERF_GUARD_PER_CALL) TEST_ASSERT_EQUAL_UINT32(40, run.switches);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nested_guards_switch_once);
+  RUN_TEST(test_clock_stays_up_without_save_power);
+  RUN_TEST(test_run_spanning_two_tasks_is_timed_from_the_first_guard);
+  RUN_TEST(test_benchmark_switches_per_save);
+  return UNITY_END();
+}
@@ -0,0 +1,263 @@
+// Host tests for SdWorker (lib/pocketmage_sd/src/pocketmage_sdworker.cpp) on
+// a RAM fs::FS: lane order, done callbacks, run() from inside a callback,
+// several tasks sharing the worker, and appended lines staying whole.
+// Run with: pio test -e native -f test_sd_worker
+#include <unity.h>
+#include <FS.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_sd/src/pocketmage_sdworker.cpp>
+#include <lib/pocketmage_sd/src/pocketmage_blockcache.cpp>
+#include <lib/pocketmage_sd/src/pocketmage_handlecache.cpp>
+#include <lib/pocketmage_perf/src/pocketmage_perf.cpp>
+
+bool SAVE_POWER = false;
+
+using Request = SdWorker::Request;
+
+// ===================== helpers =====================
+struct Bench {
+  fs::FS*   sd;
+  SdWorker* worker;
+};
+
+// A fresh card and worker each test; never freed, the worker task holds both
+static Bench newBench() {
+  fs::FS* sd = new fs::FS();
+  sd->mkdir("/notes");
+  SdWorker* worker = new SdWorker();
+  TEST_ASSERT_TRUE(worker->begin(sd));
+  TEST_ASSERT_TRUE(worker->isRunning());
+  return { sd, worker };
+}
+
+// Holds the worker inside a done callback until opened, so the test can
+// fill both lanes while it is busy
+struct Gate {
+  SemaphoreHandle_t entered = xSemaphoreCreateBinary();
+  SemaphoreHandle_t open    = xSemaphoreCreateBinary();
+
+  static void hold(Request& req, void* ctx) {
+    (void)req;
+    Gate* gate = static_cast<Gate*>(ctx);
+    xSemaphoreGive(gate->entered);
+    xSemaphoreTake(gate->open, portMAX_DELAY);
+  }
+};
+
+// Completion order, appended to from the worker task
+struct Order {
+  std::mutex       lock;
+  std::vector<int> done;
+
+  static void record(Request& req, void* ctx) {
+    Order* order = static_cast<Order*>(ctx);
+    std::lock_guard<std::mutex> l(order->lock);
+    order->done.push_back((int)req.offset);
+  }
+};
+
+void setUp() {}
+void tearDown() {}
+
+// ===================== tests =====================
+void test_read_write_append_stat() {
+  Bench b = newBench();
+  const char* text = "the star, upright";
+  Request write = Request::write("/notes/a.txt", (const uint8_t*)text, strlen(text));
+  TEST_ASSERT_TRUE(b.worker->run(write));
+  TEST_ASSERT_EQUAL(strlen(text), write.result);
+
+  Request append = Request::append("/notes/a.txt", (const uint8_t*)": hope", 6, true);
+  TEST_ASSERT_TRUE(b.worker->run(append, SdWorker::Background));
+  TEST_ASSERT_TRUE(b.sd->contents("/notes/a.txt") == "the star, upright: hope\r\n");
+
+  Request stat = Request::stat("/notes/a.txt");
+  TEST_ASSERT_TRUE(b.worker->run(stat));
+  TEST_ASSERT_EQUAL(25, stat.result);
+
+  char buf[16] = {};
+  Request read = Request::read("/notes/a.txt", (uint8_t*)buf, 4, 4);
+  TEST_ASSERT_TRUE(b.worker->run(read));
+  TEST_ASSERT_EQUAL_STRING("star", buf);
+
+  // Past the end is short, a missing file fails
+  Request tail = Request::read("/notes/a.txt", (uint8_t*)buf, 8, 20);
+  TEST_ASSERT_FALSE(b.worker->run(tail));
+  TEST_ASSERT_EQUAL(5, tail.result);
+  Request missing = Request::stat("/notes/none.txt");
+  TEST_ASSERT_FALSE(b.worker->run(missing));
+  TEST_ASSERT_FALSE(b.worker->submit(missing, SdWorker::LaneCount));
+}
+
+void test_writes_drop_cached_reads() {
+  Bench b = newBench();
+  b.sd->put("/notes/a.txt", "old text");
+  char buf[9] = {};
+  Request read = Request::read("/notes/a.txt", (uint8_t*)buf, 8);
+  TEST_ASSERT_TRUE(b.worker->run(read));
+  TEST_ASSERT_TRUE(b.worker->run(read));
+  TEST_ASSERT_EQUAL_UINT32(1, b.worker->cache().stats().hits);
+
+  Request write = Request::write("/notes/a.txt", (const uint8_t*)"new text", 8);
+  TEST_ASSERT_TRUE(b.worker->run(write));
+  TEST_ASSERT_TRUE(b.worker->run(read));
+  TEST_ASSERT_EQUAL_STRING("new text", buf);
+
+  // The stat after the write sees the new size, not a stale handle's
+  Request append = Request::append("/notes/a.txt", (const uint8_t*)"!", 1);
+  TEST_ASSERT_TRUE(b.worker->run(append));
+  Request stat = Request::stat("/notes/a.txt");
+  TEST_ASSERT_TRUE(b.worker->run(stat));
+  TEST_ASSERT_EQUAL(9, stat.result);
+}
+
+void test_interactive_lane_goes_first() {
+  Bench b = newBench();
+  b.sd->put("/notes/a.txt", "0123456789");
+  Gate  gate;
+  Order order;
+
+  Request blocker = Request::stat("/notes/a.txt");
+  blocker.done = Gate::hold;
+  blocker.ctx  = &gate;
+  TEST_ASSERT_TRUE(b.worker->submit(blocker, SdWorker::Background));
+  xSemaphoreTake(gate.entered, portMAX_DELAY);
+
+  // Background requests are queued first, and tagged by their offset
+  uint8_t buf[8][1];
+  std::vector<Request> reqs;
+  for (int i = 0; i < 8; i++) reqs.push_back(Request::read("/notes/a.txt", buf[i], 1, i));
+  for (Request& req : reqs) {
+    req.done = Order::record;
+    req.ctx  = &order;
+  }
+  for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(b.worker->submit(reqs[i], SdWorker::Background));
+  for (int i = 4; i < 8; i++) TEST_ASSERT_TRUE(b.worker->submit(reqs[i], SdWorker::Interactive));
+  xSemaphoreGive(gate.open);
+
+  for (Request& req : reqs) TEST_ASSERT_TRUE(b.worker->wait(req));
+  TEST_ASSERT_TRUE(b.worker->wait(blocker));
+  const std::vector<int> expected = { 4, 5, 6, 7, 0, 1, 2, 3 };
+  TEST_ASSERT_TRUE(order.done == expected);
+  for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL('0' + i, buf[i][0]);
+}
+
+// A done callback that needs more from the card runs it inline instead of
+// queueing behind itself
+struct Chain {
+  SdWorker* worker;
+  char      buf[5];
+  bool      innerOk;
+  bool      onWorker;
+};
+
+static void readMore(Request& req, void* ctx) {
+  (void)req;
+  Chain* chain = static_cast<Chain*>(ctx);
+  chain->onWorker = chain->worker->onWorkerTask();
+  Request inner   = Request::read("/notes/a.txt", (uint8_t*)chain->buf, 4, 6);
+  chain->innerOk  = chain->worker->run(inner);
+}
+
+void test_run_from_a_done_callback_runs_inline() {
+  Bench b = newBench();
+  b.sd->put("/notes/a.txt", "wands cups");
+  Chain chain = { b.worker, {}, false, false };
+  Request outer = Request::stat("/notes/a.txt");
+  outer.done = readMore;
+  outer.ctx  = &chain;
+  TEST_ASSERT_TRUE(b.worker->run(outer));
+  TEST_ASSERT_TRUE(chain.onWorker);
+  TEST_ASSERT_TRUE(chain.innerOk);
+  TEST_ASSERT_EQUAL_STRING("cups", chain.buf);
+  TEST_ASSERT_FALSE(b.worker->onWorkerTask());
+}
+
+void test_run_before_begin_runs_inline() {
+  fs::FS sd;
+  sd.put("/a.txt", "abc");
+  SdWorker worker;
+  TEST_ASSERT_FALSE(worker.isRunning());
+  Request stat = Request::stat("/a.txt");
+  TEST_ASSERT_FALSE(worker.submit(stat));
+  // No file system yet, unless the request names one
+  TEST_ASSERT_FALSE(worker.run(stat));
+  stat.fs = &sd;
+  TEST_ASSERT_TRUE(worker.run(stat));
+  TEST_ASSERT_EQUAL(3, stat.result);
+}
+
+void test_requests_name_their_own_file_system() {
+  Bench b = newBench();
+  fs::FS* other = new fs::FS();  // never freed, the worker may hold a handle to it
+  b.sd->put("/a.txt", "main card");
+  other->put("/a.txt", "other fs");
+  char buf[9] = {};
+  Request read = Request::read("/a.txt", (uint8_t*)buf, 8);
+  read.fs = other;
+  TEST_ASSERT_TRUE(b.worker->run(read));
+  TEST_ASSERT_EQUAL_STRING("other fs", buf);
+  read.fs = nullptr;
+  TEST_ASSERT_TRUE(b.worker->run(read));
+  TEST_ASSERT_EQUAL_STRING("main car", buf);
+}
+
+void test_tasks_share_the_worker_and_lines_stay_whole() {
+  Bench b = newBench();
+  std::string asset(20000, '\0');
+  for (size_t i = 0; i < asset.size(); i++) asset[i] = (char)(i * 7);
+  b.sd->put("/assets/card.bin", asset);
+
+  const int threads = 4, lines = 200;
+  std::atomic<int> failures(0);
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++) {
+    pool.emplace_back([&, t] {
+      for (int i = 0; i < lines; i++) {
+        char line[32];
+        const int n = snprintf(line, sizeof(line), "task %d line %03d", t, i);
+        Request append = Request::append("/notes/log.txt", (const uint8_t*)line, n, true);
+        if (!b.worker->run(append, SdWorker::Background)) failures++;
+
+        uint8_t buf[300];
+        const size_t offset = (t * 5003 + i * 97) % (asset.size() - sizeof(buf));
+        Request read = Request::read("/assets/card.bin", buf, sizeof(buf), offset);
+        if (!b.worker->run(read) || memcmp(buf, asset.data() + offset, sizeof(buf)) != 0) failures++;
+      }
+    });
+  }
+  for (std::thread& thread : pool) thread.join();
+  TEST_ASSERT_EQUAL(0, failures.load());
+
+  // Every line once, each followed by its own line end
+  const std::string log = b.sd->contents("/notes/log.txt");
+  std::vector<int> next(threads, 0);
+  size_t pos = 0, count = 0;
+  while (pos < log.size()) {
+    const size_t end = log.find("\r\n", pos);
+    TEST_ASSERT_TRUE(end != std::string::npos);
+    int t, i;
+    TEST_ASSERT_EQUAL(2, sscanf(log.substr(pos, end - pos).c_str(), "task %d line %d", &t, &i));
+    TEST_ASSERT_EQUAL(next[t]++, i);
+    pos = end + 2;
+    count++;
+  }
+  TEST_ASSERT_EQUAL(threads * lines, count);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_read_write_append_stat);
+  RUN_TEST(test_writes_drop_cached_reads);
+  RUN_TEST(test_interactive_lane_goes_first);
+  RUN_TEST(test_run_from_a_done_callback_runs_inline);
+  RUN_TEST(test_run_before_begin_runs_inline);
+  RUN_TEST(test_requests_name_their_own_file_system);
+  RUN_TEST(test_tasks_share_the_worker_and_lines_stay_whole);
+  return UNITY_END();
+}
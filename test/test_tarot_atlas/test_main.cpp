@@ -0,0 +1,294 @@
+// Host tests for TarotAtlas (src/tarot/tarotAtlas.cpp): an atlas is packed
+// here the way images/fetch_and_process_img.py packs it, then read back raw
+// and PackBits coded. The benchmark times decoding all 44 Major Arcana
+// assets (1-card and 3-card sizes) against reading them raw.
+// Run with: pio test -e native -f test_tarot_atlas -v
+#include <unity.h>
+#include <FS.h>
+#include <math.h>
+#include <vector>
+
+// Units under test, the native env doesn't build src/
+#include <src/tarot/tarotAtlas.cpp>
+
+static fs::FS sd;
+
+// ===================== atlas writer =====================
+// Same coding as packbits_row() in images/fetch_and_process_img.py
+static void packbitsRow(const uint8_t* row, size_t n, std::string& out) {
+  size_t i = 0;
+  while (i < n) {
+    size_t run = 1;
+    while (i + run < n && run < 128 && row[i + run] == row[i]) run++;
+    if (run >= 2) {
+      out += (char)(257 - run);
+      out += (char)row[i];
+      i += run;
+      continue;
+    }
+    const size_t start = i;
+    while (i < n && i - start < 128 && !(i + 1 < n && row[i + 1] == row[i])) i++;
+    out += (char)(i - start - 1);
+    out.append((const char*)row + start, i - start);
+  }
+}
+
+static void put16(std::string& s, uint16_t v) { s += (char)(v & 0xFF); s += (char)(v >> 8); }
+static void put32(std::string& s, uint32_t v) { put16(s, v & 0xFFFF); put16(s, v >> 16); }
+static void putField(std::string& s, const char* text, size_t len) {
+  std::string field(text);
+  field.resize(len, '\0');
+  s += field;
+}
+
+// Card artwork: a framed, ordered-dithered radial gradient, different per
+// card, so the bitmaps compress like the real dithered art does
+static std::vector<uint8_t> cardArt(uint8_t card, uint8_t size, uint8_t planes) {
+  static const uint8_t bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+  const uint16_t w = TAROT_SIZES[size].w, h = TAROT_SIZES[size].h;
+  const uint16_t rowBytes = w / 8;
+  std::vector<uint8_t> out((size_t)rowBytes * planes * h, 0);
+  const float cx = w * (0.3f + 0.02f * (card % 10)), cy = h * (0.35f + 0.015f * card);
+
+  for (uint16_t y = 0; y < h; y++) {
+    uint8_t* row = out.data() + (size_t)y * rowBytes * planes;
+    for (uint16_t x = 0; x < w; x++) {
+      const bool margin = x < 4 || y < 4 || x >= w - 4 || y >= h - 4;
+      const bool frame  = !margin && (x < 6 || y < 6 || x >= w - 6 || y >= h - 6);
+      const float d     = sqrtf((x - cx) * (x - cx) + (y - cy) * (y - cy)) / (0.7f * w);
+      const float tone  = margin ? 0.0f : frame ? 1.0f : max(0.0f, min(1.0f, 1.0f - d));
+      uint8_t level;
+      if (planes == 1) level = tone * 16 > bayer[y & 3][x & 3] ? 3 : 0;
+      else             level = (uint8_t)min(3.0f, tone * 3 + bayer[y & 3][x & 3] / 16.0f);
+      const uint8_t bit = 0x80 >> (x & 7);
+      if (level & 2) row[x / 8] |= bit;
+      if (planes == 2 && (level & 1)) row[rowBytes + x / 8] |= bit;
+    }
+  }
+  return out;
+}
+
+struct AtlasOptions {
+  uint8_t  cards    = MAJOR_ARCANA_COUNT;
+  uint8_t  planes   = 1;
+  bool     compress = true;
+  uint16_t version  = 4;
+};
+
+// Writes /assets/tarot/cards.atlas
+static void writeAtlas(const AtlasOptions& opt) {
+  const size_t headerSize = 12 + 4 * TAROT_SIZE_COUNT;
+  const size_t recordSize = TAROT_CODE_LEN + 2 + 12 * TAROT_SIZE_COUNT + TAROT_NAME_LEN + TAROT_KEYWORDS_LEN;
+
+  std::string header = "TATL";
+  put16(header, opt.version);
+  header += (char)TAROT_SIZE_COUNT;
+  header += (char)opt.cards;
+  for (const TarotSizeInfo& s : TAROT_SIZES) {
+    put16(header, s.w);
+    put16(header, s.h);
+  }
+  put16(header, recordSize);
+  put16(header, opt.planes);
+
+  std::string records, blobs;
+  uint32_t offset = headerSize + recordSize * opt.cards;
+  for (uint8_t c = 0; c < opt.cards; c++) {
+    char code[8];
+    snprintf(code, sizeof(code), "ar%02u", c);
+    putField(records, code, TAROT_CODE_LEN);
+    records += (char)TAROT_SUIT_MAJOR;
+    records += (char)c;
+    for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+      const std::vector<uint8_t> art = cardArt(c, s, opt.planes);
+      const size_t rowBytes = TAROT_SIZES[s].w / 8 * opt.planes;
+      std::string packed;
+      for (size_t y = 0; y < art.size(); y += rowBytes) packbitsRow(art.data() + y, rowBytes, packed);
+
+      const bool use = opt.compress && packed.size() < art.size();
+      const std::string data = use ? packed : std::string(art.begin(), art.end());
+      put32(records, offset);
+      put32(records, data.size());
+      records += (char)(use ? 1 : 0);
+      records.append(3, '\0');
+      offset += data.size();
+      blobs  += data;
+    }
+    char name[24];
+    snprintf(name, sizeof(name), "Card %u", c);
+    putField(records, name, TAROT_NAME_LEN);
+    putField(records, "test, keywords", TAROT_KEYWORDS_LEN);
+  }
+  sd.put(TAROT_ATLAS_PATH, header + records + blobs);
+}
+
+void setUp() {
+  sd.clear();
+}
+
+void tearDown() {}
+
+// ===================== tests =====================
+void test_packbits_and_raw_cards_decode_to_the_same_bitmap() {
+  for (bool compress : { false, true }) {
+    AtlasOptions opt;
+    opt.compress = compress;
+    writeAtlas(opt);
+    TarotAtlas atlas;
+    TEST_ASSERT_TRUE(atlas.begin(&sd));
+    TEST_ASSERT_EQUAL(MAJOR_ARCANA_COUNT, atlas.count());
+    TEST_ASSERT_EQUAL(1, atlas.planes());
+
+    for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+      std::vector<uint8_t> buf(tarotBytes(s));
+      for (uint8_t c = 0; c < MAJOR_ARCANA_COUNT; c++) {
+        TEST_ASSERT_TRUE(atlas.read(c, s, buf.data(), buf.size()));
+        const std::vector<uint8_t> art = cardArt(c, s, 1);
+        TEST_ASSERT_EQUAL_MEMORY(art.data(), buf.data(), art.size());
+      }
+    }
+    atlas.end();
+  }
+}
+
+void test_read_rows_streams_every_row_once() {
+  writeAtlas(AtlasOptions());
+  TarotAtlas atlas;
+  TEST_ASSERT_TRUE(atlas.begin(&sd));
+
+  const uint8_t s = TAROT_SIZE_1;
+  const uint16_t rowBytes = TAROT_SIZES[s].w / 8;
+  const std::vector<uint8_t> art = cardArt(9, s, 1);
+  std::vector<uint8_t> out(art.size(), 0);
+  uint16_t next = 0;
+  TEST_ASSERT_TRUE(atlas.readRows(9, s, [&](uint16_t y, const uint8_t* rows, uint16_t count) {
+    TEST_ASSERT_EQUAL(next, y);
+    memcpy(out.data() + (size_t)y * rowBytes, rows, (size_t)count * rowBytes);
+    next = y + count;
+  }));
+  TEST_ASSERT_EQUAL(TAROT_SIZES[s].h, next);
+  TEST_ASSERT_EQUAL_MEMORY(art.data(), out.data(), art.size());
+}
+
+void test_greyscale_rows_hold_both_planes() {
+  AtlasOptions opt;
+  opt.planes = 2;
+  writeAtlas(opt);
+  TarotAtlas atlas;
+  TEST_ASSERT_TRUE(atlas.begin(&sd));
+  TEST_ASSERT_EQUAL(2, atlas.planes());
+
+  std::vector<uint8_t> buf(tarotBytes(TAROT_SIZE_3, 2));
+  TEST_ASSERT_FALSE(atlas.read(4, TAROT_SIZE_3, buf.data(), tarotBytes(TAROT_SIZE_3)));
+  TEST_ASSERT_TRUE(atlas.read(4, TAROT_SIZE_3, buf.data(), buf.size()));
+  const std::vector<uint8_t> art = cardArt(4, TAROT_SIZE_3, 2);
+  TEST_ASSERT_EQUAL_MEMORY(art.data(), buf.data(), art.size());
+}
+
+void test_card_info_comes_from_the_record() {
+  writeAtlas(AtlasOptions());
+  TarotAtlas atlas;
+  TEST_ASSERT_TRUE(atlas.begin(&sd));
+  TarotCardInfo info;
+  TEST_ASSERT_TRUE(atlas.info(12, info));
+  TEST_ASSERT_EQUAL_STRING("ar12", info.code);
+  TEST_ASSERT_EQUAL_STRING("Card 12", info.name);
+  TEST_ASSERT_EQUAL_STRING("test, keywords", info.keywords);
+  TEST_ASSERT_EQUAL(12, info.number);
+  TEST_ASSERT_FALSE(atlas.info(MAJOR_ARCANA_COUNT, info));
+}
+
+void test_bad_headers_are_rejected() {
+  TarotAtlas atlas;
+  TEST_ASSERT_FALSE(atlas.begin(&sd));  // no file
+
+  AtlasOptions opt;
+  opt.version = 5;
+  writeAtlas(opt);
+  TEST_ASSERT_FALSE(atlas.begin(&sd));
+
+  writeAtlas(AtlasOptions());
+  std::string data = sd.contents(TAROT_ATLAS_PATH);
+  data[8] ^= 0x08;  // width of the 1-card size class
+  sd.put(TAROT_ATLAS_PATH, data);
+  TEST_ASSERT_FALSE(atlas.begin(&sd));
+  TEST_ASSERT_FALSE(atlas.isOpen());
+}
+
+void test_corrupt_packbits_data_fails_the_read() {
+  writeAtlas(AtlasOptions());
+  std::string data = sd.contents(TAROT_ATLAS_PATH);
+  // First card's 1-card entry: offset at record start + code + suit/number
+  const size_t entry = 12 + 4 * TAROT_SIZE_COUNT + TAROT_CODE_LEN + 2;
+  const uint32_t offset = (uint8_t)data[entry] | ((uint8_t)data[entry + 1] << 8) | ((uint8_t)data[entry + 2] << 16);
+  TEST_ASSERT_EQUAL(1, data[entry + 8]);
+  data[offset] = (char)0x81;  // a 128 byte run, longer than the 16 byte row
+  sd.put(TAROT_ATLAS_PATH, data);
+
+  TarotAtlas atlas;
+  TEST_ASSERT_TRUE(atlas.begin(&sd));
+  std::vector<uint8_t> buf(tarotBytes(TAROT_SIZE_1));
+  TEST_ASSERT_FALSE(atlas.read(0, TAROT_SIZE_1, buf.data(), buf.size()));
+  TEST_ASSERT_TRUE(atlas.read(1, TAROT_SIZE_1, buf.data(), buf.size()));
+}
+
+// ===================== benchmark =====================
+// Host CPU time of the decode is not ESP32 time, so the report puts it next
+// to the bytes each variant pulls over the bus. The bus is SD_MMC in 1-bit
+// mode at its 20 MHz default, 2.5 MB/s at best.
+void test_benchmark_decode_vs_raw_read() {
+  static constexpr uint8_t  sizes[]    = { TAROT_SIZE_1, TAROT_SIZE_3 };
+  static constexpr int      rounds     = 50;
+  static constexpr double   busBytesUs = 2.5;  // bytes per microsecond
+
+  struct Result { uint64_t cardBytes; double hostUs; };
+  Result results[2];
+  std::vector<std::vector<uint8_t>> decoded[2];
+
+  for (int variant = 0; variant < 2; variant++) {
+    AtlasOptions opt;
+    opt.compress = variant == 1;
+    writeAtlas(opt);
+    TarotAtlas atlas;
+    TEST_ASSERT_TRUE(atlas.begin(&sd));
+
+    std::vector<uint8_t> buf(tarotBytes(TAROT_SIZE_1));
+    sd.resetStats();
+    const unsigned long start = micros();
+    for (int r = 0; r < rounds; r++) {
+      for (uint8_t s : sizes) {
+        for (uint8_t c = 0; c < MAJOR_ARCANA_COUNT; c++) {
+          TEST_ASSERT_TRUE(atlas.read(c, s, buf.data(), tarotBytes(s)));
+          if (r == 0) decoded[variant].emplace_back(buf.begin(), buf.begin() + tarotBytes(s));
+        }
+      }
+    }
+    results[variant].hostUs    = (double)(micros() - start) / rounds;
+    results[variant].cardBytes = sd.stats().bytesRead / rounds;
+  }
+  TEST_ASSERT_EQUAL(2 * MAJOR_ARCANA_COUNT, decoded[1].size());
+  TEST_ASSERT_TRUE(decoded[0] == decoded[1]);
+  TEST_ASSERT_LESS_THAN(results[0].cardBytes, results[1].cardBytes);
+
+  char line[160];
+  for (int variant = 0; variant < 2; variant++) {
+    const Result& r = results[variant];
+    snprintf(line, sizeof(line), "%-8s 44 assets: %6llu bytes from SD, %7.1f us on the bus, %7.1f us host read+decode",
+             variant ? "packbits" : "raw", (unsigned long long)r.cardBytes, r.cardBytes / busBytesUs, r.hostUs);
+    TEST_MESSAGE(line);
+  }
+  snprintf(line, sizeof(line), "packbits moves %.0f%% of the raw bytes", 100.0 * results[1].cardBytes / results[0].cardBytes);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_packbits_and_raw_cards_decode_to_the_same_bitmap);
+  RUN_TEST(test_read_rows_streams_every_row_once);
+  RUN_TEST(test_greyscale_rows_hold_both_planes);
+  RUN_TEST(test_card_info_comes_from_the_record);
+  RUN_TEST(test_bad_headers_are_rejected);
+  RUN_TEST(test_corrupt_packbits_data_fails_the_read);
+  RUN_TEST(test_benchmark_decode_vs_raw_read);
+  return UNITY_END();
+}
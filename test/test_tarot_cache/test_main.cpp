@@ -0,0 +1,214 @@
+// Host tests for TarotCache (src/tarot/tarotCache.cpp) on a RAM fs::FS
+// holding the per-card files. Run with: pio test -e native -f test_tarot_cache
+#include <unity.h>
+#include <FS.h>
+
+// Units under test, the native env doesn't build lib/ or src/
+#include <src/tarot/tarotCache.cpp>
+#include <src/tarot/tarotAtlas.cpp>
+#include <lib/pocketmage_perf/src/pocketmage_perf.cpp>
+
+bool SAVE_POWER = false;
+
+static fs::FS sd;
+
+// ===================== helpers =====================
+static uint8_t cardByte(uint8_t card, uint8_t size, size_t i) {
+  return (uint8_t)(card * 31 + size * 7 + i * 13);
+}
+
+static void writeCards(uint8_t count) {
+  for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+    for (uint8_t c = 0; c < count; c++) {
+      char path[32];
+      snprintf(path, sizeof(path), "/assets/tarot/%d/%s.bin", TAROT_SIZES[s].folder, TAROT_CARD_TABLE[c].code);
+      std::string data(tarotBytes(s), '\0');
+      for (size_t i = 0; i < data.size(); i++) data[i] = (char)cardByte(c, s, i);
+      sd.put(path, data);
+    }
+  }
+}
+
+static bool matches(const uint8_t* data, uint8_t card, uint8_t size) {
+  for (size_t i = 0; i < tarotBytes(size); i++) {
+    if (data[i] != cardByte(card, size, i)) return false;
+  }
+  return true;
+}
+
+// A fresh cache each test; never freed, its prefetch task may still hold it
+static TarotCache* newCache(bool psram) {
+  hostPsram = psram;
+  TarotCache* cache = new TarotCache();
+  TEST_ASSERT_TRUE(cache->begin(&sd));
+  return cache;
+}
+
+void setUp() {
+  sd.clear();
+  writeCards(MAJOR_ARCANA_COUNT);
+}
+
+void tearDown() {
+  hostPsram = true;
+}
+
+// ===================== tests =====================
+void test_resident_warm_serves_every_card_without_sd() {
+  TarotCache* cache = newCache(true);
+  TEST_ASSERT_TRUE(cache->isResident());
+  TEST_ASSERT_EQUAL(MAJOR_ARCANA_COUNT, cache->cardCount());
+
+  cache->warm();
+  sd.resetStats();
+  for (uint8_t s = 0; s < TAROT_SIZE_COUNT; s++) {
+    for (uint8_t c = 0; c < MAJOR_ARCANA_COUNT; c++) {
+      const uint8_t* data = cache->acquire(c, s);
+      TEST_ASSERT_NOT_NULL(data);
+      TEST_ASSERT_TRUE(matches(data, c, s));
+      cache->release();
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, sd.stats().opens);
+  TEST_ASSERT_EQUAL_UINT32(MAJOR_ARCANA_COUNT * TAROT_SIZE_COUNT, cache->hits());
+  TEST_ASSERT_EQUAL_UINT32(0, cache->misses());
+}
+
+void test_resident_loads_on_demand_before_warm() {
+  TarotCache* cache = newCache(true);
+  TEST_ASSERT_NOT_NULL(cache->acquire(3, TAROT_SIZE_3));
+  cache->release();
+  TEST_ASSERT_NOT_NULL(cache->acquire(3, TAROT_SIZE_3));
+  cache->release();
+  TEST_ASSERT_EQUAL_UINT32(1, cache->misses());
+  TEST_ASSERT_EQUAL_UINT32(1, cache->hits());
+  TEST_ASSERT_EQUAL_UINT32(1, sd.stats().opens);
+}
+
+void test_lru_evicts_least_recently_used() {
+  TarotCache* cache = newCache(false);
+  TEST_ASSERT_FALSE(cache->isResident());
+
+  auto touch = [&](uint8_t card) {
+    const uint8_t* data = cache->acquire(card, TAROT_SIZE_1);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_TRUE(matches(data, card, TAROT_SIZE_1));
+    cache->release();
+  };
+
+  // Fill every slot, then use card 0 again so card 1 is the oldest
+  for (uint8_t c = 0; c < TAROT_CACHE_LRU_SLOTS; c++) touch(c);
+  touch(0);
+  TEST_ASSERT_EQUAL_UINT32(TAROT_CACHE_LRU_SLOTS, cache->misses());
+  TEST_ASSERT_EQUAL_UINT32(1, cache->hits());
+
+  touch(TAROT_CACHE_LRU_SLOTS);  // evicts card 1
+  touch(0);
+  TEST_ASSERT_EQUAL_UINT32(2, cache->hits());
+  touch(1);
+  TEST_ASSERT_EQUAL_UINT32(TAROT_CACHE_LRU_SLOTS + 2, cache->misses());
+}
+
+void test_lru_keys_by_size_class() {
+  TarotCache* cache = newCache(false);
+  const uint8_t* big = cache->acquire(7, TAROT_SIZE_1);
+  TEST_ASSERT_TRUE(matches(big, 7, TAROT_SIZE_1));
+  cache->release();
+  const uint8_t* small = cache->acquire(7, TAROT_SIZE_3);
+  TEST_ASSERT_TRUE(matches(small, 7, TAROT_SIZE_3));
+  cache->release();
+  TEST_ASSERT_EQUAL_UINT32(2, cache->misses());
+}
+
+void test_prefetch_turns_the_next_draw_into_a_hit() {
+  TarotCache* cache = newCache(false);
+  const TarotCache::PrefetchItem items[] = { { 5, TAROT_SIZE_1 }, { 6, TAROT_SIZE_3 } };
+  sd.resetStats();
+  cache->prefetch(items, 2);
+
+  // The background task reads both cards on its own
+  const unsigned long start = millis();
+  while (sd.stats().opens < 2 && millis() - start < 2000) delay(1);
+  TEST_ASSERT_EQUAL_UINT32(2, sd.stats().opens);
+
+  for (const auto& item : items) {
+    const uint8_t* data = cache->acquire(item.card, item.size);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_TRUE(matches(data, item.card, item.size));
+    cache->release();
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, cache->hits());
+  TEST_ASSERT_EQUAL_UINT32(0, cache->misses());
+  TEST_ASSERT_EQUAL_UINT32(2, sd.stats().opens);
+}
+
+void test_prefetch_never_evicts_the_spread_just_drawn() {
+  TarotCache* cache = newCache(false);
+  auto draw = [&](uint8_t card, uint8_t size) {
+    const uint8_t* data = cache->acquire(card, size);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_TRUE(matches(data, card, size));
+    cache->release();
+  };
+  auto settle = [&](uint32_t opens) {
+    const unsigned long start = millis();
+    while (sd.stats().opens < opens && millis() - start < 2000) delay(1);
+    delay(50);  // anything past the expected reads would show up by now
+  };
+
+  // A spread filling all slots but one, then a full prefetch list
+  const uint8_t drawn = TAROT_CACHE_LRU_SLOTS - 1;
+  for (uint8_t c = 0; c < drawn; c++) draw(c, TAROT_SIZE_3);
+  const TarotCache::PrefetchItem items[] = {
+    { 10, TAROT_SIZE_1 }, { 11, TAROT_SIZE_3 }, { 12, TAROT_SIZE_3 }, { 13, TAROT_SIZE_3 } };
+  sd.resetStats();
+  cache->prefetch(items, 4);
+  settle(1);
+  // Only the free slot is filled, with the first item; one read, so nothing
+  // of the spread was evicted
+  TEST_ASSERT_EQUAL_UINT32(1, sd.stats().opens);
+  TEST_ASSERT_EQUAL_UINT32(drawn, cache->misses());
+
+  // Once the next spread (the prefetched card) is drawn, the old one is fair
+  // game for the rest of the list
+  draw(10, TAROT_SIZE_1);
+  sd.resetStats();
+  cache->prefetch(items + 1, 3);
+  settle(3);
+  TEST_ASSERT_EQUAL_UINT32(3, sd.stats().opens);
+  for (uint8_t i = 0; i < 4; i++) draw(items[i].card, items[i].size);
+  TEST_ASSERT_EQUAL_UINT32(drawn, cache->misses());
+  TEST_ASSERT_EQUAL_UINT32(3, sd.stats().opens);
+}
+
+void test_missing_card_fails_and_releases_the_lock() {
+  sd.remove("/assets/tarot/1/ar04.bin");
+  TarotCache* cache = newCache(false);
+  TEST_ASSERT_NULL(cache->acquire(4, TAROT_SIZE_1));
+  TEST_ASSERT_NULL(cache->acquire(MAJOR_ARCANA_COUNT, TAROT_SIZE_1));
+  // Would block forever if a failed acquire kept the lock
+  TEST_ASSERT_NOT_NULL(cache->acquire(5, TAROT_SIZE_1));
+  cache->release();
+}
+
+void test_card_info_from_flash_table() {
+  TarotCache* cache = newCache(true);
+  TarotCardInfo info;
+  TEST_ASSERT_TRUE(cache->cardInfo(0, info));
+  TEST_ASSERT_EQUAL_STRING("ar00", info.code);
+  TEST_ASSERT_EQUAL_STRING("The Fool", info.name);
+  TEST_ASSERT_FALSE(cache->cardInfo(MAJOR_ARCANA_COUNT, info));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_resident_warm_serves_every_card_without_sd);
+  RUN_TEST(test_resident_loads_on_demand_before_warm);
+  RUN_TEST(test_lru_evicts_least_recently_used);
+  RUN_TEST(test_lru_keys_by_size_class);
+  RUN_TEST(test_prefetch_turns_the_next_draw_into_a_hit);
+  RUN_TEST(test_prefetch_never_evicts_the_spread_just_drawn);
+  RUN_TEST(test_missing_card_fails_and_releases_the_lock);
+  RUN_TEST(test_card_info_from_flash_table);
+  return UNITY_END();
+}
@@ -0,0 +1,196 @@
+// Host tests for TarotDeck (src/tarot/tarotDeck.cpp): statistical checks
+// that uniform() and shuffle() are unbiased, plus drawing, peeking and NVS
+// persistence. esp_random() is seeded, so the statistics are repeatable.
+// Run with: pio test -e native -f test_tarot_deck
+#include <unity.h>
+#include <math.h>
+#include <vector>
+
+// Units under test, the native env doesn't build src/
+#include <src/tarot/tarotDeck.cpp>
+
+Preferences prefs;
+
+// ===================== helpers =====================
+// Chi-square critical value for df degrees of freedom at p = 0.001
+// (Wilson-Hilferty), so a correct implementation fails one run in 1000
+static double chiSquareLimit(unsigned df) {
+  const double z = 3.09;
+  const double k = 2.0 / (9.0 * df);
+  return df * pow(1.0 - k + z * sqrt(k), 3);
+}
+
+static double chiSquare(const std::vector<uint32_t>& counts, double expected) {
+  double chi = 0;
+  for (uint32_t c : counts) chi += (c - expected) * (c - expected) / expected;
+  return chi;
+}
+
+void setUp() {
+  hostRandomSeed(20250101);
+  Preferences::hostReset();
+}
+
+void tearDown() {}
+
+// ===================== uniform =====================
+void test_uniform_is_flat_for_deck_sizes() {
+  for (uint32_t n : { 3u, 22u, 78u }) {
+    const uint32_t samples = n * 2000;
+    std::vector<uint32_t> counts(n, 0);
+    for (uint32_t i = 0; i < samples; i++) {
+      const uint32_t r = TarotDeck::uniform(n);
+      TEST_ASSERT_LESS_THAN(n, r);
+      counts[r]++;
+    }
+    TEST_ASSERT_LESS_THAN_FLOAT(chiSquareLimit(n - 1), chiSquare(counts, 2000.0));
+  }
+}
+
+// With n = 3 * 2^30 a plain esp_random() % n hits [0, 2^30) twice as often
+// as the other two thirds; rejection sampling must even that out
+void test_uniform_has_no_modulo_bias() {
+  const uint32_t n = 0xC0000000u;
+  std::vector<uint32_t> thirds(3, 0);
+  const uint32_t samples = 30000;
+  for (uint32_t i = 0; i < samples; i++) thirds[TarotDeck::uniform(n) >> 30]++;
+  TEST_ASSERT_LESS_THAN_FLOAT(chiSquareLimit(2), chiSquare(thirds, samples / 3.0));
+}
+
+void test_uniform_of_zero_or_one_is_zero() {
+  TEST_ASSERT_EQUAL_UINT32(0, TarotDeck::uniform(0));
+  TEST_ASSERT_EQUAL_UINT32(0, TarotDeck::uniform(1));
+}
+
+// ===================== shuffle =====================
+void test_shuffle_puts_every_card_in_every_slot_equally() {
+  const uint8_t  n      = MAJOR_ARCANA_COUNT;
+  const uint32_t rounds = n * 500;
+  std::vector<uint32_t> counts((size_t)n * n, 0);
+  TarotDeck deck;
+  for (uint32_t r = 0; r < rounds; r++) {
+    deck.shuffle(n);
+    bool seen[n] = {};
+    for (uint8_t slot = 0; slot < n; slot++) {
+      TarotDeck::Card card;
+      TEST_ASSERT_TRUE(deck.draw(card));
+      TEST_ASSERT_FALSE(seen[card.index]);
+      seen[card.index] = true;
+      counts[(size_t)slot * n + card.index]++;
+    }
+  }
+  // Each (slot, card) cell is a multinomial count with (n-1)^2 free cells
+  TEST_ASSERT_LESS_THAN_FLOAT(chiSquareLimit((n - 1) * (n - 1)), chiSquare(counts, rounds / (double)n));
+}
+
+void test_reversals_are_a_fair_coin_and_can_be_disabled() {
+  TarotDeck deck;
+  uint32_t reversed = 0, total = 0;
+  for (int r = 0; r < 1000; r++) {
+    deck.shuffle(TAROT_MAX_CARDS);
+    TarotDeck::Card card;
+    while (deck.draw(card)) {
+      reversed += card.reversed;
+      total++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000u * TAROT_MAX_CARDS, total);
+  // 78000 fair coin flips: 4 sigma is about 700
+  TEST_ASSERT_UINT32_WITHIN(700, total / 2, reversed);
+
+  deck.setAllowReversed(false);
+  deck.shuffle(TAROT_MAX_CARDS);
+  TarotDeck::Card card;
+  while (deck.draw(card)) TEST_ASSERT_FALSE(card.reversed);
+}
+
+// ===================== draw =====================
+void test_draw_and_peek() {
+  TarotDeck deck;
+  deck.shuffle(10);
+  TEST_ASSERT_EQUAL(10, deck.size());
+  TEST_ASSERT_EQUAL(10, deck.remaining());
+
+  TarotDeck::Card ahead[3];
+  for (uint8_t i = 0; i < 3; i++) TEST_ASSERT_TRUE(deck.peek(i, ahead[i]));
+  TEST_ASSERT_FALSE(deck.peek(10, ahead[0]));
+  for (uint8_t i = 0; i < 3; i++) {
+    TarotDeck::Card card;
+    TEST_ASSERT_TRUE(deck.draw(card));
+    TEST_ASSERT_EQUAL(ahead[i].index, card.index);
+    TEST_ASSERT_EQUAL(ahead[i].reversed, card.reversed);
+  }
+  TEST_ASSERT_EQUAL(7, deck.remaining());
+
+  TarotDeck::Card card;
+  for (uint8_t i = 0; i < 7; i++) TEST_ASSERT_TRUE(deck.draw(card));
+  TEST_ASSERT_FALSE(deck.draw(card));
+  TEST_ASSERT_FALSE(deck.peek(0, card));
+}
+
+void test_shuffle_is_capped_at_the_full_deck() {
+  TarotDeck deck;
+  deck.shuffle(255);
+  TEST_ASSERT_EQUAL(TAROT_MAX_CARDS, deck.size());
+}
+
+// ===================== persistence =====================
+void test_saved_deck_resumes_where_it_left_off() {
+  TarotDeck deck;
+  deck.shuffle(MAJOR_ARCANA_COUNT);
+  TarotDeck::Card card;
+  for (int i = 0; i < 5; i++) deck.draw(card);
+  deck.save();
+
+  TarotDeck restored;
+  TEST_ASSERT_TRUE(restored.load(MAJOR_ARCANA_COUNT));
+  TEST_ASSERT_EQUAL(deck.remaining(), restored.remaining());
+  TarotDeck::Card a, b;
+  while (deck.draw(a)) {
+    TEST_ASSERT_TRUE(restored.draw(b));
+    TEST_ASSERT_EQUAL(a.index, b.index);
+    TEST_ASSERT_EQUAL(a.reversed, b.reversed);
+  }
+  TEST_ASSERT_FALSE(restored.draw(b));
+}
+
+void test_load_rejects_other_sizes_and_corrupt_decks() {
+  TarotDeck deck;
+  TEST_ASSERT_FALSE(deck.load(MAJOR_ARCANA_COUNT));  // nothing saved
+
+  deck.shuffle(MAJOR_ARCANA_COUNT);
+  deck.save();
+  TEST_ASSERT_FALSE(deck.load(TAROT_MAX_CARDS));     // saved before the atlas
+  TEST_ASSERT_FALSE(deck.load(0));
+
+  // A repeated card is not a permutation
+  uint8_t order[MAJOR_ARCANA_COUNT];
+  prefs.begin("tarot", false);
+  prefs.getBytes("order", order, sizeof(order));
+  order[1] = order[0];
+  prefs.putBytes("order", order, sizeof(order));
+  prefs.end();
+  TEST_ASSERT_FALSE(deck.load(MAJOR_ARCANA_COUNT));
+
+  // Top past the end
+  deck.shuffle(MAJOR_ARCANA_COUNT);
+  deck.save();
+  prefs.begin("tarot", false);
+  prefs.putUChar("top", MAJOR_ARCANA_COUNT + 1);
+  prefs.end();
+  TEST_ASSERT_FALSE(deck.load(MAJOR_ARCANA_COUNT));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_uniform_is_flat_for_deck_sizes);
+  RUN_TEST(test_uniform_has_no_modulo_bias);
+  RUN_TEST(test_uniform_of_zero_or_one_is_zero);
+  RUN_TEST(test_shuffle_puts_every_card_in_every_slot_equally);
+  RUN_TEST(test_reversals_are_a_fair_coin_and_can_be_disabled);
+  RUN_TEST(test_draw_and_peek);
+  RUN_TEST(test_shuffle_is_capped_at_the_full_deck);
+  RUN_TEST(test_saved_deck_resumes_where_it_left_off);
+  RUN_TEST(test_load_rejects_other_sizes_and_corrupt_decks);
+  return UNITY_END();
+}
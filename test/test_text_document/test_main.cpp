@@ -0,0 +1,178 @@
+// Host tests for TextDocument (lib/pocketmage_text/src/pocketmage_text.cpp):
+// random edits checked against a std::string, save tracking, and line views
+// that straddle the gap.
+// Run with: pio test -e native -f test_text_document
+#include <unity.h>
+#include <random>
+#include <string>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_text/src/pocketmage_text.cpp>
+
+// ===================== helpers =====================
+// One line per '\n'-terminated run, blank lines kept
+static void splitLines(const char* text, size_t length, const TextDocument::SpanFn& emit) {
+  size_t start = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] != '\n') continue;
+    emit(start, i - start);
+    start = i + 1;
+  }
+  if (start < length) emit(start, length - start);
+}
+
+static std::string contents(const TextDocument& doc) {
+  std::string out;
+  for (size_t i = 0; i < doc.length(); i++) out += doc.charAt(i);
+  return out;
+}
+
+static std::string lineText(const TextLine& line) {
+  std::string out;
+  for (size_t i = 0; i < line.size(); i++) out += line.charAt(i);
+  return out;
+}
+
+void setUp() {
+  hostPsram = true;
+}
+
+void tearDown() {}
+
+// ===================== tests =====================
+void test_random_edits_match_a_string() {
+  for (bool psram : { true, false }) {
+    hostPsram = psram;
+    std::mt19937 rng(psram ? 1 : 2);
+    TextDocument doc;
+    std::string model;
+    for (int step = 0; step < 5000; step++) {
+      const size_t pos = model.empty() ? 0 : rng() % (model.size() + 1);
+      if (rng() % 3) {
+        std::string piece(1 + rng() % 40, 'a' + rng() % 26);
+        if (rng() % 5 == 0) piece += '\n';
+        TEST_ASSERT_TRUE(doc.insert(pos, piece.data(), piece.size()));
+        model.insert(pos, piece);
+      }
+      else {
+        const size_t n = rng() % 30;
+        doc.erase(pos, n);
+        if (pos < model.size()) model.erase(pos, n);
+      }
+      TEST_ASSERT_EQUAL(model.size(), doc.length());
+    }
+    TEST_ASSERT_TRUE(contents(doc) == model);
+    TEST_ASSERT_EQUAL_STRING(model.c_str(), doc.text());
+  }
+}
+
+void test_out_of_range_edits_are_clamped() {
+  TextDocument doc;
+  TEST_ASSERT_TRUE(doc.load("abc", 3));
+  TEST_ASSERT_TRUE(doc.insert(100, "d", 1));
+  doc.erase(10, 5);
+  doc.erase(2, 100);
+  TEST_ASSERT_EQUAL_STRING("ab", doc.text());
+  TEST_ASSERT_EQUAL('\0', doc.charAt(2));
+  TEST_ASSERT_TRUE(doc.insert(0, nullptr, 5));
+  TEST_ASSERT_EQUAL(2, doc.length());
+}
+
+void test_dirty_from_is_the_first_edit_since_saved() {
+  TextDocument doc;
+  const std::string text(1000, 'x');
+  doc.load(text.data(), text.size());
+  TEST_ASSERT_TRUE(doc.dirty());
+  TEST_ASSERT_EQUAL(0, doc.dirtyFrom());
+
+  doc.markSaved();
+  TEST_ASSERT_FALSE(doc.dirty());
+  doc.append("tail", 4);
+  TEST_ASSERT_EQUAL(1000, doc.dirtyFrom());
+  doc.insert(500, "mid", 3);
+  doc.insert(900, "late", 4);
+  TEST_ASSERT_EQUAL(500, doc.dirtyFrom());
+
+  // Reading or reflowing is not an edit
+  doc.markSaved();
+  doc.text();
+  doc.reflow(splitLines);
+  TEST_ASSERT_FALSE(doc.dirty());
+  // Past the end after an erase, clamped to the length
+  doc.markSaved();
+  doc.erase(990, 100);
+  TEST_ASSERT_EQUAL(990, doc.dirtyFrom());
+}
+
+void test_lines_read_across_the_gap() {
+  TextDocument doc;
+  const std::string text = "first line\nsecond line\n\nfourth\nfifth and last";
+  doc.load(text.data(), text.size());
+  doc.reflow(splitLines);
+  TEST_ASSERT_EQUAL(5, doc.size());
+
+  const char* expected[] = { "first line", "second line", "", "fourth", "fifth and last" };
+  // Park the gap at every position: an empty erase moves it, text unchanged
+  for (size_t pos = 0; pos <= text.size(); pos++) {
+    doc.erase(pos, 0);
+    for (size_t i = 0; i < doc.size(); i++) {
+      const TextLine line = doc.line(i);
+      TEST_ASSERT_EQUAL_STRING(expected[i], lineText(line).c_str());
+    }
+  }
+
+  // A line split by the gap comes in two parts
+  doc.erase(3, 0);
+  const TextLine first = doc.line(0);
+  TEST_ASSERT_EQUAL(3, first.length);
+  TEST_ASSERT_EQUAL(7, first.tailLength);
+  TEST_ASSERT_TRUE(first.startsWith("first l"));
+  TEST_ASSERT_FALSE(first.startsWith("first line!"));
+  char buf[8];
+  TEST_ASSERT_EQUAL(7, first.copy(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_STRING("first l", buf);
+  TEST_ASSERT_EQUAL(4, first.copy(buf, sizeof(buf), 6));
+  TEST_ASSERT_EQUAL_STRING("line", buf);
+
+  TEST_ASSERT_EQUAL(0, doc.line(5).size());
+}
+
+void test_reflow_after_edits() {
+  TextDocument doc;
+  doc.load("one\ntwo\nthree", 13);
+  doc.reflow(splitLines);
+  doc.insert(4, "2a\n", 3);
+  doc.erase(0, 4);
+  doc.reflow(splitLines);
+  TEST_ASSERT_EQUAL(3, doc.size());
+  TEST_ASSERT_EQUAL_STRING("2a", lineText(doc.line(0)).c_str());
+  TEST_ASSERT_EQUAL_STRING("two", lineText(doc.line(1)).c_str());
+  TEST_ASSERT_EQUAL_STRING("three", lineText(doc.line(2)).c_str());
+}
+
+void test_large_document_grows_in_place() {
+  TextDocument doc;
+  std::string model;
+  const std::string line = "a line of a long note, typed one character at a time\n";
+  // Typing at the end, the way the editor fills a document
+  for (int i = 0; i < 20000; i++) {
+    for (char c : line) TEST_ASSERT_TRUE(doc.insert(doc.length(), c));
+    model += line;
+  }
+  TEST_ASSERT_EQUAL(model.size(), doc.length());
+  doc.reflow(splitLines);
+  TEST_ASSERT_EQUAL(20000, doc.size());
+  TEST_ASSERT_EQUAL_STRING(line.substr(0, line.size() - 1).c_str(), lineText(doc.line(19999)).c_str());
+  TEST_ASSERT_TRUE(model == doc.text());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_random_edits_match_a_string);
+  RUN_TEST(test_out_of_range_edits_are_clamped);
+  RUN_TEST(test_dirty_from_is_the_first_edit_since_saved);
+  RUN_TEST(test_lines_read_across_the_gap);
+  RUN_TEST(test_reflow_after_edits);
+  RUN_TEST(test_large_document_grows_in_place);
+  return UNITY_END();
+}
@@ -0,0 +1,345 @@
+// Host tests for TextJournal (lib/pocketmage_text/src/pocketmage_journal.cpp)
+// on a RAM fs::FS: appends, journal records and their replay, torn records,
+// a file changed behind the journal's back, and compaction. The last test
+// prints the bytes a typing session writes against rewriting the file.
+// Run with: pio test -e native -f test_text_journal [-v]
+#include <unity.h>
+#include <FS.h>
+#include <random>
+#include <string>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_text/src/pocketmage_text.cpp>
+#include <lib/pocketmage_text/src/pocketmage_journal.cpp>
+
+static fs::FS sd;
+
+static const char* notePath    = "/notes/today.txt";
+static const char* journalPath = "/notes/today.txt.jnl";
+static const char* tempPath    = "/notes/today.txt.tmp";
+
+// ===================== helpers =====================
+static std::string text(TextDocument& doc) {
+  return std::string(doc.text(), doc.length());
+}
+
+// What the next session sees: a fresh journal and document on the same card
+static std::string reload() {
+  TextJournal journal;
+  TextDocument doc;
+  TEST_ASSERT_TRUE(journal.load(sd, notePath, doc));
+  TEST_ASSERT_FALSE(doc.dirty());
+  return text(doc);
+}
+
+static void insert(TextDocument& doc, std::string& model, size_t pos, const std::string& s) {
+  TEST_ASSERT_TRUE(doc.insert(pos, s.data(), s.size()));
+  model.insert(pos, s);
+}
+
+void setUp() {
+  sd.clear();
+  sd.mkdir("/notes");
+}
+
+void tearDown() {
+  sd.setWriteBudget(SIZE_MAX);
+}
+
+// ===================== tests =====================
+void test_typing_at_the_end_appends_to_the_file() {
+  sd.put(notePath, "Dear diary,");
+  TextJournal journal;
+  TextDocument doc;
+  TEST_ASSERT_TRUE(journal.load(sd, notePath, doc));
+  TEST_ASSERT_EQUAL_STRING(notePath, journal.path().c_str());
+
+  sd.resetStats();
+  doc.append(" today", 6);
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  doc.append(" the tower fell.", 16);
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  // Only the new text, no journal
+  TEST_ASSERT_EQUAL_UINT32(22, (uint32_t)sd.stats().bytesWritten);
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_TRUE(sd.contents(notePath) == "Dear diary, today the tower fell.");
+
+  // Nothing changed, nothing written
+  sd.resetStats();
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_EQUAL_UINT32(0, sd.stats().opens);
+}
+
+void test_edit_mid_text_goes_to_the_journal_and_replays() {
+  const std::string base(4000, 'a');
+  sd.put(notePath, base);
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+
+  std::string model = base;
+  insert(doc, model, 100, "EDIT");
+  sd.resetStats();
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  // Header, record and the text after the edit; the file itself is untouched
+  TEST_ASSERT_EQUAL_UINT32(12 + 12 + model.size() - 100, (uint32_t)sd.stats().bytesWritten);
+  TEST_ASSERT_TRUE(sd.contents(notePath) == base);
+  TEST_ASSERT_TRUE(sd.exists(journalPath));
+
+  // Once a journal exists, typing at the end adds records to it
+  insert(doc, model, model.size(), " and more");
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_EQUAL(12 + 12 + 3904 + 12 + 9, sd.contents(journalPath).size());
+  TEST_ASSERT_TRUE(reload() == model);
+}
+
+void test_random_edits_survive_a_reload() {
+  std::mt19937 rng(7);
+  std::string model = "A first line.\n";
+  sd.put(notePath, model);
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+
+  for (int save = 0; save < 300; save++) {
+    for (int edit = rng() % 4; edit >= 0; edit--) {
+      const size_t pos = rng() % 4 ? model.size() : rng() % (model.size() + 1);
+      if (rng() % 5 == 0 && !model.empty()) {
+        const size_t n = 1 + rng() % 20;
+        doc.erase(pos, n);
+        if (pos < model.size()) model.erase(pos, n);
+      }
+      else {
+        insert(doc, model, pos, std::string(1 + rng() % 60, 'a' + rng() % 26) + (rng() % 4 ? " " : "\n"));
+      }
+    }
+    TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+    if (save % 25 == 0) TEST_ASSERT_TRUE(reload() == model);
+  }
+  TEST_ASSERT_TRUE(reload() == model);
+
+  // Reloading leaves a journal that keeps working
+  TEST_ASSERT_TRUE(journal.load(sd, notePath, doc));
+  insert(doc, model, 0, "Title\n");
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(reload() == model);
+}
+
+void test_torn_record_is_dropped_and_compacted() {
+  sd.put(notePath, "0123456789");
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+
+  doc.insert(5, "ab", 2);
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  const std::string saved = text(doc);
+
+  // The card fills up halfway through the next record; the compaction that
+  // follows can't be written either
+  doc.insert(0, "LOST", 4);
+  sd.setWriteBudget(16);
+  TEST_ASSERT_FALSE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(journal.path() == "");
+  TEST_ASSERT_FALSE(sd.exists(tempPath));
+  sd.setWriteBudget(SIZE_MAX);
+
+  // The first record still replays, the torn one is cut off
+  TEST_ASSERT_TRUE(reload() == saved);
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_TRUE(sd.contents(notePath) == saved);
+}
+
+void test_failed_append_falls_back_to_a_full_write() {
+  sd.put(notePath, "start");
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+
+  doc.append(" of a long line", 15);
+  sd.setWriteBudget(4);
+  TEST_ASSERT_FALSE(journal.save(sd, notePath, doc));
+  // Part of the tail is on the card, the length on record no longer holds
+  TEST_ASSERT_TRUE(journal.path() == "");
+  sd.setWriteBudget(SIZE_MAX);
+
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(sd.contents(notePath) == "start of a long line");
+}
+
+void test_journal_for_a_changed_file_is_discarded() {
+  sd.put(notePath, "the original text");
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+  doc.insert(4, "very ", 5);
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(sd.exists(journalPath));
+
+  // Edited on a PC: same length, different bytes
+  sd.put(notePath, "the modified text");
+  TEST_ASSERT_TRUE(reload() == "the modified text");
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+
+  // A journal with a broken header goes the same way
+  sd.put(journalPath, "junk");
+  TEST_ASSERT_TRUE(reload() == "the modified text");
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+}
+
+void test_journal_is_compacted_once_it_outgrows_the_document() {
+  const std::string base(40000, 'b');
+  sd.put(notePath, base);
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+
+  // Edits near the start rewrite most of the text each time
+  std::string model = base;
+  insert(doc, model, 30000, "x");
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(sd.exists(journalPath));
+  insert(doc, model, 10, "y");
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_FALSE(sd.exists(tempPath));
+  TEST_ASSERT_TRUE(sd.contents(notePath) == model);
+
+  // Compacted, so the next append goes to the file again
+  insert(doc, model, model.size(), "z");
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_TRUE(reload() == model);
+}
+
+void test_flush_brings_the_file_up_to_date() {
+  sd.put(notePath, "abc");
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+  doc.insert(1, "X", 1);
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(sd.contents(notePath) == "abc");
+
+  doc.insert(0, "Y", 1);
+  TEST_ASSERT_TRUE(journal.flush(sd, notePath, doc));
+  TEST_ASSERT_TRUE(sd.contents(notePath) == "YaXbc");
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_FALSE(doc.dirty());
+
+  // Already up to date, or not ours: nothing is written
+  sd.resetStats();
+  TEST_ASSERT_TRUE(journal.flush(sd, notePath, doc));
+  TEST_ASSERT_TRUE(journal.flush(sd, "/notes/other.txt", doc));
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)sd.stats().bytesWritten);
+  TEST_ASSERT_FALSE(sd.exists("/notes/other.txt"));
+}
+
+void test_rename_and_remove_keep_the_journal_with_its_file() {
+  sd.put(notePath, "abc");
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+  doc.insert(0, "new ", 4);
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+
+  sd.rename(notePath, "/notes/moved.txt");
+  TextJournal::rename(sd, notePath, "/notes/moved.txt");
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_TRUE(journal.load(sd, "/notes/moved.txt", doc));
+  TEST_ASSERT_TRUE(text(doc) == "new abc");
+
+  // A save to a path the journal doesn't track writes the whole file
+  journal.forget("/notes/moved.txt");
+  TEST_ASSERT_TRUE(journal.path() == "");
+  TEST_ASSERT_TRUE(journal.save(sd, "/notes/moved.txt", doc));
+  TEST_ASSERT_TRUE(sd.contents("/notes/moved.txt") == "new abc");
+  TEST_ASSERT_FALSE(sd.exists("/notes/moved.txt.jnl"));
+
+  sd.put("/notes/moved.txt.jnl", "stale");
+  TextJournal::remove(sd, "/notes/moved.txt");
+  TEST_ASSERT_FALSE(sd.exists("/notes/moved.txt.jnl"));
+}
+
+void test_interrupted_compaction_is_recovered() {
+  // Power cut after the old file was removed, before the rename
+  sd.put(tempPath, "the compacted text");
+  TEST_ASSERT_TRUE(reload() == "the compacted text");
+  TEST_ASSERT_FALSE(sd.exists(tempPath));
+
+  sd.clear();
+  TextJournal journal;
+  TextDocument doc;
+  TEST_ASSERT_FALSE(journal.load(sd, notePath, doc));
+  TEST_ASSERT_TRUE(journal.path() == "");
+  TEST_ASSERT_EQUAL(0, doc.length());
+}
+
+void test_journal_left_by_an_interrupted_compaction_is_not_replayed() {
+  const std::string base(4000, 'a');
+  sd.put(notePath, base);
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+  std::string model = base;
+  insert(doc, model, 100, "the tower fell");
+  TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+  TEST_ASSERT_TRUE(sd.exists(journalPath));
+
+  // Power cut mid-compaction: the new text is in the temp file, the old file
+  // is gone and the journal written against it is still there
+  sd.put(tempPath, model);
+  sd.remove(notePath);
+  TEST_ASSERT_TRUE(reload() == model);
+  TEST_ASSERT_FALSE(sd.exists(journalPath));
+  TEST_ASSERT_TRUE(reload() == model);
+}
+
+// ===================== benchmark =====================
+// A 20 KB note, then a session of typing with an occasional edit further
+// up, saved after every few words
+void test_benchmark_bytes_written_per_session() {
+  std::mt19937 rng(3);
+  std::string model;
+  while (model.size() < 20000) model += "an older paragraph of the note, ";
+  sd.put(notePath, model);
+  TextJournal journal;
+  TextDocument doc;
+  journal.load(sd, notePath, doc);
+
+  sd.resetStats();
+  uint32_t rewrite = 0;
+  const int saves = 200;
+  for (int save = 0; save < saves; save++) {
+    const size_t pos = rng() % 10 ? model.size() : model.size() - rng() % 2000;
+    insert(doc, model, pos, "a few new words ");
+    TEST_ASSERT_TRUE(journal.save(sd, notePath, doc));
+    rewrite += model.size();
+  }
+  TEST_ASSERT_TRUE(reload() == model);
+  const uint32_t written = (uint32_t)sd.stats().bytesWritten;
+  TEST_ASSERT_LESS_THAN_UINT32(rewrite / 10, written);
+
+  char line[112];
+  snprintf(line, sizeof(line), "%d saves: %u bytes through the journal, %u rewriting the file each time", saves,
+           (unsigned)written, (unsigned)rewrite);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_typing_at_the_end_appends_to_the_file);
+  RUN_TEST(test_edit_mid_text_goes_to_the_journal_and_replays);
+  RUN_TEST(test_random_edits_survive_a_reload);
+  RUN_TEST(test_torn_record_is_dropped_and_compacted);
+  RUN_TEST(test_failed_append_falls_back_to_a_full_write);
+  RUN_TEST(test_journal_for_a_changed_file_is_discarded);
+  RUN_TEST(test_journal_is_compacted_once_it_outgrows_the_document);
+  RUN_TEST(test_flush_brings_the_file_up_to_date);
+  RUN_TEST(test_rename_and_remove_keep_the_journal_with_its_file);
+  RUN_TEST(test_interrupted_compaction_is_recovered);
+  RUN_TEST(test_journal_left_by_an_interrupted_compaction_is_not_replayed);
+  RUN_TEST(test_benchmark_bytes_written_per_session);
+  return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// Host tests for TextWrap (lib/pocketmage_eink/src/pocketmage_textwrap.cpp)
+// against a port of the old stringToVector() loop, and a benchmark that
+// wraps a 100 KB note with both.
+// Run with: pio test -e native -f test_text_wrap [-v]
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <Fonts/FreeMonoBold9pt7b.h>
+#include <Fonts/FreeSerif9pt7b.h>
+
+// Units under test, the native env doesn't build lib/
+#include <lib/pocketmage_eink/src/pocketmage_textwrap.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_fontmetrics.cpp>
+#include <lib/pocketmage_eink/src/pocketmage_displaylist.cpp>
+
+// stringToVector() wraps at display.width() - 5
+static constexpr uint16_t maxWidth = 320 - 5;
+
+// ===================== helpers =====================
+static std::vector<std::string> wrap(const std::string& text, const GFXfont* font, uint16_t width = maxWidth) {
+  std::vector<std::string> lines;
+  TextWrap::wrap(text.c_str(), text.size(), FontMetrics::of(font), width,
+                 [&](size_t offset, size_t length) { lines.emplace_back(text, offset, length); });
+  return lines;
+}
+
+// The old stringToVector() loop, measuring the line so far before every
+// character. measure(line) is getTextBounds() on the device.
+template <typename Measure>
+static std::vector<String> oldWrap(const String& inputText, Measure measure, uint16_t width = maxWidth) {
+  std::vector<String> allLines;
+  String currentLine_;
+  for (size_t i = 0; i < inputText.length(); i++) {
+    char c = inputText[i];
+    if ((c == '\n' || measure(currentLine_) >= width) && !currentLine_.isEmpty()) {
+      if (currentLine_.endsWith(" ")) {
+        allLines.push_back(currentLine_);
+        currentLine_ = "";
+      }
+      else {
+        int lastSpace = currentLine_.lastIndexOf(' ');
+        if (lastSpace != -1) {
+          String partialWord = currentLine_.substring(lastSpace + 1);
+          currentLine_ = currentLine_.substring(0, lastSpace);
+          allLines.push_back(currentLine_);
+          currentLine_ = partialWord;
+        }
+        else {
+          allLines.push_back(currentLine_);
+          currentLine_ = "";
+        }
+      }
+    }
+    if (c != '\n') currentLine_ += c;
+  }
+  if (!currentLine_.isEmpty()) allLines.push_back(currentLine_);
+  return allLines;
+}
+
+static auto advanceOf(const GFXfont* font) {
+  const FontMetrics* metrics = &FontMetrics::of(font);
+  return [metrics](const String& s) { return metrics->textWidth(s); };
+}
+
+static auto inkBoundsOf(const GFXfont* font) {
+  return [font](const String& s) {
+    int16_t x, y, w, h;
+    EinkDisplayList::textBounds(font, 1, s.c_str(), 0, 0, x, y, w, h);
+    return (uint16_t)w;
+  };
+}
+
+// Words of varied length, now and then a word longer than a line, and
+// paragraphs ending in '\n' (some followed by a blank line)
+static std::string makeNote(size_t bytes, uint32_t seed, bool newlines = true) {
+  static const char* words[] = { "the", "card", "of", "a", "tower", "reversed", "upheaval", "sudden",
+                                 "change", "in", "wands", "cups", "swords", "pentacles", "I", "moon" };
+  std::mt19937 rng(seed);
+  std::string note;
+  while (note.size() < bytes) {
+    const uint32_t r = rng() % 100;
+    if (r < 2) note += std::string(20 + rng() % 40, 'x');
+    else       note += words[rng() % 16];
+    const uint32_t gap = rng() % 40;
+    if (newlines && gap == 0)      note += "\n\n";
+    else if (newlines && gap == 1) note += "\n";
+    else                           note += ' ';
+  }
+  note.resize(bytes);
+  return note;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// ===================== tests =====================
+void test_soft_wraps_match_the_old_loop() {
+  for (const GFXfont* font : { &FreeMonoBold9pt7b, &FreeSerif9pt7b }) {
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+      const std::string note = makeNote(4000, seed, false);
+      const std::vector<std::string> lines = wrap(note, font);
+      const std::vector<String> old = oldWrap(String(note), advanceOf(font));
+      TEST_ASSERT_EQUAL(old.size(), lines.size());
+      for (size_t i = 0; i < lines.size(); i++) TEST_ASSERT_EQUAL_STRING(old[i].c_str(), lines[i].c_str());
+    }
+  }
+}
+
+void test_hard_break_keeps_the_line_as_it_stands() {
+  const std::vector<std::string> lines = wrap("hello world\nfoo", &FreeMonoBold9pt7b);
+  TEST_ASSERT_EQUAL(2, lines.size());
+  TEST_ASSERT_EQUAL_STRING("hello world", lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("foo", lines[1].c_str());
+}
+
+void test_blank_lines_are_skipped() {
+  const std::vector<std::string> lines = wrap("a\n\n\nb\n", &FreeMonoBold9pt7b);
+  TEST_ASSERT_EQUAL(2, lines.size());
+  TEST_ASSERT_EQUAL_STRING("a", lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("b", lines[1].c_str());
+  TEST_ASSERT_EQUAL(0, wrap("", &FreeMonoBold9pt7b).size());
+  TEST_ASSERT_EQUAL(0, wrap("\n\n", &FreeMonoBold9pt7b).size());
+}
+
+void test_word_without_spaces_breaks_mid_word() {
+  const FontMetrics& metrics = FontMetrics::of(&FreeMonoBold9pt7b);
+  const uint8_t advance = metrics.charWidth('x');
+  // 10 characters reach the width, the 11th starts a new line
+  const std::vector<std::string> lines = wrap(std::string(25, 'x'), &FreeMonoBold9pt7b, 10 * advance);
+  TEST_ASSERT_EQUAL(3, lines.size());
+  TEST_ASSERT_EQUAL(10, lines[0].size());
+  TEST_ASSERT_EQUAL(10, lines[1].size());
+  TEST_ASSERT_EQUAL(5, lines[2].size());
+}
+
+void test_split_at_last_space_and_trailing_space() {
+  const uint8_t advance = FontMetrics::of(&FreeMonoBold9pt7b).charWidth('a');
+  const uint16_t width = 10 * advance;
+  // The word in progress moves down, the space it split at is dropped
+  std::vector<std::string> lines = wrap("aaaa bbbbbbbbb", &FreeMonoBold9pt7b, width);
+  TEST_ASSERT_EQUAL(2, lines.size());
+  TEST_ASSERT_EQUAL_STRING("aaaa", lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("bbbbbbbbb", lines[1].c_str());
+  // A line that fills up on a space keeps it
+  lines = wrap("aaaaaaaaa bbb", &FreeMonoBold9pt7b, width);
+  TEST_ASSERT_EQUAL(2, lines.size());
+  TEST_ASSERT_EQUAL_STRING("aaaaaaaaa ", lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("bbb", lines[1].c_str());
+}
+
+void test_spans_cover_the_text_in_order() {
+  const std::string note = makeNote(20000, 7);
+  size_t next = 0;
+  TextWrap::wrap(note.c_str(), note.size(), FontMetrics::of(&FreeSerif9pt7b), maxWidth, [&](size_t offset, size_t length) {
+    TEST_ASSERT_GREATER_OR_EQUAL(next, offset);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    // Only newlines and the space a line was split at are left out
+    for (size_t i = next; i < offset; i++) TEST_ASSERT_TRUE(note[i] == '\n' || note[i] == ' ');
+    const uint16_t width = FontMetrics::of(&FreeSerif9pt7b).textWidth(note.c_str() + offset, length);
+    TEST_ASSERT_LESS_THAN(maxWidth + 2 * 16, width);
+    next = offset + length;
+  });
+  for (size_t i = next; i < note.size(); i++) TEST_ASSERT_TRUE(note[i] == '\n' || note[i] == ' ');
+}
+
+// ===================== benchmark =====================
+template <typename Fn>
+static uint32_t bestMicros(int runs, Fn fn) {
+  uint32_t best = UINT32_MAX;
+  for (int i = 0; i < runs; i++) {
+    const unsigned long start = micros();
+    fn();
+    best = min<uint32_t>(best, micros() - start);
+  }
+  return best;
+}
+
+void test_benchmark_100k_note() {
+  const std::string note = makeNote(100 * 1024, 42);
+  const String     noteString(note);
+  const GFXfont*   font = &FreeMonoBold9pt7b;
+
+  size_t spans = 0;
+  const uint32_t wrapUs = bestMicros(5, [&] {
+    spans = 0;
+    TextWrap::wrap(note.c_str(), note.size(), FontMetrics::of(font), maxWidth, [&](size_t, size_t) { spans++; });
+  });
+  // Same, copying each line out like stringToVector() does
+  std::vector<String> lines;
+  const uint32_t copyUs = bestMicros(5, [&] {
+    lines.clear();
+    TextWrap::wrap(note.c_str(), note.size(), FontMetrics::of(font), maxWidth,
+                   [&](size_t offset, size_t length) { lines.push_back(String(note.c_str() + offset, length)); });
+  });
+  size_t oldLines = 0;
+  const uint32_t oldUs = bestMicros(1, [&] { oldLines = oldWrap(noteString, inkBoundsOf(font)).size(); });
+
+  TEST_ASSERT_EQUAL(spans, lines.size());
+  // The old loop measured ink bounds rather than advances, and split lines
+  // at '\n' like a soft wrap, so its count is close but not the same
+  TEST_ASSERT_UINT32_WITHIN(spans / 10, spans, oldLines);
+  TEST_ASSERT_LESS_THAN_UINT32(oldUs, copyUs);
+
+  char line[112];
+  snprintf(line, sizeof(line), "100 KB note, %u lines: spans %u us, spans + String copies %u us", (unsigned)spans,
+           (unsigned)wrapUs, (unsigned)copyUs);
+  TEST_MESSAGE(line);
+  snprintf(line, sizeof(line), "old loop with a bounds measure per char: %u lines, %u us", (unsigned)oldLines, (unsigned)oldUs);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_soft_wraps_match_the_old_loop);
+  RUN_TEST(test_hard_break_keeps_the_line_as_it_stands);
+  RUN_TEST(test_blank_lines_are_skipped);
+  RUN_TEST(test_word_without_spaces_breaks_mid_word);
+  RUN_TEST(test_split_at_last_space_and_trailing_space);
+  RUN_TEST(test_spans_cover_the_text_in_order);
+  RUN_TEST(test_benchmark_100k_note);
+  return UNITY_END();
+}